@@ -0,0 +1,494 @@
+
+#include "CMAES.h"
+#include "CellularEvolution.h"
+#include "CuckooSearch.h"
+#include "CulturalAlgorithm.h"
+#include "DifferentialEvolution.h"
+#include "HarmonySearch.h"
+#include "Memetic.h"
+#include "MultimodalEvolution.h"
+#include "SpiralOptimization.h"
+#include "SwarmOptimization.h"
+
+#include "Objectives.h"
+#include "SyntheticLatency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace MetaOpt;
+using namespace MetaOpt::Bench;
+
+
+namespace
+{
+
+struct Options
+{
+    std::vector< std::string > algorithms{ "de", "pso" };
+    std::vector< std::string > functions{ "sphere", "rosenbrock", "rastrigin", "ackley", "griewank", "schwefel" };
+    std::vector< size_t > dims{ 10, 100, 1000 };
+    std::vector< size_t > threads{};
+    size_t particles  = 64;
+    size_t iterations = 200;
+    size_t repeats    = 1;
+    double targetGap  = 1e-3;
+    uint64_t seed     = 1u;
+    SyntheticLatency latency{};
+    std::string format = "table";
+    std::string output{};
+};
+
+
+struct Result
+{
+    std::string algorithm;
+    std::string function;
+    size_t dims;
+    size_t threads;
+    size_t particles;
+    size_t iterations;
+    std::string latency;
+
+    double wallSeconds;
+    uint64_t evaluations;
+    double evaluationsPerSecond;
+    double updateSeconds;
+    double evaluateSeconds;
+    double queueWaitSeconds;
+    double timeToTarget;    // Negative when the target was not reached
+    double bestFitness;
+
+    double speedup;         // Against the single-threaded run of the same configuration, 0 when there is none
+    double efficiency;
+};
+
+
+void printUsage()
+{
+    std::cout <<
+        "usage: bench [options]\n"
+        "  --algorithms de,pso            optimizers to run: de, pso, cmaes, cellular, cuckoo,\n"
+        "                                 harmony, memetic (DE with pattern search), multimodal,\n"
+        "                                 cultural, spiral\n"
+        "  --functions sphere,...         sphere, rosenbrock, rastrigin, ackley, griewank, schwefel\n"
+        "  --dims 10,100,1000             problem dimensions\n"
+        "  --threads 1,2,4                thread counts (default: powers of two up to the core count)\n"
+        "  --particles 64                 population size\n"
+        "  --iterations 200               generations per run\n"
+        "  --repeats 1                    runs per configuration, the fastest is reported\n"
+        "  --target-gap 1e-3              time-to-target is measured to minimum + gap\n"
+        "  --latency none                 synthetic evaluation time: fixed:<us>, uniform:<us>:<+-us>,\n"
+        "                                 exponential:<us> or lognormal:<us>:<sigma>\n"
+        "  --seed 1\n"
+        "  --format table                 table, csv or json\n"
+        "  --output <file>                write results there instead of stdout\n";
+}
+
+
+template< typename T >
+std::vector< T > parseList( const std::string& text, const std::function< T( const std::string& ) >& parse )
+{
+    std::vector< T > values;
+    std::istringstream stream( text );
+    std::string item;
+
+    while ( std::getline( stream, item, ',' ) )
+    {
+        if ( !item.empty() )
+        {
+            values.push_back( parse( item ) );
+        }
+    }
+
+    return values;
+}
+
+
+Options parseOptions( const int argc, char** argv )
+{
+    Options options;
+
+    const auto toString = []( const std::string& s ) { return s; };
+    const auto toSize   = []( const std::string& s ) { return static_cast< size_t >( std::stoull( s ) ); };
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string key = argv[i];
+
+        if ( key == "--help" || key == "-h" )
+        {
+            printUsage();
+            std::exit( 0 );
+        }
+
+        if ( i + 1 >= argc )
+        {
+            throw std::invalid_argument( "missing value for " + key );
+        }
+
+        const std::string value = argv[++i];
+
+        if ( key == "--algorithms" )      { options.algorithms = parseList< std::string >( value, toString ); }
+        else if ( key == "--functions" )  { options.functions = parseList< std::string >( value, toString ); }
+        else if ( key == "--dims" )       { options.dims = parseList< size_t >( value, toSize ); }
+        else if ( key == "--threads" )    { options.threads = parseList< size_t >( value, toSize ); }
+        else if ( key == "--particles" )  { options.particles = toSize( value ); }
+        else if ( key == "--iterations" ) { options.iterations = toSize( value ); }
+        else if ( key == "--repeats" )    { options.repeats = std::max< size_t >( 1u, toSize( value ) ); }
+        else if ( key == "--target-gap" ) { options.targetGap = std::stod( value ); }
+        else if ( key == "--latency" )    { options.latency = SyntheticLatency::parse( value ); }
+        else if ( key == "--seed" )       { options.seed = std::stoull( value ); }
+        else if ( key == "--format" )     { options.format = value; }
+        else if ( key == "--output" )     { options.output = value; }
+        else
+        {
+            throw std::invalid_argument( "unknown option " + key );
+        }
+    }
+
+    if ( options.threads.empty() )
+    {
+        const size_t cores = std::max( 1u, std::thread::hardware_concurrency() );
+
+        for ( size_t t = 1; t < cores; t *= 2 )
+        {
+            options.threads.push_back( t );
+        }
+
+        options.threads.push_back( cores );
+    }
+
+    if ( options.format != "table" && options.format != "csv" && options.format != "json" )
+    {
+        throw std::invalid_argument( "unknown format " + options.format );
+    }
+
+    return options;
+}
+
+
+
+template< typename alg_t >
+Result runOnce( const std::string& algorithm, const Objective& objective, const size_t dims, const size_t threads, const Options& options )
+{
+    const std::vector< double > lowerBound( dims, objective.lowerBound );
+    const std::vector< double > upperBound( dims, objective.upperBound );
+
+    alg_t alg{ options.particles, dims, lowerBound.data(), upperBound.data(), static_cast< int >( threads ) };
+
+    alg.setSeed( options.seed );
+    alg.setMaxIterations( options.iterations );
+
+    using clock = std::chrono::steady_clock;
+
+    const double target = objective.minimum + options.targetGap;
+
+    std::atomic< uint64_t > evaluations{ 0u };
+    std::atomic< int64_t > reachedNanos{ -1 };
+    clock::time_point start;
+
+    const SyntheticLatency& latency = options.latency;
+    const uint64_t seed = options.seed;
+
+    alg.setBatchFitnessFunc( [&]( std::span< const double > positions, std::span< double > fitnesses )
+    {
+        thread_local Rng<> rng( seed, std::hash< std::thread::id >{}( std::this_thread::get_id() ) );
+
+        double best = std::numeric_limits< double >::max();
+
+        for ( size_t r = 0; r < fitnesses.size(); ++r )
+        {
+            fitnesses[r] = objective.function( positions.data() + r * dims, dims );
+            best = std::min( best, fitnesses[r] );
+
+            latency.wait( rng );
+        }
+
+        evaluations.fetch_add( fitnesses.size(), std::memory_order_relaxed );
+
+        if ( best <= target && reachedNanos.load( std::memory_order_relaxed ) < 0 )
+        {
+            int64_t expected = -1;
+            reachedNanos.compare_exchange_strong( expected, std::chrono::duration_cast< std::chrono::nanoseconds >( clock::now() - start ).count() );
+        }
+    } );
+
+    start = clock::now();
+    alg.run();
+    const double wallSeconds = std::chrono::duration< double >( clock::now() - start ).count();
+
+    const Profiler& profiler = alg.getProfiler();
+
+    Result result{};
+
+    result.algorithm            = algorithm;
+    result.function             = objective.name;
+    result.dims                 = dims;
+    result.threads              = threads;
+    result.particles            = options.particles;
+    result.iterations           = options.iterations;
+    result.latency              = latency.describe();
+    result.wallSeconds          = wallSeconds;
+    result.evaluations          = evaluations.load();
+    result.evaluationsPerSecond = static_cast< double >( result.evaluations ) / wallSeconds;
+    result.updateSeconds        = static_cast< double >( profiler.getPhaseNanos( Profiler::Phase::UPDATE ) ) * 1e-9;
+    result.evaluateSeconds      = static_cast< double >( profiler.getPhaseNanos( Profiler::Phase::EVALUATE ) ) * 1e-9;
+    result.queueWaitSeconds     = static_cast< double >( profiler.getPhaseNanos( Profiler::Phase::QUEUE_WAIT ) ) * 1e-9;
+    result.timeToTarget         = reachedNanos.load() < 0 ? -1.0 : static_cast< double >( reachedNanos.load() ) * 1e-9;
+    result.bestFitness          = alg.getBestParticle().fitness_;
+
+    return result;
+}
+
+
+Result runConfiguration( const std::string& algorithm, const Objective& objective, const size_t dims, const size_t threads, const Options& options )
+{
+    Result best{};
+
+    for ( size_t r = 0; r < options.repeats; ++r )
+    {
+        Result result;
+
+        if ( algorithm == "de" )
+        {
+            result = runOnce< DifferentialEvolution< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "pso" )
+        {
+            result = runOnce< SwarmOptimization< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "cmaes" )
+        {
+            result = runOnce< CMAES< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "cellular" )
+        {
+            result = runOnce< CellularEvolution< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "cuckoo" )
+        {
+            result = runOnce< CuckooSearch< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "harmony" )
+        {
+            result = runOnce< HarmonySearch< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "memetic" )
+        {
+            result = runOnce< Memetic< DifferentialEvolution< DYNAMIC_EXTENT, DYNAMIC_EXTENT > > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "multimodal" )
+        {
+            result = runOnce< MultimodalEvolution< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "cultural" )
+        {
+            result = runOnce< CulturalAlgorithm< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else if ( algorithm == "spiral" )
+        {
+            result = runOnce< SpiralOptimization< DYNAMIC_EXTENT, DYNAMIC_EXTENT > >( algorithm, objective, dims, threads, options );
+        }
+        else
+        {
+            throw std::invalid_argument( "unknown algorithm " + algorithm );
+        }
+
+        if ( r == 0 || result.wallSeconds < best.wallSeconds )
+        {
+            best = result;
+        }
+    }
+
+    return best;
+}
+
+
+// Speedup and efficiency of every run against the single-threaded run of the same configuration
+void computeScaling( std::vector< Result >& results )
+{
+    for ( Result& result : results )
+    {
+        for ( const Result& base : results )
+        {
+            if ( base.threads == 1 && base.algorithm == result.algorithm && base.function == result.function && base.dims == result.dims )
+            {
+                result.speedup    = base.wallSeconds / result.wallSeconds;
+                result.efficiency = result.speedup / static_cast< double >( result.threads );
+            }
+        }
+    }
+}
+
+
+
+void writeTable( std::ostream& out, const std::vector< Result >& results )
+{
+    out << std::left << std::setw( 12 ) << "alg" << std::setw( 12 ) << "function" << std::right << std::setw( 6 ) << "dims" << std::setw( 5 ) << "thr"
+        << std::setw( 11 ) << "wall[s]" << std::setw( 13 ) << "evals/s" << std::setw( 11 ) << "update[s]" << std::setw( 11 ) << "wait[s]"
+        << std::setw( 11 ) << "target[s]" << std::setw( 9 ) << "speedup" << std::setw( 9 ) << "eff" << std::setw( 14 ) << "best" << "\n";
+
+    for ( const Result& r : results )
+    {
+        std::ostringstream toTarget;
+
+        if ( r.timeToTarget < 0.0 )
+        {
+            toTarget << "-";
+        }
+        else
+        {
+            toTarget << std::setprecision( 4 ) << r.timeToTarget;
+        }
+
+        out << std::left << std::setw( 12 ) << r.algorithm << std::setw( 12 ) << r.function << std::right << std::setw( 6 ) << r.dims << std::setw( 5 ) << r.threads
+            << std::setprecision( 4 ) << std::setw( 11 ) << r.wallSeconds << std::setw( 13 ) << std::setprecision( 6 ) << r.evaluationsPerSecond
+            << std::setprecision( 4 ) << std::setw( 11 ) << r.updateSeconds << std::setw( 11 ) << r.queueWaitSeconds << std::setw( 11 ) << toTarget.str()
+            << std::setw( 9 ) << r.speedup << std::setw( 9 ) << r.efficiency << std::setw( 14 ) << std::setprecision( 6 ) << r.bestFitness << "\n";
+    }
+}
+
+
+void writeCsv( std::ostream& out, const std::vector< Result >& results )
+{
+    out << "algorithm,function,dims,threads,particles,iterations,latency,wall_seconds,evaluations,evaluations_per_second,"
+           "update_seconds,evaluate_seconds,queue_wait_seconds,time_to_target_seconds,best_fitness,speedup,efficiency\n";
+
+    out << std::setprecision( 9 );
+
+    for ( const Result& r : results )
+    {
+        out << r.algorithm << "," << r.function << "," << r.dims << "," << r.threads << "," << r.particles << "," << r.iterations << "," << r.latency << ","
+            << r.wallSeconds << "," << r.evaluations << "," << r.evaluationsPerSecond << "," << r.updateSeconds << "," << r.evaluateSeconds << ","
+            << r.queueWaitSeconds << ",";
+
+        if ( r.timeToTarget >= 0.0 )
+        {
+            out << r.timeToTarget;
+        }
+
+        out << "," << r.bestFitness << "," << r.speedup << "," << r.efficiency << "\n";
+    }
+}
+
+
+void writeJson( std::ostream& out, const std::vector< Result >& results )
+{
+    out << std::setprecision( 9 ) << "[\n";
+
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+        const Result& r = results[i];
+
+        out << "  {\"algorithm\": \"" << r.algorithm << "\", \"function\": \"" << r.function << "\", \"dims\": " << r.dims << ", \"threads\": " << r.threads
+            << ", \"particles\": " << r.particles << ", \"iterations\": " << r.iterations << ", \"latency\": \"" << r.latency << "\""
+            << ", \"wallSeconds\": " << r.wallSeconds << ", \"evaluations\": " << r.evaluations << ", \"evaluationsPerSecond\": " << r.evaluationsPerSecond
+            << ", \"updateSeconds\": " << r.updateSeconds << ", \"evaluateSeconds\": " << r.evaluateSeconds << ", \"queueWaitSeconds\": " << r.queueWaitSeconds
+            << ", \"timeToTargetSeconds\": ";
+
+        if ( r.timeToTarget >= 0.0 )
+        {
+            out << r.timeToTarget;
+        }
+        else
+        {
+            out << "null";
+        }
+
+        out << ", \"bestFitness\": " << r.bestFitness << ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency << "}"
+            << ( i + 1 < results.size() ? "," : "" ) << "\n";
+    }
+
+    out << "]" << std::endl;
+}
+
+} // namespace
+
+
+
+int main( int argc, char** argv )
+{
+    Options options;
+
+    try
+    {
+        options = parseOptions( argc, argv );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "bench: " << e.what() << "\n\n";
+        printUsage();
+        return 1;
+    }
+
+    std::vector< Result > results;
+
+    for ( const std::string& algorithm : options.algorithms )
+    {
+        for ( const std::string& function : options.functions )
+        {
+            const Objective* objective = findObjective( function );
+
+            if ( !objective )
+            {
+                std::cerr << "bench: unknown function " << function << std::endl;
+                return 1;
+            }
+
+            for ( const size_t dims : options.dims )
+            {
+                for ( const size_t threads : options.threads )
+                {
+                    std::cerr << "running " << algorithm << " " << function << " D=" << dims << " threads=" << threads << std::endl;
+
+                    results.push_back( runConfiguration( algorithm, *objective, dims, threads, options ) );
+                }
+            }
+        }
+    }
+
+    computeScaling( results );
+
+    std::ofstream file;
+
+    if ( !options.output.empty() )
+    {
+        file.open( options.output );
+
+        if ( !file )
+        {
+            std::cerr << "bench: cannot open " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostream& out = options.output.empty() ? std::cout : file;
+
+    if ( options.format == "csv" )
+    {
+        writeCsv( out, results );
+    }
+    else if ( options.format == "json" )
+    {
+        writeJson( out, results );
+    }
+    else
+    {
+        writeTable( out, results );
+    }
+
+    return 0;
+}
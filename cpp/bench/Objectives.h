@@ -0,0 +1,150 @@
+#ifndef OBJECTIVES_H
+#define OBJECTIVES_H
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <string>
+#include <vector>
+
+
+namespace MetaOpt
+{
+namespace Bench
+{
+
+// Classic test function on a box with a known global minimum value
+struct Objective
+{
+    using function_t = double ( * )( const double* x, const size_t dims );
+
+    std::string name;
+    function_t function;
+    double lowerBound;
+    double upperBound;
+    double minimum;
+};
+
+
+
+inline double sphere( const double* x, const size_t dims )
+{
+    double sum = 0.0;
+
+    for ( size_t j = 0; j < dims; ++j )
+    {
+        sum += x[j] * x[j];
+    }
+
+    return sum;
+}
+
+
+inline double rosenbrock( const double* x, const size_t dims )
+{
+    double sum = 0.0;
+
+    for ( size_t j = 0; j + 1 < dims; ++j )
+    {
+        const double a = x[j + 1] - x[j] * x[j];
+        const double b = 1.0 - x[j];
+
+        sum += 100.0 * a * a + b * b;
+    }
+
+    return sum;
+}
+
+
+inline double rastrigin( const double* x, const size_t dims )
+{
+    double sum = 10.0 * static_cast< double >( dims );
+
+    for ( size_t j = 0; j < dims; ++j )
+    {
+        sum += x[j] * x[j] - 10.0 * std::cos( 2.0 * std::numbers::pi * x[j] );
+    }
+
+    return sum;
+}
+
+
+inline double ackley( const double* x, const size_t dims )
+{
+    double squares = 0.0;
+    double cosines = 0.0;
+
+    for ( size_t j = 0; j < dims; ++j )
+    {
+        squares += x[j] * x[j];
+        cosines += std::cos( 2.0 * std::numbers::pi * x[j] );
+    }
+
+    const double n = static_cast< double >( dims );
+
+    return -20.0 * std::exp( -0.2 * std::sqrt( squares / n ) ) - std::exp( cosines / n ) + 20.0 + std::numbers::e;
+}
+
+
+inline double griewank( const double* x, const size_t dims )
+{
+    double sum     = 0.0;
+    double product = 1.0;
+
+    for ( size_t j = 0; j < dims; ++j )
+    {
+        sum     += x[j] * x[j];
+        product *= std::cos( x[j] / std::sqrt( static_cast< double >( j + 1 ) ) );
+    }
+
+    return 1.0 + sum / 4000.0 - product;
+}
+
+
+inline double schwefel( const double* x, const size_t dims )
+{
+    double sum = 418.9828872724338 * static_cast< double >( dims );
+
+    for ( size_t j = 0; j < dims; ++j )
+    {
+        sum -= x[j] * std::sin( std::sqrt( std::abs( x[j] ) ) );
+    }
+
+    return sum;
+}
+
+
+
+inline const std::vector< Objective >& getObjectives()
+{
+    static const std::vector< Objective > objectives =
+    {
+        { "sphere",     sphere,     -5.12,   5.12,   0.0 },
+        { "rosenbrock", rosenbrock, -2.048,  2.048,  0.0 },
+        { "rastrigin",  rastrigin,  -5.12,   5.12,   0.0 },
+        { "ackley",     ackley,     -32.768, 32.768, 0.0 },
+        { "griewank",   griewank,   -600.0,  600.0,  0.0 },
+        { "schwefel",   schwefel,   -500.0,  500.0,  0.0 },
+    };
+
+    return objectives;
+}
+
+
+inline const Objective* findObjective( const std::string& name )
+{
+    for ( const Objective& objective : getObjectives() )
+    {
+        if ( objective.name == name )
+        {
+            return &objective;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace Bench
+} // namespace MetaOpt
+
+#endif // OBJECTIVES_H
@@ -0,0 +1,154 @@
+#ifndef SYNTHETIC_LATENCY_H
+#define SYNTHETIC_LATENCY_H
+
+#include "Rng.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+namespace MetaOpt
+{
+namespace Bench
+{
+
+// Extra time added to every evaluation to model expensive objectives. The delay is busy-waited, so a worker
+// stays occupied the way it would with a real CPU-bound objective.
+class SyntheticLatency
+{
+public:
+
+    enum class Distribution
+    {
+        NONE,
+        FIXED,          // Always mean
+        UNIFORM,        // Uniform in [mean - spread, mean + spread]
+        EXPONENTIAL,    // Exponential with the given mean
+        LOGNORMAL       // Log-normal with the given mean, spread is sigma of the underlying normal
+    };
+
+
+    SyntheticLatency()
+        : distribution_{ Distribution::NONE }
+        , meanMicros_{ 0.0 }
+        , spread_{ 0.0 }
+    {
+    }
+
+
+    // none, fixed:<us>, uniform:<us>:<+-us>, exponential:<us> or lognormal:<us>:<sigma>
+    static SyntheticLatency parse( const std::string& spec )
+    {
+        SyntheticLatency latency;
+
+        std::istringstream stream( spec );
+        std::string kind;
+        std::getline( stream, kind, ':' );
+
+        std::string field;
+        double values[2] = { 0.0, 0.0 };
+        size_t numValues = 0;
+
+        while ( numValues < 2 && std::getline( stream, field, ':' ) )
+        {
+            values[numValues++] = std::stod( field );
+        }
+
+        if ( kind == "none" )
+        {
+            return latency;
+        }
+        else if ( kind == "fixed" && numValues == 1 )
+        {
+            latency.distribution_ = Distribution::FIXED;
+        }
+        else if ( kind == "uniform" && numValues == 2 && values[1] <= values[0] )
+        {
+            latency.distribution_ = Distribution::UNIFORM;
+        }
+        else if ( kind == "exponential" && numValues == 1 )
+        {
+            latency.distribution_ = Distribution::EXPONENTIAL;
+        }
+        else if ( kind == "lognormal" && numValues == 2 )
+        {
+            latency.distribution_ = Distribution::LOGNORMAL;
+        }
+        else
+        {
+            throw std::invalid_argument( "SyntheticLatency::parse: cannot parse '" + spec + "'" );
+        }
+
+        latency.meanMicros_ = values[0];
+        latency.spread_     = values[1];
+
+        return latency;
+    }
+
+
+    bool isEnabled() const { return distribution_ != Distribution::NONE; }
+
+
+    std::string describe() const
+    {
+        std::ostringstream out;
+
+        switch ( distribution_ )
+        {
+            case Distribution::NONE:        out << "none"; break;
+            case Distribution::FIXED:       out << "fixed:" << meanMicros_; break;
+            case Distribution::UNIFORM:     out << "uniform:" << meanMicros_ << ":" << spread_; break;
+            case Distribution::EXPONENTIAL: out << "exponential:" << meanMicros_; break;
+            case Distribution::LOGNORMAL:   out << "lognormal:" << meanMicros_ << ":" << spread_; break;
+        }
+
+        return out.str();
+    }
+
+
+    double drawMicros( Rng<>& rng ) const
+    {
+        switch ( distribution_ )
+        {
+            case Distribution::NONE:        return 0.0;
+            case Distribution::FIXED:       return meanMicros_;
+            case Distribution::UNIFORM:     return rng.drawUniform( meanMicros_ - spread_, meanMicros_ + spread_ );
+            case Distribution::EXPONENTIAL: return -meanMicros_ * std::log( 1.0 - rng.drawUniform< double >() );
+            case Distribution::LOGNORMAL:   return meanMicros_ * std::exp( spread_ * rng.drawNormal< double >() - 0.5 * spread_ * spread_ );
+        }
+
+        return 0.0;
+    }
+
+
+    void wait( Rng<>& rng ) const
+    {
+        if ( !isEnabled() )
+        {
+            return;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds( static_cast< int64_t >( drawMicros( rng ) * 1e3 ) );
+
+        while ( std::chrono::steady_clock::now() < deadline )
+        {
+        }
+    }
+
+
+private:
+
+    Distribution distribution_;
+    double meanMicros_;
+    double spread_;
+
+}; // class SyntheticLatency
+
+} // namespace Bench
+} // namespace MetaOpt
+
+#endif // SYNTHETIC_LATENCY_H
@@ -0,0 +1,90 @@
+
+#include "Arena.h"
+
+#include <new>
+
+#include <sys/mman.h>
+
+
+namespace MetaOpt
+{
+
+
+Arena::Arena()
+    : base_{ nullptr }
+    , capacity_{ 0u }
+    , used_{ 0u }
+    , hugePages_{ false }
+{
+}
+
+
+Arena::Arena( const size_t capacity, const bool hugePages )
+    : base_{ nullptr }
+    , capacity_{ 0u }
+    , used_{ 0u }
+    , hugePages_{ false }
+{
+    if ( capacity == 0 )
+    {
+        return;
+    }
+
+    const size_t pageSize = hugePages ? HUGE_PAGE_SIZE : DEFAULT_ALIGNMENT;
+    const size_t length   = ( capacity + pageSize - 1 ) / pageSize * pageSize;
+
+    void* mapping = MAP_FAILED;
+
+    if ( hugePages )
+    {
+        // Without MAP_NORESERVE, so the mapping fails now instead of faulting later when the pool is short
+        mapping = mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+        hugePages_ = mapping != MAP_FAILED;
+    }
+
+    if ( mapping == MAP_FAILED )
+    {
+        mapping = mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+        if ( mapping == MAP_FAILED )
+        {
+            throw std::bad_alloc();
+        }
+
+        if ( hugePages )
+        {
+            // Best effort, the kernel may not support transparent huge pages
+            hugePages_ = madvise( mapping, length, MADV_HUGEPAGE ) == 0;
+        }
+    }
+
+    base_     = static_cast< std::byte* >( mapping );
+    capacity_ = length;
+}
+
+
+Arena::~Arena()
+{
+    if ( base_ )
+    {
+        munmap( base_, capacity_ );
+    }
+}
+
+
+void* Arena::allocate( const size_t bytes, const size_t alignment )
+{
+    const size_t offset = ( used_ + alignment - 1 ) / alignment * alignment;
+
+    if ( offset + bytes > capacity_ )
+    {
+        throw std::bad_alloc();
+    }
+
+    used_ = offset + bytes;
+
+    return base_ + offset;
+}
+
+} // namespace MetaOpt
@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace MetaOpt
+{
+
+// Bump allocator over one anonymous mapping. The whole capacity is reserved up front but pages are only backed
+// once touched, so it can be sized generously. Memory is zero-initialized and released all at once on destruction.
+class Arena
+{
+public:
+
+    static constexpr size_t DEFAULT_ALIGNMENT = 64;
+    static constexpr size_t HUGE_PAGE_SIZE    = 2u << 20;
+
+
+    Arena();
+
+    // With hugePages, explicit huge pages are tried first, then transparent huge pages are requested
+    explicit Arena( const size_t capacity, const bool hugePages = false );
+
+    ~Arena();
+
+
+    void* allocate( const size_t bytes, const size_t alignment = DEFAULT_ALIGNMENT );
+
+
+    template< typename T >
+    T* allocate( const size_t count, const size_t alignment = DEFAULT_ALIGNMENT )
+    {
+        return static_cast< T* >( allocate( count * sizeof( T ), alignment < alignof( T ) ? alignof( T ) : alignment ) );
+    }
+
+
+    size_t getCapacity() const { return capacity_; }
+    size_t getUsed() const { return used_; }
+    bool usesHugePages() const { return hugePages_; }
+
+
+private:
+
+    std::byte* base_;
+    size_t capacity_;
+    size_t used_;
+    bool hugePages_;
+
+
+    Arena( const Arena& ) = delete;
+    Arena& operator=( const Arena& ) = delete;
+
+}; // class Arena
+
+} // namespace MetaOpt
+
+#endif // ARENA_H
@@ -0,0 +1,895 @@
+#ifndef CMAES_H
+#define CMAES_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Covariance matrix adaptation evolution strategy (Hansen's (mu/mu_w, lambda)-CMA-ES). The population holds the
+// lambda offspring of the current generation, sampled around the mean from N( 0, sigma^2 C ) in parallel on the
+// thread pool and clipped to the bounds. C is kept as a dense symmetric matrix: the rank-one and rank-mu updates
+// run in cache-sized tiles of the upper triangle, and C is only decomposed every few generations, when enough has
+// changed, by a Householder tridiagonalization and implicit QL. Sizes of 100 to 1000 parameters keep the work per
+// generation at O( lambda n^2 ) plus the amortized O( n^3 ) decomposition.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class CMAES : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    static constexpr size_t  NUM_PARTICLES              = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS                 = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_STEP_SIZE          = 0.3;      // Fraction of the mean width of the bounds
+    static constexpr param_t DEFAULT_STEP_TOLERANCE     = 1e-12;    // Relative to the initial step size
+    static constexpr size_t  TILE_SIZE                  = 64;       // Rows and columns of a covariance tile
+    static constexpr size_t  SAMPLE_BLOCK_SIZE          = 32;       // Eigenvectors reused per pass over offspring
+
+
+    // lambda = 4 + 3 ln n, the usual population size for n parameters
+    static constexpr size_t getDefaultPopulationSize( const size_t numParams )
+    {
+        return 4u + static_cast< size_t >( 3.0 * std::log( static_cast< double >( numParams ) ) );
+    }
+
+
+    // Constructor
+    CMAES( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : CMAES( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time. numParticles is lambda, at least 4.
+    CMAES( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+           const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , stepSizeFraction_{ DEFAULT_STEP_SIZE }
+        , stepTolerance_{ DEFAULT_STEP_TOLERANCE }
+        , eigenInterval_{ 0u }
+        , mu_{ numParticles / 2 }
+        , weights_( numParticles / 2 )
+        , muEff_{ 0 }
+        , cc_{ 0 }
+        , cs_{ 0 }
+        , c1_{ 0 }
+        , cmu_{ 0 }
+        , damps_{ 0 }
+        , chiN_{ 0 }
+        , sigma_{ 0 }
+        , initialSigma_{ 0 }
+        , eigenGeneration_{ 0u }
+        , selectionThreshold_{ std::numeric_limits< fitness_t >::max() }
+        , selectionError2_{ 0 }
+        , mean_{ numParams, this->arena_ }
+        , evolutionPath_{ numParams, this->arena_ }
+        , conjugatePath_{ numParams, this->arena_ }
+        , axisLengths_{ numParams, this->arena_ }
+        , meanStep_{ numParams, this->arena_ }
+        , whitened_{ numParams, this->arena_ }
+        , projections_{ numParams, this->arena_ }
+        , offdiagonal_{ numParams, this->arena_ }
+        , draws_{ numParticles * numParams, this->arena_ }
+        , steps_{ numParticles * numParams, this->arena_ }
+        , weightedSteps_{ numParticles * numParams, this->arena_ }
+        , covariance_( numParams * numParams )
+        , eigenvectors_( numParams * numParams )
+        , order_( numParticles )
+    {
+        if ( numParticles < 4 )
+        {
+            throw std::invalid_argument( "CMAES::CMAES: at least 4 offspring per generation are needed" );
+        }
+
+        computeStrategyParameters();
+    }
+
+    // Destructor
+    virtual ~CMAES() {}
+
+
+    // Initial sigma as a fraction of the mean width of the bounds
+    void setInitialStepSize( const param_t fraction ) { stepSizeFraction_ = fraction; }
+
+    // The run converges once sigma times the longest axis of C falls below tolerance times the initial sigma
+    void setStepSizeTolerance( const param_t tolerance ) { stepTolerance_ = tolerance; }
+
+    // Generations between decompositions of C; 0 picks lambda / ( ( c1 + cmu ) n 10 ), at least 1
+    void setEigenInterval( const uint64_t interval ) { eigenInterval_ = interval; }
+
+
+    param_t getStepSize() const { return sigma_; }
+    const param_t* getMean() const { return mean_.data(); }
+
+
+protected:
+
+    // Fresh distribution: C = I, paths at zero. The mean is set once the initial population is evaluated.
+    void postInitialize() override
+    {
+        const size_t numParams = this->getNumParams();
+
+        param_t width = 0;
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            width += this->upperBound_[j] - this->lowerBound_[j];
+        }
+
+        sigma_        = stepSizeFraction_ * width / static_cast< param_t >( numParams );
+        initialSigma_ = sigma_;
+
+        evolutionPath_.fill( 0 );
+        conjugatePath_.fill( 0 );
+        axisLengths_.fill( 1 );
+
+        std::fill( covariance_.begin(), covariance_.end(), static_cast< param_t >( 0 ) );
+        std::fill( eigenvectors_.begin(), eigenvectors_.end(), static_cast< param_t >( 0 ) );
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            covariance_[j * numParams + j]   = 1;
+            eigenvectors_[j * numParams + j] = 1;
+        }
+
+        eigenGeneration_ = 0u;
+
+        selectionThreshold_ = std::numeric_limits< fitness_t >::max();
+        selectionError2_    = 0;
+    }
+
+
+    // The search starts from the best initial particle, e.g. one given with insertParticle
+    void evaluateParticles() override
+    {
+        Base::evaluateParticles();
+
+        const size_t best = this->population_.argBest();
+
+        std::memcpy( mean_.data(), this->population_.position( best ), this->getNumParams() * sizeof( param_t ) );
+    }
+
+
+    // Offspring x = mean + sigma B D z, clipped; the step kept for the update is the one actually taken
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            param_t* draws = draws_.data() + i * numParams;
+
+            this->rngs_[i].fillNormal( draws, numParams );
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                draws[j] *= axisLengths_[j];
+            }
+
+            std::fill( steps_.data() + i * numParams, steps_.data() + ( i + 1 ) * numParams, static_cast< param_t >( 0 ) );
+        }
+
+        // Rows of eigenvectors_ are the axes of C; a block of them is streamed once for all offspring of the chunk
+        for ( size_t axisBegin = 0; axisBegin < numParams; axisBegin += SAMPLE_BLOCK_SIZE )
+        {
+            const size_t axisEnd = std::min( axisBegin + SAMPLE_BLOCK_SIZE, numParams );
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                axpyRows( steps_.data() + i * numParams, draws_.data() + i * numParams + axisBegin, eigenvectors_.data() + axisBegin * numParams,
+                          numParams, axisEnd - axisBegin, numParams );
+            }
+        }
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            placeOffspring( this->population_.position( i ), steps_.data() + i * numParams, mean_.data(), this->lowerBound_.data(),
+                            this->upperBound_.data(), numParams, sigma_ );
+        }
+    }
+
+
+    // Offspring are ranked rather than compared pairwise; under resampling they race against the mu-th best
+    // offspring of the previous generation, a proxy for the cut they must make. The initial population has none.
+    fitness_t getRacingThreshold( const population_t&, const size_t, fitness_t& standardError2 ) const override
+    {
+        standardError2 = selectionError2_;
+        return selectionThreshold_;
+    }
+
+
+    // Sampling and evaluation run chunk by chunk on the pool; the distribution update follows once all are in
+    void updateParticles() override
+    {
+        Base::updateParticles();
+
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+        adaptDistribution();
+    }
+
+
+    bool isConverged() override
+    {
+        if ( Base::isConverged() )
+        {
+            return true;
+        }
+
+        const param_t longestAxis = *std::max_element( axisLengths_.data(), axisLengths_.data() + this->getNumParams() );
+
+        if ( this->iteration_ > 0 && sigma_ * longestAxis < stepTolerance_ * initialSigma_ )
+        {
+            this->stopReason_ = StopReason::CONVERGED;
+            return true;
+        }
+
+        return false;
+    }
+
+
+    const char* getSnapshotTag() const override { return "CMAES"; }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        const size_t numParams = this->getNumParams();
+
+        writer.write( sigma_ );
+        writer.write( initialSigma_ );
+        writer.write( eigenGeneration_ );
+        writer.write( selectionThreshold_ );
+        writer.write( selectionError2_ );
+
+        writer.writeArray( mean_.data(), numParams );
+        writer.writeArray( evolutionPath_.data(), numParams );
+        writer.writeArray( conjugatePath_.data(), numParams );
+        writer.writeArray( axisLengths_.data(), numParams );
+        writer.writeArray( covariance_.data(), numParams * numParams );
+        writer.writeArray( eigenvectors_.data(), numParams * numParams );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        sigma_           = reader.read< param_t >();
+        initialSigma_    = reader.read< param_t >();
+        eigenGeneration_ = reader.read< uint64_t >();
+
+        selectionThreshold_ = reader.read< fitness_t >();
+        selectionError2_    = reader.read< fitness_t >();
+
+        reader.readArray( mean_.data(), numParams );
+        reader.readArray( evolutionPath_.data(), numParams );
+        reader.readArray( conjugatePath_.data(), numParams );
+        reader.readArray( axisLengths_.data(), numParams );
+        reader.readArray( covariance_.data(), numParams * numParams );
+        reader.readArray( eigenvectors_.data(), numParams * numParams );
+    }
+
+
+private:
+
+    // Default strategy parameters of Hansen's tutorial for lambda offspring and n parameters
+    void computeStrategyParameters()
+    {
+        const param_t n = static_cast< param_t >( this->getNumParams() );
+
+        param_t sum = 0;
+
+        for ( size_t k = 0; k < mu_; ++k )
+        {
+            weights_[k] = std::log( static_cast< param_t >( mu_ ) + static_cast< param_t >( 0.5 ) ) - std::log( static_cast< param_t >( k + 1 ) );
+            sum += weights_[k];
+        }
+
+        param_t sumSquares = 0;
+
+        for ( param_t& weight : weights_ )
+        {
+            weight /= sum;
+            sumSquares += weight * weight;
+        }
+
+        muEff_ = 1 / sumSquares;
+        cc_    = ( 4 + muEff_ / n ) / ( n + 4 + 2 * muEff_ / n );
+        cs_    = ( muEff_ + 2 ) / ( n + muEff_ + 5 );
+        c1_    = 2 / ( ( n + static_cast< param_t >( 1.3 ) ) * ( n + static_cast< param_t >( 1.3 ) ) + muEff_ );
+        cmu_   = std::min( 1 - c1_, 2 * ( muEff_ - 2 + 1 / muEff_ ) / ( ( n + 2 ) * ( n + 2 ) + muEff_ ) );
+        damps_ = 1 + 2 * std::max( static_cast< param_t >( 0 ), std::sqrt( ( muEff_ - 1 ) / ( n + 1 ) ) - 1 ) + cs_;
+        chiN_  = std::sqrt( n ) * ( 1 - 1 / ( 4 * n ) + 1 / ( 21 * n * n ) );
+    }
+
+
+    uint64_t getEigenInterval() const
+    {
+        if ( eigenInterval_ > 0 )
+        {
+            return eigenInterval_;
+        }
+
+        const param_t lambda = static_cast< param_t >( this->getNumParticles() );
+        const param_t n      = static_cast< param_t >( this->getNumParams() );
+
+        return std::max< uint64_t >( 1u, static_cast< uint64_t >( lambda / ( ( c1_ + cmu_ ) * n * 10 ) ) );
+    }
+
+
+    void adaptDistribution()
+    {
+        const size_t numParams    = this->getNumParams();
+        const uint64_t generation = this->iteration_ + 1;
+
+        std::iota( order_.begin(), order_.end(), size_t{ 0 } );
+        std::partial_sort( order_.begin(), order_.begin() + mu_, order_.end(), [this]( const size_t a, const size_t b )
+        {
+            return this->population_.fitness( a ) < this->population_.fitness( b );
+        } );
+
+        // The mu-th best of this generation is the bar for racing the next one
+        const size_t last      = order_[mu_ - 1];
+        const uint32_t samples = this->population_.sampleCount( last );
+
+        selectionThreshold_ = this->population_.fitness( last );
+        selectionError2_    = samples > 1 ? this->population_.variance( last ) / static_cast< fitness_t >( samples ) : fitness_t{};
+
+        // Weighted mean of the best mu steps; the rows scaled by sqrt( w ) feed the rank-mu update
+        meanStep_.fill( 0 );
+
+        for ( size_t k = 0; k < mu_; ++k )
+        {
+            const param_t* step = steps_.data() + order_[k] * numParams;
+
+            axpy( meanStep_.data(), weights_[k], step, numParams );
+
+            const param_t root = std::sqrt( weights_[k] );
+            param_t* weighted  = weightedSteps_.data() + k * numParams;
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                weighted[j] = root * step[j];
+            }
+        }
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            mean_[j] += sigma_ * meanStep_[j];
+        }
+
+        // C^-1/2 times the mean step, through the eigenbasis
+        for ( size_t a = 0; a < numParams; ++a )
+        {
+            projections_[a] = dot( eigenvectors_.data() + a * numParams, meanStep_.data(), numParams ) / axisLengths_[a];
+        }
+
+        whitened_.fill( 0 );
+
+        axpyRows( whitened_.data(), projections_.data(), eigenvectors_.data(), numParams, numParams, numParams );
+
+        const param_t conjugateScale = std::sqrt( cs_ * ( 2 - cs_ ) * muEff_ );
+
+        param_t conjugateNorm = 0;
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            conjugatePath_[j] = ( 1 - cs_ ) * conjugatePath_[j] + conjugateScale * whitened_[j];
+            conjugateNorm    += conjugatePath_[j] * conjugatePath_[j];
+        }
+
+        conjugateNorm = std::sqrt( conjugateNorm );
+
+        const param_t decay = std::sqrt( 1 - std::pow( 1 - cs_, static_cast< param_t >( 2 * generation ) ) );
+        const bool stalled  = conjugateNorm / decay / chiN_ >= static_cast< param_t >( 1.4 ) + 2 / ( static_cast< param_t >( numParams ) + 1 );
+
+        const param_t pathScale = stalled ? 0 : std::sqrt( cc_ * ( 2 - cc_ ) * muEff_ );
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            evolutionPath_[j] = ( 1 - cc_ ) * evolutionPath_[j] + pathScale * meanStep_[j];
+        }
+
+        const param_t keep = 1 - c1_ - cmu_ + ( stalled ? c1_ * cc_ * ( 2 - cc_ ) : 0 );
+
+        updateCovariance( keep );
+
+        sigma_ *= std::exp( ( cs_ / damps_ ) * ( conjugateNorm / chiN_ - 1 ) );
+
+        if ( generation - eigenGeneration_ >= getEigenInterval() )
+        {
+            decompose();
+            eigenGeneration_ = generation;
+        }
+    }
+
+
+    // C = keep C + c1 pc pc^T + cmu sum_k ( sqrt( w_k ) y_k ) ( sqrt( w_k ) y_k )^T over the upper triangle, one
+    // tile row per task. Each tile reads the mu weighted steps restricted to its columns, which stay in L1.
+    void updateCovariance( const param_t keep )
+    {
+        const size_t numParams = this->getNumParams();
+        const size_t numTiles  = ( numParams + TILE_SIZE - 1 ) / TILE_SIZE;
+
+        this->threadPool_.parallelFor( 0, numTiles, 1, [this, keep, numParams, numTiles]( const size_t tileBegin, const size_t tileEnd, const size_t )
+        {
+            std::vector< param_t > coefficients( mu_ );
+
+            for ( size_t tileRow = tileBegin; tileRow < tileEnd; ++tileRow )
+            {
+                const size_t rowBegin = tileRow * TILE_SIZE;
+                const size_t rowEnd   = std::min( rowBegin + TILE_SIZE, numParams );
+
+                for ( size_t tileColumn = tileRow; tileColumn < numTiles; ++tileColumn )
+                {
+                    const size_t columnBegin = tileColumn * TILE_SIZE;
+                    const size_t columnEnd   = std::min( columnBegin + TILE_SIZE, numParams );
+
+                    for ( size_t i = rowBegin; i < rowEnd; ++i )
+                    {
+                        const size_t first = std::max( i, columnBegin );
+
+                        if ( first >= columnEnd )
+                        {
+                            continue;
+                        }
+
+                        param_t* row = covariance_.data() + i * numParams;
+
+                        const param_t path = c1_ * evolutionPath_[i];
+
+                        for ( size_t j = first; j < columnEnd; ++j )
+                        {
+                            row[j] = keep * row[j] + path * evolutionPath_[j];
+                        }
+
+                        for ( size_t k = 0; k < mu_; ++k )
+                        {
+                            coefficients[k] = cmu_ * weightedSteps_[k * numParams + i];
+                        }
+
+                        axpyRows( row + first, coefficients.data(), weightedSteps_.data() + first, numParams, mu_, columnEnd - first );
+                    }
+                }
+            }
+        } );
+    }
+
+
+    // Eigendecomposition of C into the rows of eigenvectors_ and the square roots of the eigenvalues
+    void decompose()
+    {
+        const size_t numParams = this->getNumParams();
+
+        // Mirror the upper triangle: the solver works on the full matrix
+        for ( size_t i = 0; i < numParams; ++i )
+        {
+            for ( size_t j = i + 1; j < numParams; ++j )
+            {
+                covariance_[j * numParams + i] = covariance_[i * numParams + j];
+            }
+        }
+
+        std::copy( covariance_.begin(), covariance_.end(), eigenvectors_.begin() );
+
+        param_t* eigenvalues = axisLengths_.data();
+
+        tridiagonalize( eigenvectors_.data(), eigenvalues, offdiagonal_.data(), numParams );
+        diagonalize( eigenvectors_.data(), eigenvalues, offdiagonal_.data(), numParams );
+
+        // Keeps the condition number of C below 1e14
+        const param_t largest  = *std::max_element( eigenvalues, eigenvalues + numParams );
+        const param_t smallest = *std::min_element( eigenvalues, eigenvalues + numParams );
+        const param_t floor    = largest * static_cast< param_t >( 1e-14 );
+
+        if ( smallest < floor )
+        {
+            const param_t shift = floor - smallest;
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                covariance_[j * numParams + j] += shift;
+                eigenvalues[j] += shift;
+            }
+        }
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            axisLengths_[j] = std::sqrt( eigenvalues[j] );
+        }
+    }
+
+
+    // Householder reduction of the symmetric matrix in v to tridiagonal form (EISPACK tred2, as in JAMA), with
+    // the transformations accumulated. v is addressed transposed, so the inner loops run along rows; on return
+    // row j of v is the j-th basis vector, d the diagonal and e the subdiagonal in e[1..n-1].
+    static void tridiagonalize( param_t* v, param_t* d, param_t* e, const size_t n )
+    {
+        const auto at = [v, n]( const size_t i, const size_t j ) -> param_t& { return v[j * n + i]; };
+
+        for ( size_t j = 0; j < n; ++j )
+        {
+            d[j] = at( n - 1, j );
+        }
+
+        for ( size_t i = n - 1; i > 0; --i )
+        {
+            param_t scale = 0;
+            param_t h     = 0;
+
+            for ( size_t k = 0; k < i; ++k )
+            {
+                scale += std::abs( d[k] );
+            }
+
+            if ( scale == 0 )
+            {
+                e[i] = d[i - 1];
+
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    d[j]        = at( i - 1, j );
+                    at( i, j )  = 0;
+                    at( j, i )  = 0;
+                }
+            }
+            else
+            {
+                for ( size_t k = 0; k < i; ++k )
+                {
+                    d[k] /= scale;
+                    h += d[k] * d[k];
+                }
+
+                param_t f = d[i - 1];
+                param_t g = std::sqrt( h );
+
+                if ( f > 0 )
+                {
+                    g = -g;
+                }
+
+                e[i]     = scale * g;
+                h        = h - f * g;
+                d[i - 1] = f - g;
+
+                std::fill( e, e + i, static_cast< param_t >( 0 ) );
+
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    f = d[j];
+                    at( j, i ) = f;
+                    g = e[j] + at( j, j ) * f;
+
+                    const param_t* column = v + j * n;
+
+                    for ( size_t k = j + 1; k < i; ++k )
+                    {
+                        e[k] += column[k] * f;
+                    }
+
+                    e[j] = g + dot( column + j + 1, d + j + 1, i - j - 1 );
+                }
+
+                f = 0;
+
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    e[j] /= h;
+                    f += e[j] * d[j];
+                }
+
+                const param_t hh = f / ( h + h );
+
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    e[j] -= hh * d[j];
+                }
+
+                for ( size_t j = 0; j < i; ++j )
+                {
+                    f = d[j];
+                    g = e[j];
+
+                    param_t* column = v + j * n;
+
+                    for ( size_t k = j; k < i; ++k )
+                    {
+                        column[k] -= f * e[k] + g * d[k];
+                    }
+
+                    d[j]       = at( i - 1, j );
+                    at( i, j ) = 0;
+                }
+            }
+
+            d[i] = h;
+        }
+
+        // Accumulate the transformations
+        for ( size_t i = 0; i + 1 < n; ++i )
+        {
+            at( n - 1, i ) = at( i, i );
+            at( i, i )     = 1;
+
+            const param_t h = d[i + 1];
+            param_t* next   = v + ( i + 1 ) * n;
+
+            if ( h != 0 )
+            {
+                for ( size_t k = 0; k <= i; ++k )
+                {
+                    d[k] = next[k] / h;
+                }
+
+                for ( size_t j = 0; j <= i; ++j )
+                {
+                    param_t* column = v + j * n;
+
+                    const param_t g = dot( next, column, i + 1 );
+
+                    for ( size_t k = 0; k <= i; ++k )
+                    {
+                        column[k] -= g * d[k];
+                    }
+                }
+            }
+
+            std::fill( next, next + i + 1, static_cast< param_t >( 0 ) );
+        }
+
+        for ( size_t j = 0; j < n; ++j )
+        {
+            d[j]           = at( n - 1, j );
+            at( n - 1, j ) = 0;
+        }
+
+        at( n - 1, n - 1 ) = 1;
+        e[0] = 0;
+    }
+
+
+    // Implicit QL iterations on the tridiagonal matrix (EISPACK tql2, as in JAMA). Leaves the eigenvalues in d and
+    // the eigenvectors in the rows of v; each rotation touches two contiguous rows.
+    static void diagonalize( param_t* v, param_t* d, param_t* e, const size_t n )
+    {
+        for ( size_t i = 1; i < n; ++i )
+        {
+            e[i - 1] = e[i];
+        }
+
+        e[n - 1] = 0;
+
+        const param_t eps = std::numeric_limits< param_t >::epsilon();
+
+        param_t f    = 0;
+        param_t tst1 = 0;
+
+        for ( size_t l = 0; l < n; ++l )
+        {
+            tst1 = std::max( tst1, std::abs( d[l] ) + std::abs( e[l] ) );
+
+            size_t m = l;
+
+            while ( m < n - 1 && std::abs( e[m] ) > eps * tst1 )
+            {
+                ++m;
+            }
+
+            if ( m > l )
+            {
+                do
+                {
+                    param_t g = d[l];
+                    param_t p = ( d[l + 1] - g ) / ( 2 * e[l] );
+                    param_t r = std::hypot( p, static_cast< param_t >( 1 ) );
+
+                    if ( p < 0 )
+                    {
+                        r = -r;
+                    }
+
+                    d[l]     = e[l] / ( p + r );
+                    d[l + 1] = e[l] * ( p + r );
+
+                    const param_t dl1 = d[l + 1];
+                    param_t h         = g - d[l];
+
+                    for ( size_t i = l + 2; i < n; ++i )
+                    {
+                        d[i] -= h;
+                    }
+
+                    f += h;
+
+                    p = d[m];
+
+                    param_t c   = 1;
+                    param_t c2  = c;
+                    param_t c3  = c;
+                    param_t el1 = e[l + 1];
+                    param_t s   = 0;
+                    param_t s2  = 0;
+
+                    for ( size_t i = m; i-- > l; )
+                    {
+                        c3 = c2;
+                        c2 = c;
+                        s2 = s;
+                        g  = c * e[i];
+                        h  = c * p;
+                        r  = std::hypot( p, e[i] );
+
+                        e[i + 1] = s * r;
+                        s        = e[i] / r;
+                        c        = p / r;
+                        p        = c * d[i] - s * g;
+                        d[i + 1] = h + s * ( c * g + s * d[i] );
+
+                        param_t* lower = v + i * n;
+                        param_t* upper = v + ( i + 1 ) * n;
+
+                        for ( size_t k = 0; k < n; ++k )
+                        {
+                            const param_t t = upper[k];
+                            upper[k] = s * lower[k] + c * t;
+                            lower[k] = c * lower[k] - s * t;
+                        }
+                    }
+
+                    p    = -s * s2 * c3 * el1 * e[l] / dl1;
+                    e[l] = s * p;
+                    d[l] = c * p;
+
+                } while ( std::abs( e[l] ) > eps * tst1 );
+            }
+
+            d[l] += f;
+            e[l] = 0;
+        }
+    }
+
+
+    static inline void axpy( param_t* __restrict y, const param_t a, const param_t* __restrict x, const size_t count )
+    {
+        for ( size_t j = 0; j < count; ++j )
+        {
+            y[j] += a * x[j];
+        }
+    }
+
+
+    // Four partial sums, so the reduction vectorizes without reassociation by the compiler
+    static inline param_t dot( const param_t* __restrict x, const param_t* __restrict y, const size_t count )
+    {
+        param_t sums[4] = { 0, 0, 0, 0 };
+
+        size_t j = 0;
+
+        for ( ; j + 4 <= count; j += 4 )
+        {
+            sums[0] += x[j] * y[j];
+            sums[1] += x[j + 1] * y[j + 1];
+            sums[2] += x[j + 2] * y[j + 2];
+            sums[3] += x[j + 3] * y[j + 3];
+        }
+
+        for ( ; j < count; ++j )
+        {
+            sums[0] += x[j] * y[j];
+        }
+
+        return ( sums[0] + sums[1] ) + ( sums[2] + sums[3] );
+    }
+
+
+    // y += sum_r a[r] x_r over numRows rows stride apart, four rows per pass so y is loaded and stored once per four
+    static inline void axpyRows( param_t* __restrict y, const param_t* __restrict a, const param_t* __restrict x, const size_t stride,
+                                 const size_t numRows, const size_t count )
+    {
+        size_t r = 0;
+
+        for ( ; r + 4 <= numRows; r += 4 )
+        {
+            const param_t* x0 = x + r * stride;
+            const param_t* x1 = x0 + stride;
+            const param_t* x2 = x1 + stride;
+            const param_t* x3 = x2 + stride;
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+                y[j] += a[r] * x0[j] + a[r + 1] * x1[j] + a[r + 2] * x2[j] + a[r + 3] * x3[j];
+            }
+        }
+
+        for ( ; r < numRows; ++r )
+        {
+            axpy( y, a[r], x + r * stride, count );
+        }
+    }
+
+
+    // x = clip( mean + sigma step ), and step rewritten as the step actually taken
+    static inline void placeOffspring( param_t* __restrict position, param_t* __restrict step, const param_t* __restrict mean,
+                                       const param_t* __restrict lowerBound, const param_t* __restrict upperBound, const size_t numParams,
+                                       const param_t sigma )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t x = std::min( std::max( mean[j] + sigma * step[j], lowerBound[j] ), upperBound[j] );
+
+            position[j] = x;
+            step[j]     = ( x - mean[j] ) / sigma;
+        }
+    }
+
+
+    param_t stepSizeFraction_;
+    param_t stepTolerance_;
+    uint64_t eigenInterval_;
+
+    // Strategy parameters, fixed by lambda and n
+    size_t mu_;
+    std::vector< param_t > weights_;
+    param_t muEff_;
+    param_t cc_;
+    param_t cs_;
+    param_t c1_;
+    param_t cmu_;
+    param_t damps_;
+    param_t chiN_;
+
+    // Distribution
+    param_t sigma_;
+    param_t initialSigma_;
+    uint64_t eigenGeneration_;
+
+    // Fitness of the last selected offspring of the previous generation, and its squared standard error
+    fitness_t selectionThreshold_;
+    fitness_t selectionError2_;
+
+    AlignedArray< param_t, NUM_PARAMS > mean_;
+    AlignedArray< param_t, NUM_PARAMS > evolutionPath_;
+    AlignedArray< param_t, NUM_PARAMS > conjugatePath_;
+    AlignedArray< param_t, NUM_PARAMS > axisLengths_;       // Square roots of the eigenvalues of C
+    AlignedArray< param_t, NUM_PARAMS > meanStep_;
+    AlignedArray< param_t, NUM_PARAMS > whitened_;
+    AlignedArray< param_t, NUM_PARAMS > projections_;
+    AlignedArray< param_t, NUM_PARAMS > offdiagonal_;
+
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > draws_;            // D z per offspring
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > steps_;            // y = B D z per offspring
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > weightedSteps_;
+
+    // n x n, too large for the arena: C, and the eigenvectors of C as rows
+    std::vector< param_t > covariance_;
+    std::vector< param_t > eigenvectors_;
+
+    std::vector< size_t > order_;
+
+
+    CMAES() = delete;
+    CMAES( const CMAES& ) = delete;
+    CMAES& operator=( const CMAES& ) = delete;
+
+}; // class CMAES
+
+} // namespace MetaOpt
+
+#endif // CMAES_H
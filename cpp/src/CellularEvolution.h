@@ -0,0 +1,363 @@
+#ifndef CELLULAR_EVOLUTION_H
+#define CELLULAR_EVOLUTION_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Cellular evolutionary algorithm. The particles sit on a rows x columns torus and only mate with their grid
+// neighbours, so good genes spread slowly and the population stays diverse on multimodal problems. Each cell
+// crosses with the fitter of two random neighbours (one-point crossover), mutates uniformly and keeps the offspring
+// if it is better. The update is synchronous and double buffered: offspring are built from the current grid into
+// a second one and only replace their parents once the whole generation is evaluated, so neighbourhood reads never
+// race with writes and the result does not depend on the number of threads.
+//
+// Particles are stored tile by tile, each tile a square block of the grid sized to stay in cache together with its
+// offspring; the thread pool hands out whole tiles, so neighbourhood reads stay within the tile or its border.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class CellularEvolution : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    enum class Neighbourhood
+    {
+        VON_NEUMANN,    // North, south, west and east
+        MOORE           // The eight surrounding cells
+    };
+
+
+    static constexpr size_t  NUM_PARTICLES         = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS            = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_MUTATION_RATE = 0.1;
+    static constexpr size_t  TILE_BYTES            = 64u * 1024u;   // Positions of one tile, its offspring take as much again
+
+
+    // Constructor
+    CellularEvolution( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : CellularEvolution( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time. The grid starts as the squarest rows x columns = numParticles.
+    CellularEvolution( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                       const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , mutationRate_{ DEFAULT_MUTATION_RATE }
+        , rows_{ 0u }
+        , columns_{ 0u }
+        , tileSize_{ 0u }
+        , neighbourhood_{ Neighbourhood::VON_NEUMANN }
+        , trials_{ numParticles, numParams, this->arena_ }
+        , mutationDraws_{ numParticles * numParams, this->arena_ }
+        , cells_( numParticles )
+        , neighbours_{}
+        , tileStarts_{}
+    {
+        size_t rows = static_cast< size_t >( std::sqrt( static_cast< double >( numParticles ) ) );
+
+        while ( numParticles % rows != 0 )
+        {
+            --rows;
+        }
+
+        setGrid( rows, numParticles / rows );
+    }
+
+    // Destructor
+    virtual ~CellularEvolution() {}
+
+
+    // Offspring genes move by up to mutationRate times half the width of the bounds
+    void setMutationRate( const param_t mutationRate ) { mutationRate_ = mutationRate; }
+
+
+    // rows * columns must equal the number of particles. Resets the layout, so it is set before run().
+    void setGrid( const size_t rows, const size_t columns )
+    {
+        if ( rows == 0 || columns == 0 || rows * columns != this->getNumParticles() )
+        {
+            throw std::invalid_argument( "CellularEvolution::setGrid: rows * columns must equal the number of particles" );
+        }
+
+        rows_    = rows;
+        columns_ = columns;
+
+        buildLayout();
+    }
+
+
+    // Cells per tile side; 0 sizes tiles to TILE_BYTES of positions
+    void setTileSize( const size_t tileSize )
+    {
+        tileSize_ = tileSize;
+
+        buildLayout();
+    }
+
+
+    void setNeighbourhood( const Neighbourhood neighbourhood )
+    {
+        neighbourhood_ = neighbourhood;
+
+        buildLayout();
+    }
+
+
+    size_t getRows() const { return rows_; }
+    size_t getColumns() const { return columns_; }
+    size_t getNumTiles() const { return tileStarts_.size() - 1; }
+
+    // Index of the particle at a grid cell, e.g. to read the grid through getPopulation()
+    size_t getCell( const size_t row, const size_t column ) const { return cells_[row * columns_ + column]; }
+
+
+protected:
+
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams        = this->getNumParams();
+        const size_t numNeighbours    = getNumNeighbours();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            // Binary tournament among the neighbours
+            const uint32_t* neighbours = neighbours_.data() + i * numNeighbours;
+
+            const uint32_t first  = neighbours[rng.drawUniformInt< size_t >( 0u, numNeighbours - 1 )];
+            const uint32_t second = neighbours[rng.drawUniformInt< size_t >( 0u, numNeighbours - 1 )];
+            const uint32_t mate   = this->population_.fitness( second ) < this->population_.fitness( first ) ? second : first;
+
+            const size_t cut = rng.drawUniformInt< size_t >( 0u, numParams - 1 );
+
+            param_t* mutationDraws = mutationDraws_.data() + i * numParams;
+
+            rng.fillUniform( mutationDraws, numParams, static_cast< param_t >( -1 ), static_cast< param_t >( 1 ) );
+
+            breed( trials_.position( i ), this->population_.position( i ), this->population_.position( mate ), mutationDraws,
+                   this->lowerBound_.data(), this->upperBound_.data(), numParams, cut, mutationRate_ );
+        }
+    }
+
+
+    // One-point crossover at cut, uniform mutation and clipping of one offspring
+    static inline void breed( param_t* __restrict offspring, const param_t* __restrict parent, const param_t* __restrict mate,
+                              const param_t* __restrict mutationDraws, const param_t* __restrict lowerBound, const param_t* __restrict upperBound,
+                              const size_t numParams, const size_t cut, const param_t mutationRate )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t gene    = j < cut ? parent[j] : mate[j];
+            const param_t mutated = gene + mutationRate * static_cast< param_t >( 0.5 ) * ( upperBound[j] - lowerBound[j] ) * mutationDraws[j];
+
+            offspring[j] = std::min( std::max( mutated, lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    population_t& getCandidates() override { return trials_; }
+
+
+    // Offspring replace their parents only after the whole grid is evaluated
+    void selectBlock( const size_t begin, const size_t end ) override
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( trials_.fitness( i ) < this->population_.fitness( i ) )
+            {
+                this->population_.copyParticle( i, trials_, i );
+            }
+        }
+    }
+
+
+    // Same two passes as the base class, over whole tiles instead of arbitrary chunks
+    void updateParticles() override
+    {
+        forEachTile( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::UPDATE, worker );
+
+                updateBlock( begin, end );
+            }
+
+            this->evaluateRange( trials_, begin, end, worker );
+        } );
+
+        forEachTile( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+            selectBlock( begin, end );
+        } );
+    }
+
+
+    const char* getSnapshotTag() const override { return "CellularEvolution"; }
+
+
+    // The grid decides which particle is where, so a snapshot only resumes on the same layout
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( mutationRate_ );
+        writer.write( static_cast< uint64_t >( rows_ ) );
+        writer.write( static_cast< uint64_t >( columns_ ) );
+        writer.write( static_cast< uint64_t >( getTileSide() ) );
+        writer.write( static_cast< uint32_t >( neighbourhood_ ) );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        mutationRate_ = reader.read< param_t >();
+
+        const uint64_t rows          = reader.read< uint64_t >();
+        const uint64_t columns       = reader.read< uint64_t >();
+        const uint64_t tileSide      = reader.read< uint64_t >();
+        const uint32_t neighbourhood = reader.read< uint32_t >();
+
+        if ( rows != rows_ || columns != columns_ || tileSide != getTileSide() || neighbourhood != static_cast< uint32_t >( neighbourhood_ ) )
+        {
+            throw std::runtime_error( "CellularEvolution::loadState: snapshot was taken with a different grid layout" );
+        }
+    }
+
+
+private:
+
+    size_t getNumNeighbours() const { return neighbourhood_ == Neighbourhood::MOORE ? 8u : 4u; }
+
+
+    size_t getTileSide() const
+    {
+        if ( tileSize_ > 0 )
+        {
+            return tileSize_;
+        }
+
+        const size_t cells = std::max< size_t >( TILE_BYTES / ( this->getNumParams() * sizeof( param_t ) ), 1u );
+
+        return std::max< size_t >( static_cast< size_t >( std::sqrt( static_cast< double >( cells ) ) ), 1u );
+    }
+
+
+    // Assigns particle indices tile by tile, row-major within a tile, and resolves every neighbourhood to indices
+    void buildLayout()
+    {
+        const size_t side          = getTileSide();
+        const size_t numNeighbours = getNumNeighbours();
+
+        tileStarts_.clear();
+
+        size_t next = 0;
+
+        for ( size_t tileRow = 0; tileRow < rows_; tileRow += side )
+        {
+            for ( size_t tileColumn = 0; tileColumn < columns_; tileColumn += side )
+            {
+                tileStarts_.push_back( next );
+
+                for ( size_t row = tileRow; row < std::min( tileRow + side, rows_ ); ++row )
+                {
+                    for ( size_t column = tileColumn; column < std::min( tileColumn + side, columns_ ); ++column )
+                    {
+                        cells_[row * columns_ + column] = next++;
+                    }
+                }
+            }
+        }
+
+        tileStarts_.push_back( next );
+
+        static constexpr int OFFSETS[8][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 } };
+
+        neighbours_.resize( this->getNumParticles() * numNeighbours );
+
+        for ( size_t row = 0; row < rows_; ++row )
+        {
+            for ( size_t column = 0; column < columns_; ++column )
+            {
+                uint32_t* neighbours = neighbours_.data() + cells_[row * columns_ + column] * numNeighbours;
+
+                for ( size_t k = 0; k < numNeighbours; ++k )
+                {
+                    const size_t neighbourRow    = ( row + rows_ + OFFSETS[k][0] ) % rows_;
+                    const size_t neighbourColumn = ( column + columns_ + OFFSETS[k][1] ) % columns_;
+
+                    neighbours[k] = static_cast< uint32_t >( cells_[neighbourRow * columns_ + neighbourColumn] );
+                }
+            }
+        }
+    }
+
+
+    // Runs func( begin, end, worker ) over runs of whole tiles on the thread pool
+    template< typename Func >
+    void forEachTile( Func&& func )
+    {
+        if ( !this->threadingEnabled_ )
+        {
+            func( 0, this->getNumParticles(), 0 );
+            return;
+        }
+
+        // The grain set with setChunking counts particles; it is rounded to tiles
+        const size_t tileCells = getTileSide() * getTileSide();
+        const size_t grain     = this->grainSize_ > 0 ? std::max< size_t >( ( this->grainSize_ + tileCells - 1 ) / tileCells, 1u ) : 0u;
+
+        this->profiler_.beginLoop();
+
+        this->threadPool_.parallelFor( 0, getNumTiles(), grain, [this, &func]( const size_t tileBegin, const size_t tileEnd, const size_t worker )
+        {
+            func( tileStarts_[tileBegin], tileStarts_[tileEnd], worker );
+        }, this->schedule_ );
+
+        this->profiler_.endLoop();
+    }
+
+
+    param_t mutationRate_;
+
+    size_t rows_;
+    size_t columns_;
+    size_t tileSize_;
+    Neighbourhood neighbourhood_;
+
+    population_t trials_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > mutationDraws_;
+
+    std::vector< size_t > cells_;           // Particle index of every cell, row-major over the grid
+    std::vector< uint32_t > neighbours_;    // getNumNeighbours() particle indices per particle
+    std::vector< size_t > tileStarts_;      // First particle of every tile, then the number of particles
+
+
+    CellularEvolution() = delete;
+    CellularEvolution( const CellularEvolution& ) = delete;
+    CellularEvolution& operator=( const CellularEvolution& ) = delete;
+
+}; // class CellularEvolution
+
+} // namespace MetaOpt
+
+#endif // CELLULAR_EVOLUTION_H
@@ -0,0 +1,321 @@
+#include "Checkpoint.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace MetaOpt
+{
+
+uint64_t snapshotChecksum( const std::byte* data, const size_t size )
+{
+    constexpr uint64_t OFFSET_BASIS = 0xCBF29CE484222325ull;
+    constexpr uint64_t PRIME        = 0x100000001B3ull;
+
+    uint64_t hash = OFFSET_BASIS;
+    size_t i = 0;
+
+    for ( ; i + 8 <= size; i += 8 )
+    {
+        uint64_t word;
+        std::memcpy( &word, data + i, 8 );
+
+        hash = ( hash ^ word ) * PRIME;
+    }
+
+    for ( ; i < size; ++i )
+    {
+        hash = ( hash ^ static_cast< uint64_t >( data[i] ) ) * PRIME;
+    }
+
+    return hash;
+}
+
+
+
+void SnapshotWriter::begin( const char* algorithm, const uint64_t numParticles, const uint64_t numParams, const uint32_t paramSize, const uint32_t fitnessSize )
+{
+    SnapshotHeader header{};
+
+    std::memcpy( header.magic, SnapshotHeader::MAGIC, sizeof( header.magic ) );
+    std::strncpy( header.algorithm, algorithm, SnapshotHeader::TAG_SIZE - 1 );
+
+    header.version      = SnapshotHeader::VERSION;
+    header.headerSize   = sizeof( SnapshotHeader );
+    header.numParticles = numParticles;
+    header.numParams    = numParams;
+    header.paramSize    = paramSize;
+    header.fitnessSize  = fitnessSize;
+
+    buffer_.clear();
+
+    write( header );
+}
+
+
+void SnapshotWriter::finish()
+{
+    SnapshotHeader header;
+    std::memcpy( &header, buffer_.data(), sizeof( SnapshotHeader ) );
+
+    header.payloadSize = buffer_.size() - sizeof( SnapshotHeader );
+    header.checksum    = snapshotChecksum( buffer_.data() + sizeof( SnapshotHeader ), header.payloadSize );
+
+    std::memcpy( buffer_.data(), &header, sizeof( SnapshotHeader ) );
+}
+
+
+
+MappedSnapshot::MappedSnapshot( const std::string& path )
+    : path_{ path }
+    , data_{ nullptr }
+    , size_{ 0u }
+{
+    const int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+    if ( fd < 0 )
+    {
+        throw std::system_error( errno, std::generic_category(), "MappedSnapshot::MappedSnapshot: cannot open " + path );
+    }
+
+    struct stat status;
+
+    if ( fstat( fd, &status ) != 0 || static_cast< size_t >( status.st_size ) < sizeof( SnapshotHeader ) )
+    {
+        close( fd );
+        throw std::runtime_error( "MappedSnapshot::MappedSnapshot: " + path + " is not a snapshot" );
+    }
+
+    size_ = static_cast< size_t >( status.st_size );
+
+    void* mapping = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    close( fd );
+
+    if ( mapping == MAP_FAILED )
+    {
+        throw std::system_error( errno, std::generic_category(), "MappedSnapshot::MappedSnapshot: cannot map " + path );
+    }
+
+    data_ = static_cast< const std::byte* >( mapping );
+
+    // Read front to back once, for the checksum
+    madvise( mapping, size_, MADV_SEQUENTIAL );
+
+    const SnapshotHeader& header = getHeader();
+
+    const char* problem = nullptr;
+
+    if ( std::memcmp( header.magic, SnapshotHeader::MAGIC, sizeof( header.magic ) ) != 0 )
+    {
+        problem = " is not a snapshot";
+    }
+    else if ( header.version != SnapshotHeader::VERSION || header.headerSize != sizeof( SnapshotHeader ) )
+    {
+        problem = " has an unsupported snapshot version";
+    }
+    else if ( header.payloadSize != size_ - sizeof( SnapshotHeader ) )
+    {
+        problem = " is truncated";
+    }
+    else if ( header.checksum != snapshotChecksum( data_ + sizeof( SnapshotHeader ), header.payloadSize ) )
+    {
+        problem = " fails its checksum";
+    }
+
+    if ( problem )
+    {
+        munmap( mapping, size_ );
+        throw std::runtime_error( "MappedSnapshot::MappedSnapshot: " + path + problem );
+    }
+}
+
+
+MappedSnapshot::~MappedSnapshot()
+{
+    munmap( const_cast< std::byte* >( data_ ), size_ );
+}
+
+
+
+CheckpointWriter::CheckpointWriter()
+    : mtx_{}
+    , cv_{}
+    , pendingPath_{}
+    , pending_{}
+    , writing_{}
+    , hasPending_{ false }
+    , busy_{ false }
+    , stop_{ false }
+    , numWritten_{ 0u }
+    , error_{ nullptr }
+    , thread_{}
+{
+    thread_ = std::thread( &CheckpointWriter::loop, this );
+}
+
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::unique_lock< std::mutex > lock( mtx_ );
+
+        // Whatever is still pending gets written before the thread exits
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+    thread_.join();
+}
+
+
+void CheckpointWriter::submit( const std::string& path, std::vector< std::byte >& buffer )
+{
+    {
+        std::unique_lock< std::mutex > lock( mtx_ );
+
+        rethrowError();
+
+        pendingPath_ = path;
+        pending_.swap( buffer );
+        hasPending_ = true;
+    }
+
+    cv_.notify_all();
+}
+
+
+void CheckpointWriter::flush()
+{
+    std::unique_lock< std::mutex > lock( mtx_ );
+
+    cv_.wait( lock, [this] { return !hasPending_ && !busy_; } );
+
+    rethrowError();
+}
+
+
+uint64_t CheckpointWriter::getNumWritten() const
+{
+    std::unique_lock< std::mutex > lock( mtx_ );
+
+    return numWritten_;
+}
+
+
+void CheckpointWriter::writeFile( const std::string& path, const std::vector< std::byte >& buffer )
+{
+    const std::string tmpPath = path + ".tmp";
+
+    const int fd = open( tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+    if ( fd < 0 )
+    {
+        throw std::system_error( errno, std::generic_category(), "CheckpointWriter::writeFile: cannot create " + tmpPath );
+    }
+
+    size_t written = 0;
+
+    while ( written < buffer.size() )
+    {
+        const ssize_t n = ::write( fd, buffer.data() + written, buffer.size() - written );
+
+        if ( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( n <= 0 )
+        {
+            const int error = errno;
+            close( fd );
+            unlink( tmpPath.c_str() );
+            throw std::system_error( error, std::generic_category(), "CheckpointWriter::writeFile: cannot write " + tmpPath );
+        }
+
+        written += static_cast< size_t >( n );
+    }
+
+    // The data must be durable before the rename makes it visible under the final name
+    if ( fsync( fd ) != 0 || close( fd ) != 0 )
+    {
+        const int error = errno;
+        unlink( tmpPath.c_str() );
+        throw std::system_error( error, std::generic_category(), "CheckpointWriter::writeFile: cannot sync " + tmpPath );
+    }
+
+    if ( rename( tmpPath.c_str(), path.c_str() ) != 0 )
+    {
+        const int error = errno;
+        unlink( tmpPath.c_str() );
+        throw std::system_error( error, std::generic_category(), "CheckpointWriter::writeFile: cannot rename to " + path );
+    }
+}
+
+
+void CheckpointWriter::loop()
+{
+    std::unique_lock< std::mutex > lock( mtx_ );
+
+    while ( true )
+    {
+        cv_.wait( lock, [this] { return hasPending_ || stop_; } );
+
+        if ( !hasPending_ )
+        {
+            return;
+        }
+
+        const std::string path = pendingPath_;
+        writing_.swap( pending_ );
+        hasPending_ = false;
+        busy_       = true;
+
+        lock.unlock();
+
+        std::exception_ptr error = nullptr;
+
+        try
+        {
+            writeFile( path, writing_ );
+        }
+        catch ( ... )
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+
+        busy_ = false;
+
+        if ( error )
+        {
+            error_ = error;
+        }
+        else
+        {
+            ++numWritten_;
+        }
+
+        cv_.notify_all();
+    }
+}
+
+
+void CheckpointWriter::rethrowError()
+{
+    if ( error_ )
+    {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+
+        std::rethrow_exception( error );
+    }
+}
+
+} // namespace MetaOpt
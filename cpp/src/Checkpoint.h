@@ -0,0 +1,240 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Fixed-size header in front of every snapshot. The payload is a flat sequence of fields and arrays in the
+// order the algorithm wrote them, each starting on an 8-byte boundary; its layout is identified by version.
+struct SnapshotHeader
+{
+    static constexpr char     MAGIC[8] = { 'M', 'E', 'T', 'A', 'O', 'P', 'T', 'S' };
+    static constexpr uint32_t VERSION  = 2u;
+    static constexpr size_t   TAG_SIZE = 32;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    char algorithm[TAG_SIZE];
+    uint64_t numParticles;
+    uint64_t numParams;
+    uint32_t paramSize;
+    uint32_t fitnessSize;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+static_assert( std::is_trivially_copyable_v< SnapshotHeader > && sizeof( SnapshotHeader ) % 8 == 0, "Header must be written as is" );
+
+
+// 64-bit FNV-1a over 8-byte words, tail bytes folded in one at a time
+uint64_t snapshotChecksum( const std::byte* data, const size_t size );
+
+
+
+// Serializes one snapshot into a reusable in-memory buffer
+class SnapshotWriter
+{
+public:
+
+    SnapshotWriter() = default;
+
+
+    // Drops the previous contents, keeping the capacity, and starts a snapshot with a placeholder header
+    void begin( const char* algorithm, const uint64_t numParticles, const uint64_t numParams, const uint32_t paramSize, const uint32_t fitnessSize );
+
+
+    template< typename T >
+    void write( const T& value )
+    {
+        writeArray( &value, 1u );
+    }
+
+
+    template< typename T >
+    void writeArray( const T* data, const size_t count )
+    {
+        static_assert( std::is_trivially_copyable_v< T >, "Only trivially copyable types can be written" );
+
+        const size_t offset = buffer_.size();
+        const size_t bytes  = count * sizeof( T );
+
+        buffer_.resize( offset + ( ( bytes + 7u ) & ~size_t{ 7u } ) );
+
+        if ( bytes > 0 )
+        {
+            std::memcpy( buffer_.data() + offset, data, bytes );
+        }
+    }
+
+
+    // Fills in payload size and checksum; the buffer then holds the complete file
+    void finish();
+
+
+    std::vector< std::byte >& getBuffer() { return buffer_; }
+
+
+private:
+
+    std::vector< std::byte > buffer_;
+
+}; // class SnapshotWriter
+
+
+
+// Reads back the fields of a payload in the order they were written
+class SnapshotReader
+{
+public:
+
+    SnapshotReader( const std::byte* data, const size_t size )
+        : data_{ data }
+        , size_{ size }
+        , offset_{ 0u }
+    {
+    }
+
+
+    template< typename T >
+    T read()
+    {
+        T value;
+        readArray( &value, 1u );
+        return value;
+    }
+
+
+    template< typename T >
+    void readArray( T* out, const size_t count )
+    {
+        static_assert( std::is_trivially_copyable_v< T >, "Only trivially copyable types can be read" );
+
+        const size_t bytes = count * sizeof( T );
+
+        if ( bytes > size_ - offset_ )
+        {
+            throw std::runtime_error( "SnapshotReader::readArray: snapshot is truncated" );
+        }
+
+        if ( bytes > 0 )
+        {
+            std::memcpy( out, data_ + offset_, bytes );
+        }
+
+        offset_ = std::min( size_, offset_ + ( ( bytes + 7u ) & ~size_t{ 7u } ) );
+    }
+
+
+private:
+
+    const std::byte* data_;
+    size_t size_;
+    size_t offset_;
+
+}; // class SnapshotReader
+
+
+
+// Snapshot file mapped read-only. The header and checksum are validated on construction.
+class MappedSnapshot
+{
+public:
+
+    explicit MappedSnapshot( const std::string& path );
+
+    ~MappedSnapshot();
+
+
+    const SnapshotHeader& getHeader() const { return *reinterpret_cast< const SnapshotHeader* >( data_ ); }
+
+    SnapshotReader getReader() const { return SnapshotReader( data_ + sizeof( SnapshotHeader ), getHeader().payloadSize ); }
+
+    const std::string& getPath() const { return path_; }
+
+
+private:
+
+    std::string path_;
+    const std::byte* data_;
+    size_t size_;
+
+
+    MappedSnapshot( const MappedSnapshot& ) = delete;
+    MappedSnapshot& operator=( const MappedSnapshot& ) = delete;
+
+}; // class MappedSnapshot
+
+
+
+// Writes snapshots on a background thread: to path.tmp, fsync, then rename over path, so the file at path is
+// always a complete snapshot. A snapshot submitted while another is waiting replaces it; only the latest one
+// matters. Buffers are swapped rather than copied and keep their capacity.
+class CheckpointWriter
+{
+public:
+
+    CheckpointWriter();
+
+    ~CheckpointWriter();
+
+
+    // Takes the contents of buffer and hands back an unused one. Rethrows the error of an earlier failed write.
+    void submit( const std::string& path, std::vector< std::byte >& buffer );
+
+    // Waits until everything submitted is on disk. Rethrows the error of a failed write.
+    void flush();
+
+
+    uint64_t getNumWritten() const;
+
+
+    // Atomic write of a finished snapshot on the calling thread
+    static void writeFile( const std::string& path, const std::vector< std::byte >& buffer );
+
+
+private:
+
+    void loop();
+
+    void rethrowError();
+
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+
+    std::string pendingPath_;
+    std::vector< std::byte > pending_;
+    std::vector< std::byte > writing_;
+
+    bool hasPending_;
+    bool busy_;
+    bool stop_;
+    uint64_t numWritten_;
+    std::exception_ptr error_;
+
+    std::thread thread_;
+
+
+    CheckpointWriter( const CheckpointWriter& ) = delete;
+    CheckpointWriter& operator=( const CheckpointWriter& ) = delete;
+
+}; // class CheckpointWriter
+
+} // namespace MetaOpt
+
+#endif // CHECKPOINT_H
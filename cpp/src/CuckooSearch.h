@@ -0,0 +1,226 @@
+#ifndef CUCKOO_SEARCH_H
+#define CUCKOO_SEARCH_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+#include "Sampling.h"
+
+
+namespace MetaOpt
+{
+
+// Cuckoo search (Yang and Deb). Every generation has two greedy passes over the nests, each building one egg per
+// nest, evaluating all eggs on the thread pool and keeping those better than their nest:
+//  - Lévy flights: egg = nest + stepScale L ( nest_r1 - nest_r2 ), with a Lévy step L per parameter drawn in bulk.
+//  - Abandonment: each parameter of the nest is re-initialized uniformly within the bounds with probability
+//    abandonmentRate, applied as a mask so the loop has no branches. A rate of 0 skips the pass.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class CuckooSearch : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    static constexpr size_t  NUM_PARTICLES            = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS               = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_STEP_SCALE       = 0.1;
+    static constexpr param_t DEFAULT_ABANDONMENT_RATE = 0.25;
+
+
+    // Constructor
+    CuckooSearch( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : CuckooSearch( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    CuckooSearch( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                  const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , stepScale_{ DEFAULT_STEP_SCALE }
+        , abandonmentRate_{ DEFAULT_ABANDONMENT_RATE }
+        , levy_{}
+        , trials_{ numParticles, numParams, this->arena_ }
+        , steps_{ numParticles * numParams, this->arena_ }
+        , resets_{ numParticles * numParams, this->arena_ }
+    {
+        if ( numParticles < 3 )
+        {
+            throw std::invalid_argument( "CuckooSearch::CuckooSearch: at least 3 nests are needed" );
+        }
+    }
+
+    // Destructor
+    virtual ~CuckooSearch() {}
+
+
+    void setStepScale( const param_t stepScale )             { stepScale_ = stepScale; }
+    void setAbandonmentRate( const param_t abandonmentRate ) { abandonmentRate_ = abandonmentRate; }
+
+    // Index of the Lévy distribution, in (0, 2]
+    void setLevyExponent( const double beta ) { levy_ = MantegnaLevy( beta ); }
+
+
+protected:
+
+    // Lévy flights of nests [begin, end)
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            uint others[2];
+            rng.choice( others, static_cast< uint >( this->getNumParticles() ), false );
+
+            param_t* steps = steps_.data() + i * numParams;
+
+            rng.fillLevy( steps, numParams, levy_ );
+
+            flyParticle( trials_.position( i ), this->population_.position( i ), this->population_.position( others[0] ),
+                         this->population_.position( others[1] ), steps, this->lowerBound_.data(), this->upperBound_.data(), numParams, stepScale_ );
+        }
+    }
+
+
+    static inline void flyParticle( param_t* __restrict egg, const param_t* __restrict nest, const param_t* __restrict other0,
+                                    const param_t* __restrict other1, const param_t* __restrict steps, const param_t* __restrict lowerBound,
+                                    const param_t* __restrict upperBound, const size_t numParams, const param_t stepScale )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t moved = nest[j] + stepScale * steps[j] * ( other0[j] - other1[j] );
+
+            egg[j] = std::min( std::max( moved, lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    // Abandonment of nests [begin, end): one mask draw and one uniform draw per parameter
+    void abandonBlock( const size_t begin, const size_t end )
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            param_t* masks  = steps_.data() + i * numParams;
+            param_t* resets = resets_.data() + i * numParams;
+
+            rng.fillUniform( masks, numParams );
+            rng.fillUniform( resets, numParams );
+
+            abandonParticle( trials_.position( i ), this->population_.position( i ), masks, resets, this->lowerBound_.data(),
+                             this->upperBound_.data(), numParams, abandonmentRate_ );
+        }
+    }
+
+
+    static inline void abandonParticle( param_t* __restrict egg, const param_t* __restrict nest, const param_t* __restrict masks,
+                                        const param_t* __restrict resets, const param_t* __restrict lowerBound, const param_t* __restrict upperBound,
+                                        const size_t numParams, const param_t abandonmentRate )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t fresh = lowerBound[j] + ( upperBound[j] - lowerBound[j] ) * resets[j];
+
+            egg[j] = masks[j] < abandonmentRate ? fresh : nest[j];
+        }
+    }
+
+
+    population_t& getCandidates() override { return trials_; }
+
+
+    // Eggs replace their nests once the whole pass is evaluated, so the nests read by the flights stay put
+    void selectBlock( const size_t begin, const size_t end ) override
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( trials_.fitness( i ) < this->population_.fitness( i ) )
+            {
+                this->population_.copyParticle( i, trials_, i );
+            }
+        }
+    }
+
+
+    void updateParticles() override
+    {
+        Base::updateParticles();
+
+        if ( abandonmentRate_ <= 0 )
+        {
+            return;
+        }
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::UPDATE, worker );
+
+                abandonBlock( begin, end );
+            }
+
+            this->evaluateRange( trials_, begin, end, worker );
+        } );
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+            selectBlock( begin, end );
+        } );
+    }
+
+
+    const char* getSnapshotTag() const override { return "CuckooSearch"; }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( stepScale_ );
+        writer.write( abandonmentRate_ );
+        writer.write( levy_.getBeta() );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        stepScale_       = reader.read< param_t >();
+        abandonmentRate_ = reader.read< param_t >();
+        levy_            = MantegnaLevy( reader.read< double >() );
+    }
+
+
+private:
+
+    param_t stepScale_;
+    param_t abandonmentRate_;
+    MantegnaLevy levy_;
+
+    population_t trials_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > steps_;     // Lévy steps, then abandonment masks
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > resets_;
+
+
+    CuckooSearch() = delete;
+    CuckooSearch( const CuckooSearch& ) = delete;
+    CuckooSearch& operator=( const CuckooSearch& ) = delete;
+
+}; // class CuckooSearch
+
+} // namespace MetaOpt
+
+#endif // CUCKOO_SEARCH_H
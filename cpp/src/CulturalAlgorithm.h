@@ -0,0 +1,429 @@
+#ifndef CULTURAL_ALGORITHM_H
+#define CULTURAL_ALGORITHM_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Cultural algorithm (Reynolds). A belief space is kept beside the population:
+//  - normative knowledge: per-parameter bounds of the accepted individuals, the best acceptanceRatio of the population;
+//  - situational knowledge: the best individual seen so far.
+// Every generation the belief space is rebuilt from the accepted individuals by a parallel reduction and published,
+// then every particle builds one candidate: each parameter is, with probability influenceRate, taken from the belief
+// space (around the situational best or uniformly within the normative bounds, equally likely), otherwise mutated
+// from the particle. Both kinds of step scale with the normative width, floored at minStepWidth of the bounds.
+// Candidates replace their particles when better.
+//
+// The belief space is double-buffered under a version counter. A new one is built in the buffer not in use and
+// published by bumping the version, so the workers read a consistent snapshot without taking a lock.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class CulturalAlgorithm : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    static constexpr size_t  NUM_PARTICLES            = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS               = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_ACCEPTANCE_RATIO = 0.2;
+    static constexpr param_t DEFAULT_INFLUENCE_RATE   = 0.5;
+    static constexpr param_t DEFAULT_MUTATION_RATE    = 0.1;      // Fraction of the width of the normative bounds
+    static constexpr param_t DEFAULT_SITUATIONAL_STEP = 0.3;      // Fraction of the width of the normative bounds
+    static constexpr param_t DEFAULT_MIN_STEP_WIDTH   = 1e-3;     // Fraction of the width of the bounds
+
+
+    // Belief space as published to the workers
+    struct BeliefSpace
+    {
+        std::vector< param_t > lower;           // Normative bounds
+        std::vector< param_t > upper;
+        std::vector< param_t > situational;     // Best individual
+        fitness_t situationalFitness;
+        uint64_t version;
+    };
+
+
+    // Constructor
+    CulturalAlgorithm( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : CulturalAlgorithm( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    CulturalAlgorithm( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                       const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , acceptanceRatio_{ DEFAULT_ACCEPTANCE_RATIO }
+        , influenceRate_{ DEFAULT_INFLUENCE_RATE }
+        , mutationRate_{ DEFAULT_MUTATION_RATE }
+        , situationalStep_{ DEFAULT_SITUATIONAL_STEP }
+        , minStepWidth_{ DEFAULT_MIN_STEP_WIDTH }
+        , beliefs_{ makeBeliefSpace( numParams ), makeBeliefSpace( numParams ) }
+        , version_{ 0u }
+        , partials_( std::max( numThreads, 1 ), Partial{ std::vector< param_t >( numParams ), std::vector< param_t >( numParams ), NONE } )
+        , accepted_( numParticles )
+        , trials_{ numParticles, numParams, this->arena_ }
+        , draws_{ 3 * numParticles * numParams, this->arena_ }
+        , normals_{ numParticles * numParams, this->arena_ }
+    {
+    }
+
+    // Destructor
+    virtual ~CulturalAlgorithm() {}
+
+
+    // Fraction of the population, the best, that shapes the belief space; at least two individuals are accepted, so
+    // the normative bounds have a width from the first generation
+    void setAcceptanceRatio( const param_t acceptanceRatio )
+    {
+        if ( !( acceptanceRatio > 0 && acceptanceRatio <= 1 ) )
+        {
+            throw std::invalid_argument( "CulturalAlgorithm::setAcceptanceRatio: the ratio must be in (0, 1]" );
+        }
+
+        acceptanceRatio_ = acceptanceRatio;
+    }
+
+    void setInfluenceRate( const param_t influenceRate ) { influenceRate_ = influenceRate; }
+
+    // Largest mutation, and standard deviation of the steps around the situational best, as fractions of the width
+    // of the normative bounds, so both shrink as the accepted individuals converge
+    void setMutationRate( const param_t mutationRate )       { mutationRate_ = mutationRate; }
+    void setSituationalStep( const param_t situationalStep ) { situationalStep_ = situationalStep; }
+
+    // Floor of the width the steps are scaled by, as a fraction of the width of the bounds. The accepted individuals
+    // tend to agree long before the optimum is reached in small populations, and without the floor their width, and
+    // every step with it, shrinks to nothing. It also bounds the precision reached; 0 lifts it.
+    void setMinStepWidth( const param_t minStepWidth )       { minStepWidth_ = minStepWidth; }
+
+
+    // Belief space last published, safe to read between runs and from observers
+    const BeliefSpace& getBeliefSpace() const { return readBeliefs(); }
+
+
+protected:
+
+    void postInitialize() override
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( BeliefSpace& beliefs : beliefs_ )
+        {
+            std::copy( this->lowerBound_.data(), this->lowerBound_.data() + numParams, beliefs.lower.begin() );
+            std::copy( this->upperBound_.data(), this->upperBound_.data() + numParams, beliefs.upper.begin() );
+
+            beliefs.situationalFitness = std::numeric_limits< fitness_t >::max();
+            beliefs.version            = 0u;
+        }
+
+        version_.store( 0u, std::memory_order_relaxed );
+    }
+
+
+    // Candidates of particles [begin, end), influenced by the belief space published for this generation
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams    = this->getNumParams();
+        const BeliefSpace& belief = readBeliefs();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            param_t* draws   = draws_.data() + 3 * i * numParams;
+            param_t* normals = normals_.data() + i * numParams;
+
+            rng.fillUniform( draws, 3 * numParams );
+            rng.fillNormal( normals, numParams );
+
+            influenceParticle( trials_.position( i ), this->population_.position( i ), belief.lower.data(), belief.upper.data(), belief.situational.data(),
+                               draws, draws + numParams, draws + 2 * numParams, normals, this->lowerBound_.data(), this->upperBound_.data(), numParams,
+                               influenceRate_, mutationRate_, situationalStep_, minStepWidth_ );
+        }
+    }
+
+
+    // All three sources computed and one selected per parameter, so the loop has no branches. The last uniform draw
+    // serves both the normative sample and the mutation, as only one of the two is kept.
+    static inline void influenceParticle( param_t* __restrict trial, const param_t* __restrict position, const param_t* __restrict normLower,
+                                          const param_t* __restrict normUpper, const param_t* __restrict situational,
+                                          const param_t* __restrict influenceDraws, const param_t* __restrict sourceDraws,
+                                          const param_t* __restrict valueDraws, const param_t* __restrict normals, const param_t* __restrict lowerBound,
+                                          const param_t* __restrict upperBound, const size_t numParams, const param_t influenceRate,
+                                          const param_t mutationRate, const param_t situationalStep, const param_t minStepWidth )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t normWidth   = normUpper[j] - normLower[j];
+            const param_t stepWidth   = std::max( normWidth, minStepWidth * ( upperBound[j] - lowerBound[j] ) );
+            const param_t nearBest    = situational[j] + situationalStep * stepWidth * normals[j];
+            const param_t normative   = normLower[j] + normWidth * valueDraws[j];
+            const param_t mutated     = position[j] + mutationRate * stepWidth * ( 2 * valueDraws[j] - 1 );
+            const param_t believed    = sourceDraws[j] < static_cast< param_t >( 0.5 ) ? nearBest : normative;
+            const param_t chosen      = influenceDraws[j] < influenceRate ? believed : mutated;
+
+            trial[j] = std::min( std::max( chosen, lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    population_t& getCandidates() override { return trials_; }
+
+
+    void selectBlock( const size_t begin, const size_t end ) override
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( trials_.fitness( i ) < this->population_.fitness( i ) )
+            {
+                this->population_.copyParticle( i, trials_, i );
+            }
+        }
+    }
+
+
+    void updateParticles() override
+    {
+        updateBeliefSpace();
+
+        Base::updateParticles();
+    }
+
+
+    const char* getSnapshotTag() const override { return "CulturalAlgorithm"; }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        const BeliefSpace& beliefs = readBeliefs();
+
+        writer.write( acceptanceRatio_ );
+        writer.write( influenceRate_ );
+        writer.write( mutationRate_ );
+        writer.write( situationalStep_ );
+        writer.write( minStepWidth_ );
+        writer.writeArray( beliefs.lower.data(), beliefs.lower.size() );
+        writer.writeArray( beliefs.upper.data(), beliefs.upper.size() );
+        writer.writeArray( beliefs.situational.data(), beliefs.situational.size() );
+        writer.write( beliefs.situationalFitness );
+        writer.write( beliefs.version );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        acceptanceRatio_ = reader.read< param_t >();
+        influenceRate_   = reader.read< param_t >();
+        mutationRate_    = reader.read< param_t >();
+        situationalStep_ = reader.read< param_t >();
+        minStepWidth_    = reader.read< param_t >();
+
+        BeliefSpace& beliefs = beliefs_[0];
+
+        reader.readArray( beliefs.lower.data(), beliefs.lower.size() );
+        reader.readArray( beliefs.upper.data(), beliefs.upper.size() );
+        reader.readArray( beliefs.situational.data(), beliefs.situational.size() );
+        beliefs.situationalFitness = reader.read< fitness_t >();
+        beliefs.version            = reader.read< uint64_t >();
+
+        // Version v is read from beliefs_[v % 2]
+        const uint64_t version = beliefs.version;
+
+        if ( version % 2 != 0 )
+        {
+            std::swap( beliefs_[0], beliefs_[1] );
+        }
+
+        version_.store( version, std::memory_order_release );
+    }
+
+
+private:
+
+    // Running bounds of one worker's share of the accepted individuals
+    struct Partial
+    {
+        std::vector< param_t > lower;
+        std::vector< param_t > upper;
+        size_t best;                // Position in accepted_, NONE before the first
+    };
+
+
+    static constexpr size_t NONE = std::numeric_limits< size_t >::max();
+
+
+    static BeliefSpace makeBeliefSpace( const size_t numParams )
+    {
+        return BeliefSpace{ std::vector< param_t >( numParams ), std::vector< param_t >( numParams ), std::vector< param_t >( numParams ),
+                            std::numeric_limits< fitness_t >::max(), 0u };
+    }
+
+
+    const BeliefSpace& readBeliefs() const
+    {
+        return beliefs_[version_.load( std::memory_order_acquire ) % 2];
+    }
+
+
+    // Accepts the best individuals, reduces them into the unused buffer and publishes it
+    void updateBeliefSpace()
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+        const size_t numAccepted  = std::clamp< size_t >( static_cast< size_t >( acceptanceRatio_ * numParticles ), std::min< size_t >( 2u, numParticles ), numParticles );
+
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+            // Ties broken by index, so the accepted set does not depend on the library's nth_element
+            std::iota( accepted_.begin(), accepted_.end(), size_t{ 0 } );
+            std::nth_element( accepted_.begin(), accepted_.begin() + ( numAccepted - 1 ), accepted_.end(), [this]( const size_t a, const size_t b )
+            {
+                const fitness_t fa = this->population_.fitness( a );
+                const fitness_t fb = this->population_.fitness( b );
+
+                return fa < fb || ( fa == fb && a < b );
+            } );
+
+            for ( Partial& partial : partials_ )
+            {
+                std::fill( partial.lower.begin(), partial.lower.end(), std::numeric_limits< param_t >::max() );
+                std::fill( partial.upper.begin(), partial.upper.end(), std::numeric_limits< param_t >::lowest() );
+                partial.best = NONE;
+            }
+        }
+
+        this->forEachChunk( numAccepted, [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::BEST_REDUCTION, worker );
+
+            reduceBlock( partials_[worker], begin, end );
+        } );
+
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::BEST_REDUCTION, this->profiler_.getMainSlot() );
+
+        const uint64_t version     = version_.load( std::memory_order_relaxed );
+        const BeliefSpace& current = beliefs_[version % 2];
+        BeliefSpace& next          = beliefs_[( version + 1 ) % 2];
+
+        std::copy( partials_[0].lower.begin(), partials_[0].lower.end(), next.lower.begin() );
+        std::copy( partials_[0].upper.begin(), partials_[0].upper.end(), next.upper.begin() );
+
+        size_t best = partials_[0].best;
+
+        for ( size_t w = 1; w < partials_.size(); ++w )
+        {
+            const Partial& partial = partials_[w];
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                next.lower[j] = std::min( next.lower[j], partial.lower[j] );
+                next.upper[j] = std::max( next.upper[j], partial.upper[j] );
+            }
+
+            if ( partial.best != NONE && ( best == NONE || isBetter( accepted_[partial.best], accepted_[best] ) ) )
+            {
+                best = partial.best;
+            }
+        }
+
+        const size_t bestParticle = accepted_[best];
+
+        if ( this->population_.fitness( bestParticle ) < current.situationalFitness )
+        {
+            const param_t* position = this->population_.position( bestParticle );
+
+            std::copy( position, position + numParams, next.situational.begin() );
+            next.situationalFitness = this->population_.fitness( bestParticle );
+        }
+        else
+        {
+            next.situational        = current.situational;
+            next.situationalFitness = current.situationalFitness;
+        }
+
+        next.version = version + 1;
+
+        version_.store( version + 1, std::memory_order_release );
+    }
+
+
+    // Bounds and best of accepted_[begin, end), folded into partial
+    void reduceBlock( Partial& partial, const size_t begin, const size_t end ) const
+    {
+        const size_t numParams = this->getNumParams();
+
+        param_t* __restrict lower = partial.lower.data();
+        param_t* __restrict upper = partial.upper.data();
+
+        for ( size_t t = begin; t < end; ++t )
+        {
+            const param_t* __restrict position = this->population_.position( accepted_[t] );
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                lower[j] = std::min( lower[j], position[j] );
+                upper[j] = std::max( upper[j], position[j] );
+            }
+
+            if ( partial.best == NONE || isBetter( accepted_[t], accepted_[partial.best] ) )
+            {
+                partial.best = t;
+            }
+        }
+    }
+
+
+    bool isBetter( const size_t a, const size_t b ) const
+    {
+        const fitness_t fa = this->population_.fitness( a );
+        const fitness_t fb = this->population_.fitness( b );
+
+        return fa < fb || ( fa == fb && a < b );
+    }
+
+
+    param_t acceptanceRatio_;
+    param_t influenceRate_;
+    param_t mutationRate_;
+    param_t situationalStep_;
+    param_t minStepWidth_;
+
+    BeliefSpace beliefs_[2];                // Version v lives in beliefs_[v % 2]
+    std::atomic< uint64_t > version_;
+
+    std::vector< Partial > partials_;       // One per worker
+    std::vector< size_t > accepted_;        // Accepted individuals in the first rows
+
+    population_t trials_;
+    AlignedArray< param_t, extentProduct( extentProduct( 3, NUM_PARTICLES ), NUM_PARAMS ) > draws_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > normals_;
+
+
+    CulturalAlgorithm() = delete;
+    CulturalAlgorithm( const CulturalAlgorithm& ) = delete;
+    CulturalAlgorithm& operator=( const CulturalAlgorithm& ) = delete;
+
+}; // class CulturalAlgorithm
+
+} // namespace MetaOpt
+
+#endif // CULTURAL_ALGORITHM_H
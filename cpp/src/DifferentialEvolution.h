@@ -4,6 +4,12 @@
 
 #include "OptimizationAlg.h"
 #include "Particle.h"
+#include "SpinLock.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 
 namespace MetaOpt
@@ -14,13 +20,15 @@ class DifferentialEvolution : public OptimizationAlg< __NUM_PARTICLES, Particle,
 {
 public:
 
-    using Base       = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
-    using particle_t = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
-    using param_t    = __PARAM_T;
-    using fitness_t  = __FITNESS_T;
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
 
 
     static constexpr size_t  NUM_PARTICLES                 = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS                    = __NUM_PARAMS;
     static constexpr param_t DEFAULT_MUTATION_FACTOR       = 0.5;
     static constexpr param_t DEFAULT_CROSSOVER_PROBABILITY = 0.7;
 
@@ -28,9 +36,27 @@ public:
 
     // Constructor
     DifferentialEvolution( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
-        : Base( lowerBound, upperBound, numThreads )
+        requires ( !population_t::IS_DYNAMIC )
+        : DifferentialEvolution( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    DifferentialEvolution( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                           const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
         , mutation_ { DEFAULT_MUTATION_FACTOR }
         , crossProb_{ DEFAULT_CROSSOVER_PROBABILITY }
+        , trials_{ numParticles, numParams, this->arena_ }
+        , crossDraws_{ numParticles * numParams, this->arena_ }
+        , asynchronous_{ false }
+        , evaluationBudget_{ 0u }
+        , evaluations_{ 0u }
+        , nextTarget_{ 0u }
+        , stopRequested_{ false }
+        , rowLocks_{ std::make_unique< SpinLock[] >( numParticles ) }
+        , bestMtx_{}
     {
     }
 
@@ -41,50 +67,269 @@ public:
     void setCrossoverProbability( const param_t crossProb ) { crossProb_ = crossProb; }
 
 
+    // Steady-state mode: every worker repeatedly builds a trial for the next target, evaluates it and applies
+    // selection at once, without waiting for the rest of a generation. The run stops after evaluationBudget
+    // trials (0 means maxIterations * getNumParticles()). Results then depend on thread timing. Termination criteria
+    // are checked every getNumParticles() trials, which count as one iteration; the spread and diameter criteria
+    // need a consistent population and are not applied in this mode.
+    void setAsynchronous( const bool asynchronous, const uint64_t evaluationBudget = 0u )
+    {
+        asynchronous_     = asynchronous;
+        evaluationBudget_ = evaluationBudget;
+    }
+
+    bool isAsynchronous() const { return asynchronous_; }
+
+
 protected:
 
-    void updateParticle( particle_t& particle ) override
+    void updateBlock( const size_t begin, const size_t end ) override
     {
-        // Mutation selection
-        uint mutationIndices[3];
-        this->rng_->choice( mutationIndices, NUM_PARTICLES, false );
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            // Mutation selection
+            uint mutationIndices[3];
+            rng.choice( mutationIndices, static_cast< uint >( this->getNumParticles() ), false );
 
-        const particle_t mutants[3] =
+            // Crossover draws are made up front so the loop below is branch free
+            param_t* crossDraws = crossDraws_.data() + i * numParams;
+
+            rng.fillUniform( crossDraws, numParams );
+
+            mutateParticle( trials_.position( i ), this->population_.position( i ), this->population_.position( mutationIndices[0] ),
+                            this->population_.position( mutationIndices[1] ), this->population_.position( mutationIndices[2] ),
+                            crossDraws, this->lowerBound_.data(), this->upperBound_.data(), numParams, mutation_, crossProb_ );
+        }
+    }
+
+
+    // Mutation, crossover and clipping of one trial vector. Kept free of member accesses so the compiler can
+    // prove the rows do not alias and vectorize the loop.
+    static inline void mutateParticle( param_t* __restrict trial, const param_t* __restrict target, const param_t* __restrict mutant0,
+                                       const param_t* __restrict mutant1, const param_t* __restrict mutant2, const param_t* __restrict crossDraws,
+                                       const param_t* __restrict lowerBound, const param_t* __restrict upperBound, const size_t numParams,
+                                       const param_t mutation, const param_t crossProb )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
         {
-            this->particles_[mutationIndices[0]],
-            this->particles_[mutationIndices[1]],
-            this->particles_[mutationIndices[2]]
-        };
+            const param_t mutated = mutant0[j] + mutation * ( mutant1[j] - mutant2[j] );
+            const param_t kept    = target[j];
+            const param_t crossed = crossDraws[j] > crossProb ? kept : mutated;
+
+            trial[j] = std::min( std::max( crossed, lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    population_t& getCandidates() override { return trials_; }
+
 
+    const char* getSnapshotTag() const override { return "DifferentialEvolution"; }
 
-        // Mutation
-        particle_t trialParticle = mutants[0] + mutation_ * ( mutants[1] - mutants[2] );
+
+    // Trials are rebuilt every generation, only the parameters need saving
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( mutation_ );
+        writer.write( crossProb_ );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        mutation_  = reader.read< param_t >();
+        crossProb_ = reader.read< param_t >();
+    }
 
 
-        // Crossover
-        for ( size_t j = 0; j < particle.NUM_PARAMS; j++ )
+    // Selection, done after the whole generation so mutants are never read while being replaced
+    void selectBlock( const size_t begin, const size_t end ) override
+    {
+        for ( size_t i = begin; i < end; ++i )
         {
-            if ( this->rng_->drawUniform( 0.0, 1.0 ) > crossProb_ )
+            if ( trials_.fitness( i ) < this->population_.fitness( i ) )
             {
-                trialParticle.position_[j] = particle.position_[j];
+                this->population_.copyParticle( i, trials_, i );
             }
         }
+    }
+
+
+    void optimize() override
+    {
+        if ( !asynchronous_ )
+        {
+            Base::optimize();
+            return;
+        }
+
+        const uint64_t budget = evaluationBudget_ > 0 ? evaluationBudget_ : this->getMaxIterations() * this->getNumParticles();
+
+        evaluations_.store( 0u, std::memory_order_relaxed );
+        nextTarget_.store( 0u, std::memory_order_relaxed );
+        stopRequested_.store( false, std::memory_order_relaxed );
+
+        if ( this->threadingEnabled_ )
+        {
+            // One long-lived chunk per worker, run under the index of the worker that took it
+            const size_t numWorkers = static_cast< size_t >( this->threadPool_.getNumThreads() );
+
+            this->threadPool_.parallelFor( 0, numWorkers, 1, [this, budget]( const size_t, const size_t, const size_t worker )
+            {
+                runAsyncWorker( worker, budget );
+            }, ThreadPool::Schedule::STATIC );
+        }
+        else
+        {
+            runAsyncWorker( 0u, budget );
+        }
+
+        // Every worker overshoots the counter by one when it stops
+        const uint64_t trials = std::min( evaluations_.load( std::memory_order_relaxed ), budget );
+
+        this->iteration_ = trials / this->getNumParticles();
+
+        if ( this->stopReason_ == StopReason::NONE )
+        {
+            this->stopReason_ = evaluationBudget_ > 0 ? StopReason::EVALUATION_BUDGET : StopReason::MAX_ITERATIONS;
+        }
+    }
+
+
+    // Termination check of the steady-state mode, made by the worker that completes a generation's worth of trials
+    void checkAsyncTermination( const uint64_t trials )
+    {
+        std::lock_guard< std::mutex > lock( bestMtx_ );
+
+        if ( this->stopReason_ != StopReason::NONE )
+        {
+            return;
+        }
+
+        this->stopReason_ = this->termination_.checkProgress( trials / this->getNumParticles(), this->getEvaluationCount(), this->bestParticle_->fitness_ );
+
+        if ( this->stopReason_ != StopReason::NONE )
+        {
+            stopRequested_.store( true, std::memory_order_relaxed );
+        }
+    }
+
+
+    void runAsyncWorker( const size_t worker, const uint64_t budget )
+    {
+        // Streams after the per-particle ones, one per worker
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+
+        Rng<> rng( this->seed_, numParticles + worker );
+
+        std::vector< param_t > rows( 6 * numParams );
+
+        param_t* target     = rows.data();
+        param_t* mutant0    = rows.data() + numParams;
+        param_t* mutant1    = rows.data() + 2 * numParams;
+        param_t* mutant2    = rows.data() + 3 * numParams;
+        param_t* crossDraws = rows.data() + 4 * numParams;
+        param_t* candidate  = rows.data() + 5 * numParams;
 
-        trialParticle.clip( this->lowerBound_, this->upperBound_ );
+        Profiler& profiler = this->profiler_;
 
-        trialParticle.fitness_ = this->fitnessFunc_( trialParticle );
+        uint64_t trial;
 
-        // Selection
-        if ( trialParticle.fitness_ < particle.fitness_ )
+        while ( !stopRequested_.load( std::memory_order_relaxed ) && ( trial = evaluations_.fetch_add( 1u, std::memory_order_relaxed ) ) < budget )
         {
-            particle = trialParticle;
+            const uint64_t updateStart = Profiler::now();
+
+            const size_t targetIdx = nextTarget_.fetch_add( 1u, std::memory_order_relaxed ) % numParticles;
+
+            uint mutationIndices[3];
+            rng.choice( mutationIndices, static_cast< uint >( numParticles ), false );
+
+            // Snapshot the rows one at a time, so no worker ever holds two row locks
+            readRow( targetIdx, target );
+            readRow( mutationIndices[0], mutant0 );
+            readRow( mutationIndices[1], mutant1 );
+            readRow( mutationIndices[2], mutant2 );
+
+            rng.fillUniform( crossDraws, numParams );
+
+            mutateParticle( candidate, target, mutant0, mutant1, mutant2, crossDraws, this->lowerBound_.data(), this->upperBound_.data(), numParams, mutation_, crossProb_ );
+
+            const uint64_t evaluateStart = Profiler::now();
+
+            profiler.addPhase( worker, Profiler::Phase::UPDATE, updateStart, evaluateStart );
+
+            const fitness_t fitness = this->evaluatePosition( candidate, worker );
+
+            const uint64_t selectStart = Profiler::now();
+
+            profiler.addPhase( worker, Profiler::Phase::EVALUATE, evaluateStart, selectStart );
+
+            // Selection against the target as it is now, which may have been replaced meanwhile
+            bool improved = false;
+
+            {
+                std::lock_guard< SpinLock > lock( rowLocks_[targetIdx] );
+
+                if ( fitness < this->population_.fitness( targetIdx ) )
+                {
+                    std::memcpy( this->population_.position( targetIdx ), candidate, numParams * sizeof( param_t ) );
+                    this->population_.fitness( targetIdx ) = fitness;
+                    this->population_.resetSamples( targetIdx );
+                    improved = true;
+                }
+            }
+
+            const uint64_t selectStop = Profiler::now();
+
+            profiler.addPhase( worker, Profiler::Phase::SELECT, selectStart, selectStop );
+
+            if ( improved )
+            {
+                {
+                    std::lock_guard< std::mutex > lock( bestMtx_ );
+
+                    this->bestParticle_->trialPosition( candidate, fitness );
+                }
+
+                profiler.addPhase( worker, Profiler::Phase::BEST_REDUCTION, selectStop, Profiler::now() );
+            }
+
+            if ( ( trial + 1 ) % numParticles == 0 )
+            {
+                checkAsyncTermination( trial + 1 );
+            }
         }
     }
 
 
+    void readRow( const size_t idx, param_t* out )
+    {
+        std::lock_guard< SpinLock > lock( rowLocks_[idx] );
+
+        std::memcpy( out, this->population_.position( idx ), this->getNumParams() * sizeof( param_t ) );
+    }
+
+
     param_t mutation_;
     param_t crossProb_;
 
+    population_t trials_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > crossDraws_;
+
+    bool asynchronous_;
+    uint64_t evaluationBudget_;
+    std::atomic< uint64_t > evaluations_;
+    std::atomic< uint64_t > nextTarget_;
+    std::atomic< bool > stopRequested_;
+
+    std::unique_ptr< SpinLock[] > rowLocks_;
+    std::mutex bestMtx_;
+
 
     DifferentialEvolution() = delete;
     DifferentialEvolution( const DifferentialEvolution& ) = delete;
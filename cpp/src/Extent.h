@@ -0,0 +1,23 @@
+#ifndef EXTENT_H
+#define EXTENT_H
+
+#include <cstddef>
+#include <span>
+
+
+namespace MetaOpt
+{
+
+// Passed instead of a compile-time number of particles or parameters to size the problem at run time
+static constexpr size_t DYNAMIC_EXTENT = std::dynamic_extent;
+
+
+// Extent of an [rows x cols] block, dynamic as soon as either side is
+constexpr size_t extentProduct( const size_t rows, const size_t cols )
+{
+    return ( rows == DYNAMIC_EXTENT || cols == DYNAMIC_EXTENT ) ? DYNAMIC_EXTENT : rows * cols;
+}
+
+} // namespace MetaOpt
+
+#endif // EXTENT_H
@@ -0,0 +1,286 @@
+#ifndef FITNESS_CACHE_H
+#define FITNESS_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Bounded, thread-safe memo of fitness values keyed on particle position. Positions are snapped to a grid of
+// spacing epsilon (0 keys on the exact bit pattern), so near-duplicates share one entry. Entries are spread over
+// independently locked shards, and each shard evicts with the CLOCK (second chance) policy once full.
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class FitnessCache
+{
+public:
+
+    using param_t   = __PARAM_T;
+    using fitness_t = __FITNESS_T;
+    using key_t     = int64_t;
+
+    static_assert( sizeof( param_t ) <= sizeof( key_t ), "Parameter type must fit in a 64 bit key" );
+
+    static constexpr size_t DEFAULT_NUM_SHARDS = 16;
+
+
+    FitnessCache( const size_t numParams, const size_t capacity, const param_t epsilon = static_cast< param_t >( 0 ), const size_t numShards = DEFAULT_NUM_SHARDS )
+        : numParams_{ numParams }
+        , epsilon_{ epsilon }
+        , shards_{}
+        , hits_{ 0u }
+        , misses_{ 0u }
+    {
+        if ( capacity == 0 || numShards == 0 )
+        {
+            throw std::invalid_argument( "FitnessCache::FitnessCache: capacity and number of shards must be positive" );
+        }
+
+        if ( epsilon < static_cast< param_t >( 0 ) )
+        {
+            throw std::invalid_argument( "FitnessCache::FitnessCache: epsilon must not be negative" );
+        }
+
+        const size_t shardCount = std::min( numShards, capacity );
+
+        shards_.reserve( shardCount );
+
+        for ( size_t s = 0; s < shardCount; ++s )
+        {
+            const size_t slots = capacity / shardCount + ( s < capacity % shardCount ? 1u : 0u );
+
+            shards_.emplace_back( std::make_unique< Shard >( numParams_, slots ) );
+        }
+    }
+
+
+    ~FitnessCache() = default;
+
+
+    bool lookup( const param_t* position, fitness_t& fitness )
+    {
+        std::vector< key_t >& key = scratchKey();
+        const uint64_t hash = makeKey( position, key );
+
+        Shard& shard = shardFor( hash );
+
+        {
+            std::lock_guard< std::mutex > lock( shard.mtx );
+
+            const auto it = shard.index.find( hash );
+
+            if ( it != shard.index.end() && shard.matches( it->second, key.data() ) )
+            {
+                shard.referenced[it->second] = true;
+                fitness = shard.fitnesses[it->second];
+
+                hits_.fetch_add( 1u, std::memory_order_relaxed );
+                return true;
+            }
+        }
+
+        misses_.fetch_add( 1u, std::memory_order_relaxed );
+        return false;
+    }
+
+
+    void insert( const param_t* position, const fitness_t fitness )
+    {
+        std::vector< key_t >& key = scratchKey();
+        const uint64_t hash = makeKey( position, key );
+
+        Shard& shard = shardFor( hash );
+
+        std::lock_guard< std::mutex > lock( shard.mtx );
+
+        const auto it = shard.index.find( hash );
+
+        if ( it != shard.index.end() )
+        {
+            // Same key or a full hash collision: either way the newer value takes the slot
+            shard.store( it->second, hash, key.data(), fitness );
+            return;
+        }
+
+        const size_t slot = shard.victim();
+
+        if ( shard.occupied[slot] )
+        {
+            shard.index.erase( shard.hashes[slot] );
+        }
+
+        shard.store( slot, hash, key.data(), fitness );
+        shard.index.emplace( hash, slot );
+    }
+
+
+    void clear()
+    {
+        for ( std::unique_ptr< Shard >& shard : shards_ )
+        {
+            std::lock_guard< std::mutex > lock( shard->mtx );
+            shard->reset();
+        }
+    }
+
+
+    void resetStats()
+    {
+        hits_.store( 0u, std::memory_order_relaxed );
+        misses_.store( 0u, std::memory_order_relaxed );
+    }
+
+
+    uint64_t getHits() const { return hits_.load( std::memory_order_relaxed ); }
+    uint64_t getMisses() const { return misses_.load( std::memory_order_relaxed ); }
+
+    param_t getEpsilon() const { return epsilon_; }
+
+
+private:
+
+    struct Shard
+    {
+        Shard( const size_t numParams, const size_t numSlots )
+            : mtx{}
+            , numParams{ numParams }
+            , keys( numParams * numSlots )
+            , hashes( numSlots )
+            , fitnesses( numSlots )
+            , referenced( numSlots, false )
+            , occupied( numSlots, false )
+            , index{}
+            , hand{ 0u }
+        {
+            index.reserve( numSlots );
+        }
+
+        bool matches( const size_t slot, const key_t* key ) const
+        {
+            return std::memcmp( keys.data() + slot * numParams, key, numParams * sizeof( key_t ) ) == 0;
+        }
+
+        void store( const size_t slot, const uint64_t hash, const key_t* key, const fitness_t fitness )
+        {
+            std::memcpy( keys.data() + slot * numParams, key, numParams * sizeof( key_t ) );
+            hashes[slot]     = hash;
+            fitnesses[slot]  = fitness;
+            referenced[slot] = true;
+            occupied[slot]   = true;
+        }
+
+        // CLOCK: sweep the hand, clearing reference bits, until an unreferenced slot turns up
+        size_t victim()
+        {
+            while ( true )
+            {
+                const size_t slot = hand;
+
+                hand = ( hand + 1 ) % hashes.size();
+
+                if ( !occupied[slot] || !referenced[slot] )
+                {
+                    return slot;
+                }
+
+                referenced[slot] = false;
+            }
+        }
+
+        void reset()
+        {
+            std::fill( referenced.begin(), referenced.end(), false );
+            std::fill( occupied.begin(), occupied.end(), false );
+            index.clear();
+            hand = 0u;
+        }
+
+        std::mutex mtx;
+
+        size_t numParams;
+        std::vector< key_t > keys;
+        std::vector< uint64_t > hashes;
+        std::vector< fitness_t > fitnesses;
+        std::vector< bool > referenced;
+        std::vector< bool > occupied;
+
+        std::unordered_map< uint64_t, size_t > index;
+        size_t hand;
+    };
+
+
+    std::vector< key_t >& scratchKey() const
+    {
+        thread_local std::vector< key_t > key;
+        key.resize( numParams_ );
+        return key;
+    }
+
+
+    uint64_t makeKey( const param_t* position, std::vector< key_t >& key ) const
+    {
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ numParams_;
+
+        for ( size_t j = 0; j < numParams_; ++j )
+        {
+            if ( epsilon_ > static_cast< param_t >( 0 ) )
+            {
+                key[j] = static_cast< key_t >( std::llround( position[j] / epsilon_ ) );
+            }
+            else
+            {
+                key[j] = 0;
+                std::memcpy( &key[j], &position[j], sizeof( param_t ) );
+            }
+
+            hash = mix( hash ^ static_cast< uint64_t >( key[j] ) );
+        }
+
+        return hash;
+    }
+
+
+    // SplitMix64 finalizer
+    static uint64_t mix( uint64_t x )
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+        return x ^ ( x >> 31 );
+    }
+
+
+    Shard& shardFor( const uint64_t hash )
+    {
+        return *shards_[( hash >> 32 ) % shards_.size()];
+    }
+
+
+    size_t numParams_;
+    param_t epsilon_;
+
+    std::vector< std::unique_ptr< Shard > > shards_;
+
+    std::atomic< uint64_t > hits_;
+    std::atomic< uint64_t > misses_;
+
+
+    FitnessCache() = delete;
+    FitnessCache( const FitnessCache& ) = delete;
+    FitnessCache& operator=( const FitnessCache& ) = delete;
+
+}; // class FitnessCache
+
+} // namespace MetaOpt
+
+#endif // FITNESS_CACHE_H
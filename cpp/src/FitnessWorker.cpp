@@ -0,0 +1,81 @@
+#include "FitnessWorker.h"
+
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+
+namespace MetaOpt
+{
+
+bool sendWorkerMessage( const int fd, const void* data, const size_t size )
+{
+    const char* bytes = static_cast< const char* >( data );
+    size_t sent = 0;
+
+    while ( sent < size )
+    {
+        const ssize_t n = send( fd, bytes + sent, size - sent, MSG_NOSIGNAL );
+
+        if ( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( n <= 0 )
+        {
+            return false;
+        }
+
+        sent += static_cast< size_t >( n );
+    }
+
+    return true;
+}
+
+
+bool receiveWorkerMessage( const int fd, void* data, const size_t size )
+{
+    char* bytes = static_cast< char* >( data );
+    size_t received = 0;
+
+    while ( received < size )
+    {
+        const ssize_t n = recv( fd, bytes + received, size - received, 0 );
+
+        if ( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( n <= 0 )
+        {
+            return false;
+        }
+
+        received += static_cast< size_t >( n );
+    }
+
+    return true;
+}
+
+
+std::byte* mapWorkerSegment( const int fd, size_t& size )
+{
+    struct stat status;
+
+    if ( fstat( fd, &status ) != 0 )
+    {
+        return nullptr;
+    }
+
+    size = static_cast< size_t >( status.st_size );
+
+    void* mapping = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    return mapping == MAP_FAILED ? nullptr : static_cast< std::byte* >( mapping );
+}
+
+} // namespace MetaOpt
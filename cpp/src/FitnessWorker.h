@@ -0,0 +1,132 @@
+#ifndef FITNESS_WORKER_H
+#define FITNESS_WORKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+
+namespace MetaOpt
+{
+
+// Worker side of the out-of-process fitness protocol, see FitnessWorkerPool. Each worker owns a shared memory
+// segment starting with this header, followed by room for maxRows position rows and maxRows fitnesses. Requests
+// and responses travel over a stream socket; the rows themselves never leave the segment.
+struct FitnessWorkerHeader
+{
+    static constexpr char     MAGIC[8] = { 'M', 'E', 'T', 'A', 'O', 'P', 'T', 'W' };
+    static constexpr uint32_t VERSION  = 1u;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t numParams;
+    uint64_t maxRows;
+    uint32_t paramSize;
+    uint32_t fitnessSize;
+    uint64_t positionsOffset;
+    uint64_t fitnessesOffset;
+};
+
+
+struct FitnessWorkerRequest
+{
+    enum Kind : uint32_t { EVALUATE, SHUTDOWN };
+
+    uint32_t kind;
+    uint32_t count;         // Rows at the start of the segment's position area
+    uint64_t sequence;
+};
+
+
+struct FitnessWorkerResponse
+{
+    enum Status : uint32_t { OK, ERROR };
+
+    uint64_t sequence;
+    uint32_t count;
+    uint32_t status;        // ERROR when the objective threw
+};
+
+
+// Descriptors of an executable worker: the socket to the pool and its segment
+static constexpr int FITNESS_WORKER_CHANNEL_FD = 3;
+static constexpr int FITNESS_WORKER_SEGMENT_FD = 4;
+
+
+// Whole-message socket I/O; false once the other side is gone. Sending never raises SIGPIPE.
+bool sendWorkerMessage( const int fd, const void* data, const size_t size );
+bool receiveWorkerMessage( const int fd, void* data, const size_t size );
+
+// Maps the segment passed to an executable worker; nullptr when there is none
+std::byte* mapWorkerSegment( const int fd, size_t& size );
+
+
+// Answers requests on channel until the pool shuts the worker down or goes away. Returns the exit code.
+template< typename param_t, typename fitness_t, typename Func >
+int serveFitnessRequests( const int channel, std::byte* segment, Func&& objective )
+{
+    FitnessWorkerHeader header;
+    std::memcpy( &header, segment, sizeof( header ) );
+
+    if ( std::memcmp( header.magic, FitnessWorkerHeader::MAGIC, sizeof( header.magic ) ) != 0 || header.version != FitnessWorkerHeader::VERSION ||
+         header.paramSize != sizeof( param_t ) || header.fitnessSize != sizeof( fitness_t ) )
+    {
+        return 2;
+    }
+
+    const param_t* positions = reinterpret_cast< const param_t* >( segment + header.positionsOffset );
+    fitness_t* fitnesses     = reinterpret_cast< fitness_t* >( segment + header.fitnessesOffset );
+
+    FitnessWorkerRequest request;
+
+    while ( receiveWorkerMessage( channel, &request, sizeof( request ) ) && request.kind == FitnessWorkerRequest::EVALUATE )
+    {
+        FitnessWorkerResponse response{ request.sequence, request.count, FitnessWorkerResponse::OK };
+
+        if ( request.count > header.maxRows )
+        {
+            response.status = FitnessWorkerResponse::ERROR;
+        }
+        else
+        {
+            try
+            {
+                objective( std::span< const param_t >( positions, request.count * header.numParams ), std::span< fitness_t >( fitnesses, request.count ) );
+            }
+            catch ( ... )
+            {
+                response.status = FitnessWorkerResponse::ERROR;
+            }
+        }
+
+        if ( !sendWorkerMessage( channel, &response, sizeof( response ) ) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// main() of a worker executable started by FitnessWorkerPool: serves objective, a batch function
+// void( std::span< const param_t > positions, std::span< fitness_t > fitnesses ), on the inherited descriptors
+template< typename param_t = double, typename fitness_t = double, typename Func >
+int runFitnessWorker( Func&& objective )
+{
+    size_t size;
+    std::byte* segment = mapWorkerSegment( FITNESS_WORKER_SEGMENT_FD, size );
+
+    if ( !segment || size < sizeof( FitnessWorkerHeader ) )
+    {
+        return 2;
+    }
+
+    return serveFitnessRequests< param_t, fitness_t >( FITNESS_WORKER_CHANNEL_FD, segment, objective );
+}
+
+} // namespace MetaOpt
+
+#endif // FITNESS_WORKER_H
@@ -0,0 +1,656 @@
+#ifndef FITNESS_WORKER_POOL_H
+#define FITNESS_WORKER_POOL_H
+
+#include "FitnessWorker.h"
+#include "Population.h"
+#include "SharedMemory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace MetaOpt
+{
+
+// Evaluates batches in a pool of persistent worker processes, for objectives that are not thread-safe, leak or
+// crash. A worker is either a forked copy of this process running a callable, or an executable whose main()
+// calls runFitnessWorker. Rows are copied into the worker's shared memory segment and only a small request and
+// response cross its socket. A worker that crashes or exceeds the per-evaluation timeout is killed and
+// restarted; the rows it held are retried one at a time, and a row that fails on its own gets the failure
+// fitness. evaluate() is thread-safe: concurrent callers share the workers, so the pool plugs into an optimizer
+// through setBatchFitnessFunc( pool.getBatchFitnessFunc() ) with any number of threads.
+// Forked workers start in the constructor and on restart; prefer executables when the caller runs other
+// threads that may hold locks across fork().
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class FitnessWorkerPool
+{
+public:
+
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using batch_func_t = std::function< void( std::span< const param_t > positions, std::span< fitness_t > fitnesses ) >;
+
+
+    static constexpr size_t DEFAULT_MAX_BATCH    = 64;
+    static constexpr size_t DEFAULT_MAX_RESTARTS = 1000;
+
+
+    // Forked workers running objective
+    FitnessWorkerPool( const size_t numWorkers, const size_t numParams, batch_func_t objective, const size_t maxBatch = DEFAULT_MAX_BATCH )
+        : FitnessWorkerPool( numWorkers, numParams, maxBatch, requireObjective( std::move( objective ) ), {} )
+    {
+        startWorkers();
+    }
+
+
+    // Workers running command, its program looked up in PATH, with the socket as descriptor 3 and the segment as 4
+    FitnessWorkerPool( const size_t numWorkers, const size_t numParams, std::vector< std::string > command, const size_t maxBatch = DEFAULT_MAX_BATCH )
+        : FitnessWorkerPool( numWorkers, numParams, maxBatch, {}, requireCommand( std::move( command ) ) )
+    {
+        startWorkers();
+    }
+
+
+    // Asks every worker to exit, and kills those that do not within a second. Workers never started, as when a
+    // constructor throws, are skipped.
+    ~FitnessWorkerPool()
+    {
+        for ( Worker& worker : workers_ )
+        {
+            if ( worker.pid > 0 )
+            {
+                const FitnessWorkerRequest request{ FitnessWorkerRequest::SHUTDOWN, 0u, 0u };
+                sendWorkerMessage( worker.channel, &request, sizeof( request ) );
+            }
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 1 );
+
+        for ( Worker& worker : workers_ )
+        {
+            if ( worker.pid <= 0 )
+            {
+                continue;
+            }
+
+            while ( waitpid( worker.pid, nullptr, WNOHANG ) == 0 )
+            {
+                if ( std::chrono::steady_clock::now() > deadline )
+                {
+                    kill( worker.pid, SIGKILL );
+                    waitpid( worker.pid, nullptr, 0 );
+                    break;
+                }
+
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+
+            close( worker.channel );
+        }
+    }
+
+
+    // Limit per evaluation; a request of n rows may take n times as long. 0 waits forever.
+    void setEvaluationTimeout( const std::chrono::duration< double > timeout ) { timeout_ = timeout; }
+
+    // Fitness of a row whose evaluation crashed, timed out or threw
+    void setFailureFitness( const fitness_t fitness ) { failureFitness_ = fitness; }
+
+    // Restarts after which evaluate() gives up and throws, e.g. when the command cannot be started
+    void setMaxRestarts( const size_t maxRestarts ) { maxRestarts_ = maxRestarts; }
+
+
+    size_t getNumWorkers() const { return workers_.size(); }
+    size_t getNumParams() const { return numParams_; }
+
+    uint64_t getNumCrashes() const { return numCrashes_.load( std::memory_order_relaxed ); }
+    uint64_t getNumTimeouts() const { return numTimeouts_.load( std::memory_order_relaxed ); }
+    uint64_t getNumErrors() const { return numErrors_.load( std::memory_order_relaxed ); }
+    uint64_t getNumRestarts() const { return numRestarts_.load( std::memory_order_relaxed ); }
+    uint64_t getNumFailedEvaluations() const { return numFailed_.load( std::memory_order_relaxed ); }
+
+
+    // Evaluates fitnesses.size() rows of positions on as many idle workers as the batch can use
+    void evaluate( std::span< const param_t > positions, std::span< fitness_t > fitnesses )
+    {
+        const size_t count = fitnesses.size();
+
+        if ( count == 0 )
+        {
+            return;
+        }
+
+        Lease lease( *this, count );
+
+        Batch batch{ positions.data(), fitnesses.data(), 0u, count,
+                     std::clamp< size_t >( ( count + lease.workers.size() - 1 ) / lease.workers.size(), 1u, maxBatch_ ), {} };
+
+        std::vector< Worker* > active;
+        std::vector< pollfd > fds;
+
+        while ( true )
+        {
+            // A request that cannot be sent fails at once and leaves a restarted worker to try again
+            for ( Worker* worker : lease.workers )
+            {
+                while ( worker->rows == 0 && !batch.done() )
+                {
+                    dispatch( *worker, batch );
+                }
+            }
+
+            active.clear();
+
+            for ( Worker* worker : lease.workers )
+            {
+                if ( worker->rows > 0 )
+                {
+                    active.push_back( worker );
+                }
+            }
+
+            if ( active.empty() )
+            {
+                break;
+            }
+
+            wait( active, fds, batch );
+        }
+    }
+
+
+    batch_func_t getBatchFitnessFunc()
+    {
+        return [this]( std::span< const param_t > positions, std::span< fitness_t > fitnesses ) { evaluate( positions, fitnesses ); };
+    }
+
+
+private:
+
+    using clock = std::chrono::steady_clock;
+
+
+    struct Worker
+    {
+        pid_t pid = -1;         // -1 while not running
+        int channel = -1;
+        std::unique_ptr< SharedMemory > segment;
+        param_t* positions;
+        fitness_t* fitnesses;
+
+        // Request in flight
+        uint64_t sequence;
+        size_t begin;
+        size_t rows;
+        clock::time_point deadline;
+    };
+
+
+    // Rows of one evaluate() call still to hand out
+    struct Batch
+    {
+        const param_t* positions;
+        fitness_t* fitnesses;
+        size_t next;
+        size_t count;
+        size_t chunk;
+        std::deque< size_t > retries;   // Rows of failed requests, run alone
+
+        bool done() const { return next == count && retries.empty(); }
+    };
+
+
+    // Idle workers taken by one caller: at least one, at most one per row
+    struct Lease
+    {
+        Lease( FitnessWorkerPool& pool, const size_t count )
+            : pool{ pool }
+        {
+            std::unique_lock< std::mutex > lock( pool.mtx_ );
+
+            pool.cv_.wait( lock, [&pool] { return !pool.idle_.empty(); } );
+
+            while ( !pool.idle_.empty() && workers.size() < count )
+            {
+                workers.push_back( pool.idle_.back() );
+                pool.idle_.pop_back();
+            }
+        }
+
+        ~Lease()
+        {
+            {
+                std::unique_lock< std::mutex > lock( pool.mtx_ );
+
+                for ( Worker* worker : workers )
+                {
+                    // A request left behind by an exception leaves the worker in an unknown state
+                    if ( worker->rows > 0 )
+                    {
+                        try
+                        {
+                            pool.restart( *worker );
+                        }
+                        catch ( ... )
+                        {
+                        }
+                    }
+
+                    pool.idle_.push_back( worker );
+                }
+            }
+
+            pool.cv_.notify_all();
+        }
+
+        FitnessWorkerPool& pool;
+        std::vector< Worker* > workers;
+    };
+
+
+    // Arguments are checked before any worker exists, so a throwing constructor leaves nothing to clean up
+    FitnessWorkerPool( const size_t numWorkers, const size_t numParams, const size_t maxBatch, batch_func_t objective, std::vector< std::string > command )
+        : numParams_{ numParams }
+        , maxBatch_{ std::max< size_t >( maxBatch, 1u ) }
+        , objective_{ std::move( objective ) }
+        , command_{ std::move( command ) }
+        , workers_( std::max< size_t >( numWorkers, 1u ) )
+        , mtx_{}
+        , cv_{}
+        , idle_{}
+        , timeout_{ 0.0 }
+        , failureFitness_{ std::numeric_limits< fitness_t >::max() }
+        , maxRestarts_{ DEFAULT_MAX_RESTARTS }
+        , numCrashes_{ 0u }
+        , numTimeouts_{ 0u }
+        , numErrors_{ 0u }
+        , numRestarts_{ 0u }
+        , numFailed_{ 0u }
+    {
+    }
+
+
+    static batch_func_t requireObjective( batch_func_t objective )
+    {
+        if ( !objective )
+        {
+            throw std::invalid_argument( "FitnessWorkerPool::FitnessWorkerPool: objective is empty" );
+        }
+
+        return objective;
+    }
+
+
+    static std::vector< std::string > requireCommand( std::vector< std::string > command )
+    {
+        if ( command.empty() )
+        {
+            throw std::invalid_argument( "FitnessWorkerPool::FitnessWorkerPool: command is empty" );
+        }
+
+        return command;
+    }
+
+
+    // Workers already started are stopped again if one fails to start
+    void startWorkers()
+    {
+        const size_t positionsOffset = ( sizeof( FitnessWorkerHeader ) + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        const size_t fitnessesOffset = positionsOffset + ( maxBatch_ * numParams_ * sizeof( param_t ) + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+        FitnessWorkerHeader header{};
+        std::memcpy( header.magic, FitnessWorkerHeader::MAGIC, sizeof( header.magic ) );
+
+        header.version         = FitnessWorkerHeader::VERSION;
+        header.headerSize      = sizeof( FitnessWorkerHeader );
+        header.numParams       = numParams_;
+        header.maxRows         = maxBatch_;
+        header.paramSize       = sizeof( param_t );
+        header.fitnessSize     = sizeof( fitness_t );
+        header.positionsOffset = positionsOffset;
+        header.fitnessesOffset = fitnessesOffset;
+
+        for ( Worker& worker : workers_ )
+        {
+            worker.pid     = -1;
+            worker.channel = -1;
+            worker.segment = std::make_unique< SharedMemory >( fitnessesOffset + maxBatch_ * sizeof( fitness_t ) );
+
+            std::memcpy( worker.segment->data(), &header, sizeof( header ) );
+
+            worker.positions = reinterpret_cast< param_t* >( worker.segment->data() + positionsOffset );
+            worker.fitnesses = reinterpret_cast< fitness_t* >( worker.segment->data() + fitnessesOffset );
+            worker.sequence  = 0u;
+            worker.rows      = 0u;
+        }
+
+        try
+        {
+            for ( Worker& worker : workers_ )
+            {
+                spawn( worker );
+                idle_.push_back( &worker );
+            }
+        }
+        catch ( ... )
+        {
+            for ( Worker& worker : workers_ )
+            {
+                stopWorker( worker );
+            }
+
+            idle_.clear();
+            throw;
+        }
+    }
+
+
+    void spawn( Worker& worker )
+    {
+        int channels[2];
+
+        if ( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channels ) != 0 )
+        {
+            throw std::system_error( errno, std::generic_category(), "FitnessWorkerPool: cannot create a worker socket" );
+        }
+
+        std::cout.flush();
+        std::fflush( nullptr );
+
+        const pid_t pid = fork();
+
+        if ( pid < 0 )
+        {
+            const int error = errno;
+            close( channels[0] );
+            close( channels[1] );
+            throw std::system_error( error, std::generic_category(), "FitnessWorkerPool: cannot fork a worker" );
+        }
+
+        if ( pid == 0 )
+        {
+            // The pool's end, which the worker must not hold open or it would never see the pool close it
+            close( channels[0] );
+
+            runChild( worker, channels[1] );
+        }
+
+        close( channels[1] );
+
+        worker.pid     = pid;
+        worker.channel = channels[0];
+    }
+
+
+    [[noreturn]] void runChild( Worker& worker, const int channel )
+    {
+        // Workers go down with the pool's process
+        prctl( PR_SET_PDEATHSIG, SIGKILL );
+
+        // Other workers' sockets would keep them alive after the pool closed its end
+        for ( const Worker& other : workers_ )
+        {
+            if ( other.channel >= 0 )
+            {
+                close( other.channel );
+            }
+        }
+
+        if ( !command_.empty() )
+        {
+            // Moved clear of 3 and 4 first, so the two dup2 cannot overwrite each other
+            const int movedChannel = fcntl( channel, F_DUPFD, 10 );
+            const int movedSegment = fcntl( worker.segment->getFd(), F_DUPFD, 10 );
+
+            if ( movedChannel < 0 || movedSegment < 0 || dup2( movedChannel, FITNESS_WORKER_CHANNEL_FD ) < 0 ||
+                 dup2( movedSegment, FITNESS_WORKER_SEGMENT_FD ) < 0 )
+            {
+                _exit( 127 );
+            }
+
+            close( movedChannel );
+            close( movedSegment );
+
+            std::vector< char* > argv;
+
+            for ( std::string& arg : command_ )
+            {
+                argv.push_back( arg.data() );
+            }
+
+            argv.push_back( nullptr );
+
+            execvp( argv[0], argv.data() );
+
+            _exit( 127 );
+        }
+
+        const int exitCode = serveFitnessRequests< param_t, fitness_t >( channel, worker.segment->data(), objective_ );
+
+        std::cout.flush();
+        std::fflush( nullptr );
+
+        // Skips the destructors and exit handlers inherited from the pool's process
+        _exit( exitCode );
+    }
+
+
+    // Kills worker, if still alive, and starts a new one in its place
+    void restart( Worker& worker )
+    {
+        stopWorker( worker );
+
+        worker.rows = 0u;
+
+        numRestarts_.fetch_add( 1u, std::memory_order_relaxed );
+
+        spawn( worker );
+    }
+
+
+    // Kills and reaps worker if it is running
+    void stopWorker( Worker& worker )
+    {
+        if ( worker.pid > 0 )
+        {
+            kill( worker.pid, SIGKILL );
+            waitpid( worker.pid, nullptr, 0 );
+        }
+
+        if ( worker.channel >= 0 )
+        {
+            close( worker.channel );
+        }
+
+        worker.pid     = -1;
+        worker.channel = -1;
+    }
+
+
+    void dispatch( Worker& worker, Batch& batch )
+    {
+        if ( !batch.retries.empty() )
+        {
+            worker.begin = batch.retries.front();
+            worker.rows  = 1u;
+
+            batch.retries.pop_front();
+        }
+        else
+        {
+            worker.begin = batch.next;
+            worker.rows  = std::min( batch.chunk, batch.count - batch.next );
+
+            batch.next += worker.rows;
+        }
+
+        std::memcpy( worker.positions, batch.positions + worker.begin * numParams_, worker.rows * numParams_ * sizeof( param_t ) );
+
+        worker.deadline = timeout_.count() > 0.0
+            ? clock::now() + std::chrono::duration_cast< clock::duration >( timeout_ * static_cast< double >( worker.rows ) )
+            : clock::time_point::max();
+
+        const FitnessWorkerRequest request{ FitnessWorkerRequest::EVALUATE, static_cast< uint32_t >( worker.rows ), ++worker.sequence };
+
+        if ( !sendWorkerMessage( worker.channel, &request, sizeof( request ) ) )
+        {
+            numCrashes_.fetch_add( 1u, std::memory_order_relaxed );
+            fail( worker, batch );
+        }
+    }
+
+
+    // Waits until one of the active workers answers, dies or runs out of time
+    void wait( const std::vector< Worker* >& active, std::vector< pollfd >& fds, Batch& batch )
+    {
+        fds.clear();
+
+        clock::time_point deadline = clock::time_point::max();
+
+        for ( const Worker* worker : active )
+        {
+            fds.push_back( pollfd{ worker->channel, POLLIN, 0 } );
+            deadline = std::min( deadline, worker->deadline );
+        }
+
+        int timeoutMs = -1;
+
+        if ( deadline != clock::time_point::max() )
+        {
+            const auto left = std::chrono::duration_cast< std::chrono::milliseconds >( deadline - clock::now() ).count() + 1;
+            timeoutMs       = static_cast< int >( std::clamp< int64_t >( left, 0, std::numeric_limits< int >::max() ) );
+        }
+
+        if ( poll( fds.data(), fds.size(), timeoutMs ) < 0 && errno != EINTR )
+        {
+            throw std::system_error( errno, std::generic_category(), "FitnessWorkerPool: poll failed" );
+        }
+
+        const clock::time_point now = clock::now();
+
+        for ( size_t w = 0; w < active.size(); ++w )
+        {
+            Worker& worker = *active[w];
+
+            if ( fds[w].revents != 0 )
+            {
+                receive( worker, batch );
+            }
+            else if ( now >= worker.deadline )
+            {
+                numTimeouts_.fetch_add( 1u, std::memory_order_relaxed );
+                fail( worker, batch );
+            }
+        }
+    }
+
+
+    void receive( Worker& worker, Batch& batch )
+    {
+        FitnessWorkerResponse response;
+
+        if ( !receiveWorkerMessage( worker.channel, &response, sizeof( response ) ) || response.sequence != worker.sequence )
+        {
+            numCrashes_.fetch_add( 1u, std::memory_order_relaxed );
+            fail( worker, batch );
+            return;
+        }
+
+        if ( response.status != FitnessWorkerResponse::OK )
+        {
+            numErrors_.fetch_add( 1u, std::memory_order_relaxed );
+            fail( worker, batch );
+            return;
+        }
+
+        std::memcpy( batch.fitnesses + worker.begin, worker.fitnesses, worker.rows * sizeof( fitness_t ) );
+
+        worker.rows = 0u;
+    }
+
+
+    // The request in flight failed: restart the worker and retry its rows alone, or give up on a lone row
+    void fail( Worker& worker, Batch& batch )
+    {
+        if ( worker.rows > 1 )
+        {
+            for ( size_t r = 0; r < worker.rows; ++r )
+            {
+                batch.retries.push_back( worker.begin + r );
+            }
+        }
+        else
+        {
+            batch.fitnesses[worker.begin] = failureFitness_;
+            numFailed_.fetch_add( 1u, std::memory_order_relaxed );
+        }
+
+        if ( numRestarts_.load( std::memory_order_relaxed ) >= maxRestarts_ )
+        {
+            throw std::runtime_error( "FitnessWorkerPool: workers failed " + std::to_string( maxRestarts_ ) + " times" );
+        }
+
+        restart( worker );
+    }
+
+
+    size_t numParams_;
+    size_t maxBatch_;
+
+    batch_func_t objective_;
+    std::vector< std::string > command_;
+
+    std::vector< Worker > workers_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector< Worker* > idle_;
+
+    std::chrono::duration< double > timeout_;
+    fitness_t failureFitness_;
+    size_t maxRestarts_;
+
+    std::atomic< uint64_t > numCrashes_;
+    std::atomic< uint64_t > numTimeouts_;
+    std::atomic< uint64_t > numErrors_;
+    std::atomic< uint64_t > numRestarts_;
+    std::atomic< uint64_t > numFailed_;
+
+
+    FitnessWorkerPool() = delete;
+    FitnessWorkerPool( const FitnessWorkerPool& ) = delete;
+    FitnessWorkerPool& operator=( const FitnessWorkerPool& ) = delete;
+
+}; // class FitnessWorkerPool
+
+} // namespace MetaOpt
+
+#endif // FITNESS_WORKER_POOL_H
@@ -0,0 +1,256 @@
+#ifndef HARMONY_SEARCH_H
+#define HARMONY_SEARCH_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Harmony search (Geem et al.). The population is the harmony memory. Every parameter of a new harmony is taken,
+// with probability memoryRate, from a random member of the memory and then, with probability pitchRate, moved by
+// up to bandwidth times the width of the bounds; otherwise it is drawn uniformly. Instead of one harmony per step,
+// every iteration improvises a batch of harmonies from the same memory, evaluates them in parallel and merges the
+// batch in one step, each harmony replacing a worse member of the memory, worst first.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class HarmonySearch : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    static constexpr size_t  NUM_PARTICLES       = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS          = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_MEMORY_RATE = 0.9;
+    static constexpr param_t DEFAULT_PITCH_RATE  = 0.3;
+    static constexpr param_t DEFAULT_BANDWIDTH   = 0.01;
+    static constexpr size_t  DEFAULT_BATCH_SIZE  = 8;
+
+
+    // Constructor
+    HarmonySearch( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : HarmonySearch( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time. numParticles is the size of the harmony memory.
+    HarmonySearch( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                   const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , memoryRate_{ DEFAULT_MEMORY_RATE }
+        , pitchRate_{ DEFAULT_PITCH_RATE }
+        , bandwidth_{ DEFAULT_BANDWIDTH }
+        , batchSize_{ std::min( DEFAULT_BATCH_SIZE, numParticles ) }
+        , harmonies_{ numParticles, numParams, this->arena_ }
+        , picks_{ numParticles * numParams, this->arena_ }
+        , draws_{ 3 * numParticles * numParams, this->arena_ }
+        , batchOrder_( numParticles )
+        , memoryOrder_( numParticles )
+    {
+    }
+
+    // Destructor
+    virtual ~HarmonySearch() {}
+
+
+    void setMemoryRate( const param_t memoryRate ) { memoryRate_ = memoryRate; }
+    void setPitchRate( const param_t pitchRate )   { pitchRate_ = pitchRate; }
+
+    // Largest pitch adjustment as a fraction of the width of the bounds
+    void setBandwidth( const param_t bandwidth )   { bandwidth_ = bandwidth; }
+
+
+    // Harmonies improvised per iteration, between 1 and the size of the memory. Harmony k draws from the k-th
+    // particle stream, so results do not depend on the number of threads.
+    void setBatchSize( const size_t batchSize )
+    {
+        if ( batchSize == 0 || batchSize > this->getNumParticles() )
+        {
+            throw std::invalid_argument( "HarmonySearch::setBatchSize: the batch must hold between 1 and the memory size harmonies" );
+        }
+
+        batchSize_ = batchSize;
+    }
+
+    size_t getBatchSize() const { return batchSize_; }
+
+
+protected:
+
+    // Improvises harmonies [begin, end) of the batch
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+
+        for ( size_t k = begin; k < end; ++k )
+        {
+            Rng<>& rng = this->rngs_[k];
+
+            uint* picks    = picks_.data() + k * numParams;
+            param_t* draws = draws_.data() + 3 * k * numParams;
+
+            rng.choice( picks, numParams, static_cast< uint >( numParticles ), true );
+            rng.fillUniform( draws, 3 * numParams );
+
+            param_t* harmony = harmonies_.position( k );
+
+            // Memory consideration: parameter j from member picks[j], a gather along the contiguous memory
+            const param_t* memory = this->population_.position( 0 );
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                harmony[j] = memory[picks[j] * numParams + j];
+            }
+
+            improvise( harmony, draws, draws + numParams, draws + 2 * numParams, this->lowerBound_.data(), this->upperBound_.data(), numParams,
+                       memoryRate_, pitchRate_, bandwidth_ );
+        }
+    }
+
+
+    // Pitch adjustment or random choice of every parameter, both computed and one selected, so the loop has no
+    // branches. The amount draw doubles as the random value, as only one of the two is kept.
+    static inline void improvise( param_t* __restrict harmony, const param_t* __restrict considerDraws, const param_t* __restrict pitchDraws,
+                                  const param_t* __restrict amountDraws, const param_t* __restrict lowerBound, const param_t* __restrict upperBound,
+                                  const size_t numParams, const param_t memoryRate, const param_t pitchRate, const param_t bandwidth )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t width    = upperBound[j] - lowerBound[j];
+            const param_t shift    = pitchDraws[j] < pitchRate ? bandwidth * width * ( 2 * amountDraws[j] - 1 ) : static_cast< param_t >( 0 );
+            const param_t adjusted = std::min( std::max( harmony[j] + shift, lowerBound[j] ), upperBound[j] );
+            const param_t random   = lowerBound[j] + width * amountDraws[j];
+
+            harmony[j] = considerDraws[j] < memoryRate ? adjusted : random;
+        }
+    }
+
+
+    population_t& getCandidates() override { return harmonies_; }
+
+
+    // A harmony has to beat the worst member of the memory to be merged
+    fitness_t getRacingThreshold( const population_t&, const size_t, fitness_t& standardError2 ) const override
+    {
+        const fitness_t* memory = this->population_.fitnesses();
+        const size_t worst      = static_cast< size_t >( std::max_element( memory, memory + this->getNumParticles() ) - memory );
+        const uint32_t samples  = this->population_.sampleCount( worst );
+
+        standardError2 = samples > 1 ? this->population_.variance( worst ) / static_cast< fitness_t >( samples ) : fitness_t{};
+
+        return memory[worst];
+    }
+
+
+    void updateParticles() override
+    {
+        this->forEachChunk( batchSize_, [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::UPDATE, worker );
+
+                updateBlock( begin, end );
+            }
+
+            this->evaluateRange( harmonies_, begin, end, worker );
+        } );
+
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+        mergeBatch();
+    }
+
+
+    const char* getSnapshotTag() const override { return "HarmonySearch"; }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( memoryRate_ );
+        writer.write( pitchRate_ );
+        writer.write( bandwidth_ );
+        writer.write( static_cast< uint64_t >( batchSize_ ) );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        memoryRate_ = reader.read< param_t >();
+        pitchRate_  = reader.read< param_t >();
+        bandwidth_  = reader.read< param_t >();
+
+        setBatchSize( static_cast< size_t >( reader.read< uint64_t >() ) );
+    }
+
+
+private:
+
+    // Best harmonies of the batch against the worst members of the memory, pairwise, until a harmony is no better
+    void mergeBatch()
+    {
+        const size_t numParticles = this->getNumParticles();
+
+        std::iota( batchOrder_.begin(), batchOrder_.begin() + batchSize_, size_t{ 0 } );
+        std::sort( batchOrder_.begin(), batchOrder_.begin() + batchSize_, [this]( const size_t a, const size_t b )
+        {
+            return harmonies_.fitness( a ) < harmonies_.fitness( b );
+        } );
+
+        std::iota( memoryOrder_.begin(), memoryOrder_.end(), size_t{ 0 } );
+        std::partial_sort( memoryOrder_.begin(), memoryOrder_.begin() + batchSize_, memoryOrder_.end(), [this]( const size_t a, const size_t b )
+        {
+            return this->population_.fitness( a ) > this->population_.fitness( b );
+        } );
+
+        for ( size_t t = 0; t < batchSize_ && t < numParticles; ++t )
+        {
+            const size_t harmony = batchOrder_[t];
+            const size_t member  = memoryOrder_[t];
+
+            if ( !( harmonies_.fitness( harmony ) < this->population_.fitness( member ) ) )
+            {
+                break;
+            }
+
+            this->population_.copyParticle( member, harmonies_, harmony );
+        }
+    }
+
+
+    param_t memoryRate_;
+    param_t pitchRate_;
+    param_t bandwidth_;
+    size_t batchSize_;
+
+    population_t harmonies_;                                                        // The batch, in its first batchSize_ rows
+    AlignedArray< uint, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > picks_;
+    AlignedArray< param_t, extentProduct( extentProduct( 3, NUM_PARTICLES ), NUM_PARAMS ) > draws_;
+
+    std::vector< size_t > batchOrder_;
+    std::vector< size_t > memoryOrder_;
+
+
+    HarmonySearch() = delete;
+    HarmonySearch( const HarmonySearch& ) = delete;
+    HarmonySearch& operator=( const HarmonySearch& ) = delete;
+
+}; // class HarmonySearch
+
+} // namespace MetaOpt
+
+#endif // HARMONY_SEARCH_H
@@ -0,0 +1,411 @@
+#ifndef ISLAND_MODEL_H
+#define ISLAND_MODEL_H
+
+#include "Migration.h"
+#include "Observer.h"
+#include "SpscRing.h"
+#include "Termination.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+
+namespace MetaOpt
+{
+
+// Runs several independent instances of an optimizer, the islands, each on its own thread and with its own
+// population. Islands never wait for each other: every migrationInterval iterations an island posts copies of
+// its best particles to its neighbours' mailboxes and takes in whatever migrants have arrived in its own, where
+// they replace its worst particles. Every mailbox is a single-producer/single-consumer ring per topology edge,
+// so migration is lock-free. The objective is called from all island threads at once and must be thread-safe.
+template< typename __ALG_T >
+class IslandModel
+{
+public:
+
+    using alg_t        = __ALG_T;
+    using param_t      = typename alg_t::param_t;
+    using fitness_t    = typename alg_t::fitness_t;
+    using particle_t   = typename alg_t::particle_t;
+    using observer_t   = Observer< param_t, fitness_t >;
+    using view_t       = IterationView< param_t, fitness_t >;
+
+
+    using Topology = MigrationTopology;
+
+
+    static constexpr uint64_t DEFAULT_MIGRATION_INTERVAL = 10;
+    static constexpr size_t   DEFAULT_NUM_MIGRANTS       = 2;
+    static constexpr size_t   MAILBOX_CAPACITY           = 4;
+
+
+    IslandModel( const size_t numIslands, const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound )
+        : islands_( numIslands )
+        , mailboxes_{}
+        , topology_{ Topology::RING }
+        , torusColumns_{ 0u }
+        , migrationInterval_{ DEFAULT_MIGRATION_INTERVAL }
+        , numMigrants_{ DEFAULT_NUM_MIGRANTS }
+        , pinThreads_{ true }
+        , stop_{ false }
+    {
+        if ( numIslands == 0 )
+        {
+            throw std::invalid_argument( "IslandModel::IslandModel: at least one island is needed" );
+        }
+
+        for ( size_t i = 0; i < numIslands; ++i )
+        {
+            Island& island = islands_[i];
+
+            island.alg = std::make_unique< alg_t >( numParticles, numParams, lowerBound, upperBound, 1 );
+            island.alg->addObserver( std::make_shared< Migration >( *this, i ) );
+            island.alg->getTermination().setStopFlag( &stop_ );
+        }
+
+        setSeed( 0u );
+    }
+
+
+    ~IslandModel() = default;
+
+
+    // Islands are ordinary optimizers and can be configured one by one, e.g. with different parameters.
+    // Replacing an island's termination criteria also drops the model's stop flag.
+    alg_t& getIsland( const size_t idx ) { return *islands_[idx].alg; }
+    const alg_t& getIsland( const size_t idx ) const { return *islands_[idx].alg; }
+
+    size_t getNumIslands() const { return islands_.size(); }
+
+
+    // Island i draws from getIslandSeed( seed, i )
+    void setSeed( const uint64_t seed )
+    {
+        for ( size_t i = 0; i < islands_.size(); ++i )
+        {
+            islands_[i].alg->setSeed( getIslandSeed( seed, i ) );
+        }
+    }
+
+
+    void setMaxIterations( const uint64_t maxIterations )
+    {
+        for ( Island& island : islands_ )
+        {
+            island.alg->setMaxIterations( maxIterations );
+        }
+    }
+
+
+    void setFitnessFunc( typename alg_t::fitness_func_t fitnessFunc )
+    {
+        for ( Island& island : islands_ )
+        {
+            island.alg->setFitnessFunc( fitnessFunc );
+        }
+    }
+
+
+    void setBatchFitnessFunc( typename alg_t::batch_fitness_func_t batchFitnessFunc )
+    {
+        for ( Island& island : islands_ )
+        {
+            island.alg->setBatchFitnessFunc( batchFitnessFunc );
+        }
+    }
+
+
+    // columns only applies to TORUS and must divide the number of islands; 0 picks the squarest grid
+    void setTopology( const Topology topology, const size_t columns = 0u )
+    {
+        topology_     = topology;
+        torusColumns_ = columns;
+    }
+
+
+    // Every interval iterations each island sends its numMigrants best particles along the topology.
+    // An interval of 0 keeps the islands isolated.
+    void setMigration( const uint64_t interval, const size_t numMigrants )
+    {
+        migrationInterval_ = interval;
+        numMigrants_       = std::max< size_t >( numMigrants, 1u );
+    }
+
+
+    // Pins island i to the i-th CPU the process may run on, wrapping around
+    void setThreadPinning( const bool pin ) { pinThreads_ = pin; }
+
+
+    // Ends every island at its next iteration; also raised when an island reaches its target fitness
+    void requestStop() { stop_.store( true, std::memory_order_relaxed ); }
+
+
+    void run()
+    {
+        buildMailboxes();
+
+        stop_.store( false, std::memory_order_relaxed );
+
+        std::vector< std::thread > threads;
+        threads.reserve( islands_.size() );
+
+        const std::vector< int > cpus = pinThreads_ ? getAllowedCpus() : std::vector< int >{};
+
+        for ( size_t i = 0; i < islands_.size(); ++i )
+        {
+            threads.emplace_back( [this, i] { runIsland( i ); } );
+
+            if ( !cpus.empty() )
+            {
+                cpu_set_t set;
+                CPU_ZERO( &set );
+                CPU_SET( cpus[i % cpus.size()], &set );
+
+                // Best effort, e.g. containers may forbid it
+                pthread_setaffinity_np( threads.back().native_handle(), sizeof( set ), &set );
+            }
+        }
+
+        for ( std::thread& thread : threads )
+        {
+            thread.join();
+        }
+
+        for ( Island& island : islands_ )
+        {
+            if ( island.error )
+            {
+                std::rethrow_exception( island.error );
+            }
+        }
+    }
+
+
+    size_t getBestIsland() const
+    {
+        size_t best = 0;
+
+        for ( size_t i = 1; i < islands_.size(); ++i )
+        {
+            if ( islands_[i].alg->getBestParticle().fitness_ < islands_[best].alg->getBestParticle().fitness_ )
+            {
+                best = i;
+            }
+        }
+
+        return best;
+    }
+
+
+    particle_t getBestParticle() const { return islands_[getBestIsland()].alg->getBestParticle(); }
+
+
+    // Migration totals of the last run: messages posted, messages lost to full mailboxes, migrants taken in
+    uint64_t getNumSent() const { return sumStat( &Island::sent ); }
+    uint64_t getNumDropped() const { return sumStat( &Island::dropped ); }
+    uint64_t getNumAccepted() const { return sumStat( &Island::accepted ); }
+
+
+private:
+
+    struct alignas( CACHE_LINE_SIZE ) Island
+    {
+        std::unique_ptr< alg_t > alg;
+
+        std::vector< SpscRing* > inbox;
+        std::vector< SpscRing* > outbox;
+
+        std::vector< param_t > positions;
+        std::vector< fitness_t > fitnesses;
+
+        uint64_t sent     = 0u;
+        uint64_t dropped  = 0u;
+        uint64_t accepted = 0u;
+
+        std::exception_ptr error;
+    };
+
+
+    // Triggers the migration of one island from its own run loop
+    class Migration : public observer_t
+    {
+    public:
+
+        Migration( IslandModel& model, const size_t island )
+            : model_{ model }
+            , island_{ island }
+        {
+        }
+
+        void onIteration( const view_t& view ) override
+        {
+            if ( model_.migrationInterval_ > 0 && view.iteration % model_.migrationInterval_ == 0 )
+            {
+                model_.migrate( island_, view );
+            }
+        }
+
+    private:
+
+        IslandModel& model_;
+        size_t island_;
+    };
+
+
+    void runIsland( const size_t idx )
+    {
+        Island& island = islands_[idx];
+
+        try
+        {
+            island.alg->run();
+
+            if ( island.alg->getStopReason() == StopReason::TARGET_FITNESS )
+            {
+                requestStop();
+            }
+        }
+        catch ( ... )
+        {
+            island.error = std::current_exception();
+            requestStop();
+        }
+    }
+
+
+    void migrate( const size_t idx, const view_t& view )
+    {
+        Island& island = islands_[idx];
+        alg_t& alg     = *island.alg;
+
+        const size_t numParams = alg.getNumParams();
+        const size_t count     = std::min( numMigrants_, alg.getNumParticles() );
+
+        // Take in first, so the elites sent already include what neighbours found
+        for ( SpscRing* mailbox : island.inbox )
+        {
+            while ( const std::byte* slot = mailbox->tryPeek() )
+            {
+                const MigrationMessage message =
+                    MigrationMessage::decode( slot, island.fitnesses.data(), island.positions.data(), numMigrants_, numParams );
+
+                mailbox->release();
+
+                island.accepted += alg.immigrate( island.positions.data(), island.fitnesses.data(), message.count );
+            }
+        }
+
+        if ( island.outbox.empty() )
+        {
+            return;
+        }
+
+        alg.getElites( count, island.positions.data(), island.fitnesses.data() );
+
+        MigrationMessage message{};
+        message.kind        = MigrationMessage::MIGRANTS;
+        message.island      = static_cast< uint32_t >( idx );
+        message.iteration   = view.iteration;
+        message.evaluations = view.evaluations;
+        message.count       = static_cast< uint32_t >( count );
+        message.numParams   = static_cast< uint32_t >( numParams );
+
+        for ( SpscRing* mailbox : island.outbox )
+        {
+            std::byte* slot = mailbox->tryAcquire();
+
+            // A neighbour that has not caught up keeps the migrants it has not read yet
+            if ( !slot )
+            {
+                ++island.dropped;
+                continue;
+            }
+
+            MigrationMessage::encode( slot, message, island.fitnesses.data(), island.positions.data() );
+
+            mailbox->commit();
+
+            ++island.sent;
+        }
+    }
+
+
+    void buildMailboxes()
+    {
+        const size_t numIslands = islands_.size();
+        const size_t numParams  = islands_[0].alg->getNumParams();
+        const size_t slotSize   = MigrationMessage::getSize< param_t, fitness_t >( numMigrants_, numParams );
+
+        mailboxes_.clear();
+
+        for ( Island& island : islands_ )
+        {
+            island.inbox.clear();
+            island.outbox.clear();
+            island.positions.resize( numMigrants_ * numParams );
+            island.fitnesses.resize( numMigrants_ );
+            island.sent     = 0u;
+            island.dropped  = 0u;
+            island.accepted = 0u;
+            island.error    = nullptr;
+        }
+
+        for ( size_t from = 0; from < numIslands; ++from )
+        {
+            for ( const size_t to : getMigrationNeighbours( topology_, numIslands, from, torusColumns_ ) )
+            {
+                mailboxes_.push_back( std::make_unique< SpscRing >( slotSize, MAILBOX_CAPACITY ) );
+
+                islands_[from].outbox.push_back( mailboxes_.back().get() );
+                islands_[to].inbox.push_back( mailboxes_.back().get() );
+            }
+        }
+    }
+
+
+    uint64_t sumStat( uint64_t Island::*stat ) const
+    {
+        uint64_t sum = 0u;
+
+        for ( const Island& island : islands_ )
+        {
+            sum += island.*stat;
+        }
+
+        return sum;
+    }
+
+
+    std::vector< Island > islands_;
+    std::vector< std::unique_ptr< SpscRing > > mailboxes_;
+
+    Topology topology_;
+    size_t torusColumns_;
+
+    uint64_t migrationInterval_;
+    size_t numMigrants_;
+
+    bool pinThreads_;
+
+    std::atomic< bool > stop_;
+
+
+    IslandModel() = delete;
+    IslandModel( const IslandModel& ) = delete;
+    IslandModel& operator=( const IslandModel& ) = delete;
+
+}; // class IslandModel
+
+} // namespace MetaOpt
+
+#endif // ISLAND_MODEL_H
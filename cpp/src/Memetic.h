@@ -0,0 +1,402 @@
+#ifndef MEMETIC_H
+#define MEMETIC_H
+
+
+#include "Checkpoint.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Memetic mode for any optimizer: after every generation of the wrapped algorithm its best particles are refined by
+// Hooke-Jeeves pattern search, the searches running concurrently on the algorithm's thread pool. Refined points are
+// always offered to the best particle; whether they also go back into the population depends on the inheritance:
+//  - LAMARCKIAN: the particle moves to the refined point, as an immigrant would (onParticleReplaced is called).
+//  - BALDWINIAN: the particle keeps its position and only takes the refined fitness, so selection favours particles
+//    that lead to good points without collapsing the population onto them.
+// The searches share a per-generation evaluation budget, counted in getEvaluationCount() like any other evaluation.
+//
+//     Memetic< DifferentialEvolution< DYNAMIC_EXTENT, DYNAMIC_EXTENT > > alg( numParticles, numParams, lower, upper, numThreads );
+//
+// The steady-state mode of DifferentialEvolution bypasses the generation loop and gets no local search.
+template< typename __ALG_T >
+class Memetic : public __ALG_T
+{
+public:
+
+    using alg_t      = __ALG_T;
+    using param_t    = typename alg_t::param_t;
+    using fitness_t  = typename alg_t::fitness_t;
+    using particle_t = typename alg_t::particle_t;
+
+
+    enum class Inheritance
+    {
+        LAMARCKIAN,
+        BALDWINIAN
+    };
+
+
+    static constexpr size_t   DEFAULT_NUM_ELITES    = 2;
+    static constexpr param_t  DEFAULT_INITIAL_STEP  = 0.05;     // Fraction of the width of the bounds
+    static constexpr param_t  DEFAULT_MIN_STEP      = 1e-9;
+
+
+    // Takes the arguments of the wrapped algorithm's constructor
+    template< typename... Args >
+    explicit Memetic( Args&&... args )
+        : alg_t( std::forward< Args >( args )... )
+        , inheritance_{ Inheritance::LAMARCKIAN }
+        , numElites_{ DEFAULT_NUM_ELITES }
+        , evaluationBudget_{ 0u }
+        , interval_{ 1u }
+        , initialStep_{ DEFAULT_INITIAL_STEP }
+        , minStep_{ DEFAULT_MIN_STEP }
+        , numSearches_{ 0u }
+        , numImproved_{ 0u }
+        , snapshotTag_{ ( std::string( "Memetic" ) + alg_t::getSnapshotTag() ).substr( 0, SnapshotHeader::TAG_SIZE - 1 ) }
+        , records_( this->getNumParticles() )
+        , elites_( this->getNumParticles() )
+        , searches_{}
+        , scratch_{}
+    {
+    }
+
+    // Destructor
+    virtual ~Memetic() {}
+
+
+    // numElites best particles are refined every interval generations, sharing evaluationBudget evaluations
+    // per generation (0 gives each elite two per parameter, one compass sweep). An interval of 0 turns local
+    // search off.
+    void setLocalSearch( const size_t numElites, const uint64_t evaluationBudget, const uint64_t interval = 1u )
+    {
+        numElites_        = std::max< size_t >( numElites, 1u );
+        evaluationBudget_ = evaluationBudget;
+        interval_         = interval;
+    }
+
+
+    void setInheritance( const Inheritance inheritance ) { inheritance_ = inheritance; }
+
+
+    // Pattern search starts from initialStep times the width of the bounds and halves it down to minStep. A
+    // particle refined again before anything else moved it resumes from the step it ended with.
+    void setStepSizes( const param_t initialStep, const param_t minStep )
+    {
+        initialStep_ = initialStep;
+        minStep_     = minStep;
+    }
+
+
+    // Local searches run, and those that improved on their particle, during the last run
+    uint64_t getNumSearches() const { return numSearches_; }
+    uint64_t getNumImproved() const { return numImproved_; }
+
+
+protected:
+
+    void updateParticles() override
+    {
+        alg_t::updateParticles();
+
+        if ( interval_ > 0 && ( this->iteration_ + 1 ) % interval_ == 0 )
+        {
+            refineElites();
+        }
+    }
+
+
+    void postInitialize() override
+    {
+        alg_t::postInitialize();
+
+        std::fill( records_.begin(), records_.end(), Record{} );
+
+        numSearches_ = 0u;
+        numImproved_ = 0u;
+    }
+
+
+    const char* getSnapshotTag() const override { return snapshotTag_.c_str(); }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        alg_t::saveState( writer );
+
+        writer.write( static_cast< uint32_t >( inheritance_ ) );
+        writer.write( static_cast< uint64_t >( numElites_ ) );
+        writer.write( evaluationBudget_ );
+        writer.write( interval_ );
+        writer.write( initialStep_ );
+        writer.write( minStep_ );
+        writer.write( numSearches_ );
+        writer.write( numImproved_ );
+        writer.writeArray( records_.data(), records_.size() );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        alg_t::loadState( reader );
+
+        inheritance_      = static_cast< Inheritance >( reader.read< uint32_t >() );
+        numElites_        = static_cast< size_t >( reader.read< uint64_t >() );
+        evaluationBudget_ = reader.read< uint64_t >();
+        interval_         = reader.read< uint64_t >();
+        initialStep_      = reader.read< param_t >();
+        minStep_          = reader.read< param_t >();
+        numSearches_      = reader.read< uint64_t >();
+        numImproved_      = reader.read< uint64_t >();
+        reader.readArray( records_.data(), records_.size() );
+    }
+
+
+private:
+
+    // Last refinement of a particle. Still valid while the population holds fitness for it.
+    struct Record
+    {
+        fitness_t fitness = fitness_t{};        // As written back
+        fitness_t trueFitness = fitness_t{};    // Of the particle's position, differs under BALDWINIAN
+        param_t step = param_t{};
+        uint32_t valid = 0u;
+    };
+
+
+    struct Search
+    {
+        size_t particle;
+        uint64_t budget;
+        fitness_t startFitness;
+        param_t step;
+        fitness_t fitness;      // Best found
+    };
+
+
+    void refineElites()
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+        const size_t numElites    = std::min( numElites_, numParticles );
+
+        std::iota( elites_.begin(), elites_.end(), size_t{ 0 } );
+        std::partial_sort( elites_.begin(), elites_.begin() + numElites, elites_.end(), [this]( const size_t a, const size_t b )
+        {
+            return this->population_.fitness( a ) < this->population_.fitness( b );
+        } );
+
+        const uint64_t budget   = evaluationBudget_ > 0 ? evaluationBudget_ : 2u * numParams * numElites;
+        const uint64_t share    = budget / numElites;
+        const uint64_t leftover = budget % numElites;
+
+        searches_.resize( numElites );
+        scratch_.resize( 3 * numElites * numParams );
+
+        for ( size_t t = 0; t < numElites; ++t )
+        {
+            const size_t particle = elites_[t];
+            const Record& record  = records_[particle];
+
+            const bool resumed = record.valid && record.fitness == this->population_.fitness( particle );
+
+            Search& search = searches_[t];
+
+            search.particle     = particle;
+            search.budget       = share + ( t < leftover ? 1u : 0u );
+            search.startFitness = resumed ? record.trueFitness : this->population_.fitness( particle );
+            search.step         = resumed ? record.step : initialStep_;
+            search.fitness      = search.startFitness;
+
+            std::memcpy( scratch_.data() + 3 * t * numParams, this->population_.position( particle ), numParams * sizeof( param_t ) );
+        }
+
+        this->forEachChunk( numElites, [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::EVALUATE, worker );
+
+            for ( size_t t = begin; t < end; ++t )
+            {
+                patternSearch( searches_[t], scratch_.data() + 3 * t * this->getNumParams(), worker );
+            }
+        } );
+
+        // Written back in rank order on this thread
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+        for ( size_t t = 0; t < numElites; ++t )
+        {
+            const Search& search   = searches_[t];
+            const param_t* refined = scratch_.data() + 3 * t * numParams;
+            Record& record         = records_[search.particle];
+
+            ++numSearches_;
+
+            record.step  = search.step;
+            record.valid = 1u;
+
+            if ( !( search.fitness < search.startFitness ) )
+            {
+                record.fitness     = this->population_.fitness( search.particle );
+                record.trueFitness = search.startFitness;
+                continue;
+            }
+
+            ++numImproved_;
+
+            this->bestParticle_->trialPosition( refined, search.fitness );
+
+            if ( inheritance_ == Inheritance::LAMARCKIAN )
+            {
+                std::memcpy( this->population_.position( search.particle ), refined, numParams * sizeof( param_t ) );
+                this->population_.fitness( search.particle ) = search.fitness;
+                this->population_.resetSamples( search.particle );
+
+                this->onParticleReplaced( search.particle );
+
+                record.trueFitness = search.fitness;
+            }
+            else
+            {
+                this->population_.fitness( search.particle ) = std::min( this->population_.fitness( search.particle ), search.fitness );
+            }
+
+            record.fitness = this->population_.fitness( search.particle );
+        }
+    }
+
+
+    // Hooke-Jeeves from rows[0], which holds the best point found on return; rows[1] and rows[2] are scratch
+    void patternSearch( Search& search, param_t* rows, const size_t worker )
+    {
+        const size_t numParams = this->getNumParams();
+
+        param_t* base     = rows;
+        param_t* trial    = rows + numParams;
+        param_t* previous = rows + 2 * numParams;
+
+        uint64_t evaluations = 0u;
+
+        fitness_t baseFitness = search.startFitness;
+
+        while ( evaluations < search.budget && search.step >= minStep_ )
+        {
+            std::memcpy( trial, base, numParams * sizeof( param_t ) );
+
+            fitness_t trialFitness = explore( trial, baseFitness, search.step, search.budget, evaluations, worker );
+
+            if ( !( trialFitness < baseFitness ) )
+            {
+                search.step *= static_cast< param_t >( 0.5 );
+                continue;
+            }
+
+            // Pattern moves along the last improvement for as long as exploring around them keeps improving
+            while ( trialFitness < baseFitness )
+            {
+                std::memcpy( previous, base, numParams * sizeof( param_t ) );
+                std::memcpy( base, trial, numParams * sizeof( param_t ) );
+                baseFitness = trialFitness;
+
+                if ( evaluations >= search.budget )
+                {
+                    break;
+                }
+
+                for ( size_t j = 0; j < numParams; ++j )
+                {
+                    trial[j] = std::min( std::max( 2 * base[j] - previous[j], this->lowerBound_[j] ), this->upperBound_[j] );
+                }
+
+                trialFitness = this->evaluatePosition( trial, worker );
+                ++evaluations;
+
+                trialFitness = explore( trial, trialFitness, search.step, search.budget, evaluations, worker );
+            }
+        }
+
+        search.fitness = baseFitness;
+    }
+
+
+    // Compass moves of one step along every parameter of point, keeping those that improve; returns its fitness
+    fitness_t explore( param_t* point, fitness_t fitness, const param_t step, const uint64_t budget, uint64_t& evaluations, const size_t worker )
+    {
+        for ( size_t j = 0; j < this->getNumParams() && evaluations < budget; ++j )
+        {
+            const param_t original = point[j];
+            const param_t delta    = step * ( this->upperBound_[j] - this->lowerBound_[j] );
+
+            point[j] = std::min( original + delta, this->upperBound_[j] );
+
+            fitness_t moved = this->evaluatePosition( point, worker );
+            ++evaluations;
+
+            if ( moved < fitness )
+            {
+                fitness = moved;
+                continue;
+            }
+
+            if ( evaluations >= budget )
+            {
+                point[j] = original;
+                break;
+            }
+
+            point[j] = std::max( original - delta, this->lowerBound_[j] );
+
+            moved = this->evaluatePosition( point, worker );
+            ++evaluations;
+
+            if ( moved < fitness )
+            {
+                fitness = moved;
+                continue;
+            }
+
+            point[j] = original;
+        }
+
+        return fitness;
+    }
+
+
+    Inheritance inheritance_;
+    size_t numElites_;
+    uint64_t evaluationBudget_;
+    uint64_t interval_;
+    param_t initialStep_;
+    param_t minStep_;
+
+    uint64_t numSearches_;
+    uint64_t numImproved_;
+
+    std::string snapshotTag_;
+
+    std::vector< Record > records_;
+    std::vector< size_t > elites_;
+    std::vector< Search > searches_;
+    std::vector< param_t > scratch_;        // Three rows per elite
+
+
+    Memetic() = delete;
+    Memetic( const Memetic& ) = delete;
+    Memetic& operator=( const Memetic& ) = delete;
+
+}; // class Memetic
+
+} // namespace MetaOpt
+
+#endif // MEMETIC_H
@@ -0,0 +1,198 @@
+#ifndef MIGRATION_H
+#define MIGRATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <sched.h>
+
+
+namespace MetaOpt
+{
+
+// Who sends migrants to whom in an island model
+enum class MigrationTopology
+{
+    RING,       // Island i sends to i + 1
+    TORUS,      // Islands on a rows x columns grid with wrap-around, each sending to its four neighbours
+    FULL        // Every island sends to every other one
+};
+
+
+// Distinct islands that island idx sends to. columns only applies to TORUS and must divide numIslands;
+// 0 picks the squarest grid.
+inline std::vector< size_t > getMigrationNeighbours( const MigrationTopology topology, const size_t numIslands, const size_t idx,
+                                                     size_t columns = 0u )
+{
+    std::vector< size_t > neighbours;
+
+    switch ( topology )
+    {
+        case MigrationTopology::RING:
+            neighbours.push_back( ( idx + 1 ) % numIslands );
+            break;
+
+        case MigrationTopology::TORUS:
+        {
+            if ( columns == 0 )
+            {
+                size_t rows = static_cast< size_t >( std::sqrt( static_cast< double >( numIslands ) ) );
+
+                while ( numIslands % rows != 0 )
+                {
+                    --rows;
+                }
+
+                columns = numIslands / rows;
+            }
+            else if ( numIslands % columns != 0 )
+            {
+                throw std::invalid_argument( "getMigrationNeighbours: the torus columns must divide the number of islands" );
+            }
+
+            const size_t rows   = numIslands / columns;
+            const size_t row    = idx / columns;
+            const size_t column = idx % columns;
+
+            neighbours.push_back( ( ( row + rows - 1 ) % rows ) * columns + column );
+            neighbours.push_back( ( ( row + 1 ) % rows ) * columns + column );
+            neighbours.push_back( row * columns + ( column + columns - 1 ) % columns );
+            neighbours.push_back( row * columns + ( column + 1 ) % columns );
+            break;
+        }
+
+        case MigrationTopology::FULL:
+            for ( size_t i = 0; i < numIslands; ++i )
+            {
+                neighbours.push_back( i );
+            }
+            break;
+    }
+
+    std::sort( neighbours.begin(), neighbours.end() );
+    neighbours.erase( std::unique( neighbours.begin(), neighbours.end() ), neighbours.end() );
+    neighbours.erase( std::remove( neighbours.begin(), neighbours.end(), idx ), neighbours.end() );
+
+    return neighbours;
+}
+
+
+// Seed of island idx: SplitMix64 of seed + idx, so the islands start from different populations
+inline uint64_t getIslandSeed( const uint64_t seed, const size_t idx )
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull * ( static_cast< uint64_t >( idx ) + 1u );
+
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+
+    return z ^ ( z >> 31 );
+}
+
+
+
+// CPUs this process may run on, in ascending order; islands are pinned to them round-robin
+inline std::vector< int > getAllowedCpus()
+{
+    std::vector< int > cpus;
+
+    cpu_set_t set;
+    CPU_ZERO( &set );
+
+    if ( sched_getaffinity( 0, sizeof( set ), &set ) == 0 )
+    {
+        for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+        {
+            if ( CPU_ISSET( cpu, &set ) )
+            {
+                cpus.push_back( cpu );
+            }
+        }
+    }
+
+    return cpus;
+}
+
+
+
+// Message exchanged between islands, and between islands and a coordinator: this header, count fitnesses padded
+// to 8 bytes, then count position rows. Every field has a fixed width and size covers the whole message, so a
+// stream transport such as a socket frames messages by reading the header first. Shared memory rings carry the
+// same bytes in fixed-size slots.
+struct MigrationMessage
+{
+    enum Kind : uint32_t
+    {
+        MIGRANTS,       // Island to island: elites to take in
+        PROGRESS,       // Island to coordinator: best particle so far
+        FINISHED        // Island to coordinator: final best particle and stopReason
+    };
+
+    uint32_t kind;
+    uint32_t island;        // Sender
+    uint64_t size;          // Bytes including this header
+    uint64_t iteration;
+    uint64_t evaluations;
+    uint32_t count;
+    uint32_t numParams;
+    uint16_t paramSize;
+    uint16_t fitnessSize;
+    uint32_t stopReason;
+
+
+    static size_t getFitnessesOffset() { return sizeof( MigrationMessage ); }
+
+    template< typename fitness_t >
+    static size_t getPositionsOffset( const size_t count )
+    {
+        return sizeof( MigrationMessage ) + ( ( count * sizeof( fitness_t ) + 7u ) & ~size_t{ 7u } );
+    }
+
+    template< typename param_t, typename fitness_t >
+    static size_t getSize( const size_t count, const size_t numParams )
+    {
+        return getPositionsOffset< fitness_t >( count ) + count * numParams * sizeof( param_t );
+    }
+
+
+    // Writes header and payload to out, which holds at least getSize() bytes; fills size and the type sizes
+    template< typename param_t, typename fitness_t >
+    static void encode( std::byte* out, MigrationMessage header, const fitness_t* fitnesses, const param_t* positions )
+    {
+        header.size        = getSize< param_t, fitness_t >( header.count, header.numParams );
+        header.paramSize   = sizeof( param_t );
+        header.fitnessSize = sizeof( fitness_t );
+
+        std::memcpy( out, &header, sizeof( header ) );
+        std::memcpy( out + getFitnessesOffset(), fitnesses, header.count * sizeof( fitness_t ) );
+        std::memcpy( out + getPositionsOffset< fitness_t >( header.count ), positions, header.count * header.numParams * sizeof( param_t ) );
+    }
+
+
+    // Reads the header of in and copies at most maxCount particles of numParams to fitnesses and positions
+    template< typename param_t, typename fitness_t >
+    static MigrationMessage decode( const std::byte* in, fitness_t* fitnesses, param_t* positions, const size_t maxCount, const size_t numParams )
+    {
+        MigrationMessage header;
+        std::memcpy( &header, in, sizeof( header ) );
+
+        if ( header.paramSize != sizeof( param_t ) || header.fitnessSize != sizeof( fitness_t ) || header.numParams != numParams ||
+             header.count > maxCount || header.size != getSize< param_t, fitness_t >( header.count, numParams ) )
+        {
+            throw std::runtime_error( "MigrationMessage::decode: message does not match this island model" );
+        }
+
+        std::memcpy( fitnesses, in + getFitnessesOffset(), header.count * sizeof( fitness_t ) );
+        std::memcpy( positions, in + getPositionsOffset< fitness_t >( header.count ), header.count * numParams * sizeof( param_t ) );
+
+        return header;
+    }
+};
+
+} // namespace MetaOpt
+
+#endif // MIGRATION_H
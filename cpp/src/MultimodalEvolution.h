@@ -0,0 +1,596 @@
+#ifndef MULTIMODAL_EVOLUTION_H
+#define MULTIMODAL_EVOLUTION_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Differential evolution (rand/1/bin) that keeps several optima at once. Niches are balls of nicheRadius, and
+// selection is niched in one of three ways:
+//  - SHARING: fitness is shared among the particles of a niche, sh( d ) = 1 - ( d / nicheRadius )^alpha, and a
+//    trial replaces its parent if its shared fitness is better. Fitness is turned into a positive goodness against
+//    the worst of the generation first, as sharing divides it.
+//  - CLEARING: in order of fitness, a particle keeps its place only if fewer than nicheCapacity better survivors lie
+//    within the radius. Cleared particles are replaced by their trial whatever its fitness.
+//  - CROWDING: a trial replaces the particle of the population nearest to it if better (Thomsen's crowding DE).
+// Neighbours are found through a uniform grid over the population, rebuilt every generation and queried in
+// parallel, so a generation costs about O( N k D ) for k particles per niche instead of O( N^2 D ).
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class MultimodalEvolution : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    enum class Niching
+    {
+        SHARING,
+        CLEARING,
+        CROWDING
+    };
+
+
+    static constexpr size_t  NUM_PARTICLES                 = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS                    = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_MUTATION_FACTOR       = 0.5;
+    static constexpr param_t DEFAULT_CROSSOVER_PROBABILITY = 0.9;
+    static constexpr param_t DEFAULT_NICHE_RADIUS          = 0.1;      // Fraction of the mean width of the bounds
+    static constexpr param_t DEFAULT_SHARING_EXPONENT      = 1;
+    static constexpr size_t  DEFAULT_NICHE_CAPACITY        = 1;
+
+
+    // Constructor
+    MultimodalEvolution( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : MultimodalEvolution( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    MultimodalEvolution( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                         const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , niching_{ Niching::CROWDING }
+        , mutation_{ DEFAULT_MUTATION_FACTOR }
+        , crossProb_{ DEFAULT_CROSSOVER_PROBABILITY }
+        , nicheRadius_{ 0 }
+        , sharingExponent_{ DEFAULT_SHARING_EXPONENT }
+        , nicheCapacity_{ DEFAULT_NICHE_CAPACITY }
+        , trials_{ numParticles, numParams, this->arena_ }
+        , crossDraws_{ numParticles * numParams, this->arena_ }
+        , grid_{}
+        , nicheCounts_( numParticles )
+        , trialCounts_( numParticles )
+        , goodnessOffset_{ 0 }
+        , ranks_( numParticles )
+        , order_( numParticles )
+        , cleared_( numParticles )
+        , neighbourOffsets_( numParticles + 1 )
+        , betterNeighbours_{}
+        , nearest_( numParticles )
+        , numNiches_{ 0u }
+    {
+        if ( numParticles < 3 )
+        {
+            throw std::invalid_argument( "MultimodalEvolution::MultimodalEvolution: at least 3 particles are needed" );
+        }
+
+        nicheRadius_ = DEFAULT_NICHE_RADIUS * getMeanWidth();
+    }
+
+    // Destructor
+    virtual ~MultimodalEvolution() {}
+
+
+    void setNiching( const Niching niching )                 { niching_ = niching; }
+    void setMutationFactor( const param_t mutation )        { mutation_ = mutation; }
+    void setCrossoverProbability( const param_t crossProb ) { crossProb_ = crossProb; }
+
+
+    // Radius of a niche, in units of the parameters
+    void setNicheRadius( const param_t nicheRadius )
+    {
+        if ( !( nicheRadius > 0 ) )
+        {
+            throw std::invalid_argument( "MultimodalEvolution::setNicheRadius: the radius must be positive" );
+        }
+
+        nicheRadius_ = nicheRadius;
+    }
+
+    param_t getNicheRadius() const { return nicheRadius_; }
+
+
+    // alpha of the sharing function
+    void setSharingExponent( const param_t sharingExponent ) { sharingExponent_ = sharingExponent; }
+
+    // Survivors per niche under CLEARING
+    void setNicheCapacity( const size_t nicheCapacity ) { nicheCapacity_ = std::max< size_t >( nicheCapacity, 1u ); }
+
+
+    // Niches that survived the last clearing
+    size_t getNumNiches() const { return numNiches_; }
+
+
+    // Distinct optima found: the best particle of every niche, best first, taking particles in order of fitness and
+    // skipping those within the niche radius of one already taken. Only optima within tolerance of the best are
+    // reported. Copies at most maxCount of them to rows of positions and to fitnesses and returns how many. Call
+    // between iterations only.
+    size_t getOptima( const size_t maxCount, param_t* positions, fitness_t* fitnesses,
+                      const fitness_t tolerance = std::numeric_limits< fitness_t >::infinity() ) const
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+        const param_t radius2     = nicheRadius_ * nicheRadius_;
+
+        std::vector< size_t > order( numParticles );
+        std::iota( order.begin(), order.end(), size_t{ 0 } );
+        std::stable_sort( order.begin(), order.end(), [this]( const size_t a, const size_t b )
+        {
+            return this->population_.fitness( a ) < this->population_.fitness( b );
+        } );
+
+        std::vector< size_t > seeds;
+
+        for ( size_t r = 0; r < numParticles && seeds.size() < maxCount; ++r )
+        {
+            const size_t i = order[r];
+
+            if ( this->population_.fitness( i ) > this->population_.fitness( order[0] ) + tolerance )
+            {
+                break;
+            }
+
+            const bool covered = std::any_of( seeds.begin(), seeds.end(), [this, i, numParams, radius2]( const size_t seed )
+            {
+                return grid_t::squaredDistance( this->population_.position( i ), this->population_.position( seed ), numParams ) < radius2;
+            } );
+
+            if ( !covered )
+            {
+                seeds.push_back( i );
+            }
+        }
+
+        for ( size_t m = 0; m < seeds.size(); ++m )
+        {
+            std::memcpy( positions + m * numParams, this->population_.position( seeds[m] ), numParams * sizeof( param_t ) );
+            fitnesses[m] = this->population_.fitness( seeds[m] );
+        }
+
+        return seeds.size();
+    }
+
+
+protected:
+
+    using grid_t = SpatialGrid< param_t >;
+
+
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            uint mutationIndices[3];
+            rng.choice( mutationIndices, static_cast< uint >( this->getNumParticles() ), false );
+
+            param_t* crossDraws = crossDraws_.data() + i * numParams;
+
+            rng.fillUniform( crossDraws, numParams );
+
+            mutateParticle( trials_.position( i ), this->population_.position( i ), this->population_.position( mutationIndices[0] ),
+                            this->population_.position( mutationIndices[1] ), this->population_.position( mutationIndices[2] ),
+                            crossDraws, this->lowerBound_.data(), this->upperBound_.data(), numParams, mutation_, crossProb_ );
+        }
+    }
+
+
+    static inline void mutateParticle( param_t* __restrict trial, const param_t* __restrict target, const param_t* __restrict mutant0,
+                                       const param_t* __restrict mutant1, const param_t* __restrict mutant2, const param_t* __restrict crossDraws,
+                                       const param_t* __restrict lowerBound, const param_t* __restrict upperBound, const size_t numParams,
+                                       const param_t mutation, const param_t crossProb )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            const param_t mutated = mutant0[j] + mutation * ( mutant1[j] - mutant2[j] );
+            const param_t crossed = crossDraws[j] > crossProb ? target[j] : mutated;
+
+            trial[j] = std::min( std::max( crossed, lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    population_t& getCandidates() override { return trials_; }
+
+
+    // Trials are compared against the population as it was when the generation started
+    void selectBlock( const size_t begin, const size_t end ) override
+    {
+        switch ( niching_ )
+        {
+        case Niching::SHARING:
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const fitness_t trialScore  = goodness( trials_.fitness( i ) ) / trialCounts_[i];
+                const fitness_t parentScore = goodness( this->population_.fitness( i ) ) / nicheCounts_[i];
+
+                if ( trialScore > parentScore )
+                {
+                    this->population_.copyParticle( i, trials_, i );
+                }
+            }
+            break;
+
+        case Niching::CLEARING:
+            for ( size_t i = begin; i < end; ++i )
+            {
+                if ( cleared_[i] || trials_.fitness( i ) < this->population_.fitness( i ) )
+                {
+                    this->population_.copyParticle( i, trials_, i );
+                }
+            }
+            break;
+
+        case Niching::CROWDING:
+            // Replaced serially in updateParticles
+            break;
+        }
+    }
+
+
+    // Each trial races against what selectBlock compares it with:
+    //  - CROWDING: the particle nearest to it, looked up before evaluation;
+    //  - CLEARING: its parent, unless the parent was cleared and the trial wins anyway;
+    //  - SHARING: shared fitness depends on the offset set from all trials' fitness, so there is no raw fitness
+    //    bound to race against before the whole generation is evaluated. Every trial gets maxSamples.
+    fitness_t getRacingThreshold( const population_t& candidates, const size_t idx, fitness_t& standardError2 ) const override
+    {
+        if ( &candidates != &trials_ || niching_ == Niching::SHARING || ( niching_ == Niching::CLEARING && cleared_[idx] ) )
+        {
+            standardError2 = fitness_t{};
+            return std::numeric_limits< fitness_t >::max();
+        }
+
+        const size_t rival     = niching_ == Niching::CROWDING ? nearest_[idx] : idx;
+        const uint32_t samples = this->population_.sampleCount( rival );
+
+        standardError2 = samples > 1 ? this->population_.variance( rival ) / static_cast< fitness_t >( samples ) : fitness_t{};
+
+        return this->population_.fitness( rival );
+    }
+
+
+    void updateParticles() override
+    {
+        rebuildGrid();
+
+        if ( niching_ == Niching::SHARING )
+        {
+            this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    nicheCounts_[i] = nicheCount( this->population_.position( i ), this->getNumParticles() );
+                }
+            } );
+        }
+        else if ( niching_ == Niching::CLEARING )
+        {
+            clearNiches();
+        }
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::UPDATE, worker );
+
+                updateBlock( begin, end );
+
+                // Against the grid of the population as it was before selection, and before evaluation so that
+                // racing knows each trial's rival
+                if ( niching_ == Niching::CROWDING )
+                {
+                    for ( size_t i = begin; i < end; ++i )
+                    {
+                        param_t distance2;
+                        nearest_[i] = static_cast< uint32_t >( grid_.nearest( trials_.position( i ), distance2 ) );
+                    }
+                }
+            }
+
+            this->evaluateRange( trials_, begin, end, worker );
+        } );
+
+        if ( niching_ == Niching::SHARING )
+        {
+            // Trials are counted against the population before any of it is replaced, each leaving out its parent
+            this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    trialCounts_[i] = 1 + nicheCount( trials_.position( i ), i );
+                }
+            } );
+
+            setGoodnessOffset();
+        }
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+            selectBlock( begin, end );
+        } );
+
+        if ( niching_ == Niching::CROWDING )
+        {
+            // In trial order on this thread, as two trials may share their nearest particle
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+            for ( size_t i = 0; i < this->getNumParticles(); ++i )
+            {
+                if ( trials_.fitness( i ) < this->population_.fitness( nearest_[i] ) )
+                {
+                    this->population_.copyParticle( nearest_[i], trials_, i );
+                }
+            }
+        }
+    }
+
+
+    const char* getSnapshotTag() const override { return "MultimodalEvolution"; }
+
+
+    // The grid is rebuilt every generation, only the parameters need saving
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( static_cast< uint32_t >( niching_ ) );
+        writer.write( mutation_ );
+        writer.write( crossProb_ );
+        writer.write( nicheRadius_ );
+        writer.write( sharingExponent_ );
+        writer.write( static_cast< uint64_t >( nicheCapacity_ ) );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        niching_         = static_cast< Niching >( reader.read< uint32_t >() );
+        mutation_        = reader.read< param_t >();
+        crossProb_       = reader.read< param_t >();
+        nicheRadius_     = reader.read< param_t >();
+        sharingExponent_ = reader.read< param_t >();
+        nicheCapacity_   = static_cast< size_t >( reader.read< uint64_t >() );
+    }
+
+
+private:
+
+    param_t getMeanWidth() const
+    {
+        param_t width = 0;
+
+        for ( size_t j = 0; j < this->getNumParams(); ++j )
+        {
+            width += this->upperBound_[j] - this->lowerBound_[j];
+        }
+
+        return width / static_cast< param_t >( this->getNumParams() );
+    }
+
+
+    // Cells of the niche radius, or for crowding of about one particle each, as the nearest particle may lie
+    // anywhere
+    void rebuildGrid()
+    {
+        param_t cellSize = nicheRadius_;
+
+        if ( niching_ == Niching::CROWDING )
+        {
+            const size_t gridDims = std::min( this->getNumParams(), grid_t::MAX_GRID_DIMS );
+
+            cellSize = getMeanWidth() / std::pow( static_cast< param_t >( this->getNumParticles() ), static_cast< param_t >( 1 ) / static_cast< param_t >( gridDims ) );
+        }
+
+        grid_.rebuild( this->population_.position( 0 ), this->getNumParticles(), this->getNumParams(), this->lowerBound_.data(), this->upperBound_.data(),
+                       cellSize, [this]( const size_t count, auto&& func )
+        {
+            this->forEachChunk( count, [this, &func]( const size_t begin, const size_t end, const size_t worker )
+            {
+                Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+                func( begin, end, worker );
+            } );
+        } );
+    }
+
+
+    // Sum of the sharing function over the population around point, particle skip left out
+    fitness_t nicheCount( const param_t* point, const size_t skip ) const
+    {
+        const param_t invRadius = 1 / nicheRadius_;
+
+        fitness_t count = 0;
+
+        grid_.forEachNeighbour( point, [&]( const size_t j, const param_t distance2 )
+        {
+            if ( j == skip )
+            {
+                return;
+            }
+
+            const param_t ratio = std::sqrt( distance2 ) * invRadius;
+
+            count += static_cast< fitness_t >( 1 - ( sharingExponent_ == 1 ? ratio : std::pow( ratio, sharingExponent_ ) ) );
+        } );
+
+        return count;
+    }
+
+
+    // Minimized fitness as a positive goodness, the worst of the population and trials mapping to a small margin
+    fitness_t goodness( const fitness_t fitness ) const { return goodnessOffset_ - fitness; }
+
+
+    void setGoodnessOffset()
+    {
+        const size_t numParticles = this->getNumParticles();
+
+        fitness_t best  = std::numeric_limits< fitness_t >::infinity();
+        fitness_t worst = -std::numeric_limits< fitness_t >::infinity();
+
+        for ( size_t i = 0; i < numParticles; ++i )
+        {
+            best  = std::min( { best, this->population_.fitness( i ), trials_.fitness( i ) } );
+            worst = std::max( { worst, this->population_.fitness( i ), trials_.fitness( i ) } );
+        }
+
+        const fitness_t spread = worst - best;
+
+        goodnessOffset_ = worst + ( spread > 0 ? static_cast< fitness_t >( 1e-9 ) * spread : static_cast< fitness_t >( 1 ) );
+    }
+
+
+    // Better neighbours of every particle are listed in parallel, then swept in order of fitness on this thread
+    void clearNiches()
+    {
+        const size_t numParticles = this->getNumParticles();
+
+        std::iota( order_.begin(), order_.end(), size_t{ 0 } );
+        std::sort( order_.begin(), order_.end(), [this]( const size_t a, const size_t b )
+        {
+            return this->population_.fitness( a ) < this->population_.fitness( b ) ||
+                   ( this->population_.fitness( a ) == this->population_.fitness( b ) && a < b );
+        } );
+
+        for ( size_t r = 0; r < numParticles; ++r )
+        {
+            ranks_[order_[r]] = static_cast< uint32_t >( r );
+        }
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                uint32_t count = 0u;
+
+                grid_.forEachNeighbour( this->population_.position( i ), [&]( const size_t j, const param_t )
+                {
+                    count += ranks_[j] < ranks_[i] ? 1u : 0u;
+                } );
+
+                neighbourOffsets_[i + 1] = count;
+            }
+        } );
+
+        neighbourOffsets_[0] = 0u;
+        std::partial_sum( neighbourOffsets_.begin(), neighbourOffsets_.end(), neighbourOffsets_.begin() );
+
+        betterNeighbours_.resize( neighbourOffsets_[numParticles] );
+
+        this->forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, worker );
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                uint32_t* out = betterNeighbours_.data() + neighbourOffsets_[i];
+
+                grid_.forEachNeighbour( this->population_.position( i ), [&]( const size_t j, const param_t )
+                {
+                    if ( ranks_[j] < ranks_[i] )
+                    {
+                        *out++ = static_cast< uint32_t >( j );
+                    }
+                } );
+            }
+        } );
+
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::SELECT, this->profiler_.getMainSlot() );
+
+        numNiches_ = 0u;
+
+        for ( size_t r = 0; r < numParticles; ++r )
+        {
+            const size_t i = order_[r];
+
+            size_t survivors = 0u;
+
+            for ( uint32_t n = neighbourOffsets_[i]; n < neighbourOffsets_[i + 1]; ++n )
+            {
+                survivors += cleared_[betterNeighbours_[n]] ? 0u : 1u;
+            }
+
+            cleared_[i] = survivors >= nicheCapacity_ ? 1u : 0u;
+
+            numNiches_ += survivors == 0 ? 1u : 0u;
+        }
+    }
+
+
+    Niching niching_;
+    param_t mutation_;
+    param_t crossProb_;
+    param_t nicheRadius_;
+    param_t sharingExponent_;
+    size_t nicheCapacity_;
+
+    population_t trials_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > crossDraws_;
+
+    grid_t grid_;
+
+    std::vector< fitness_t > nicheCounts_;              // SHARING: of the population and of the trials
+    std::vector< fitness_t > trialCounts_;
+    fitness_t goodnessOffset_;
+
+    std::vector< uint32_t > ranks_;                     // CLEARING: by fitness, and the better neighbours of every particle
+    std::vector< size_t > order_;
+    std::vector< uint8_t > cleared_;
+    std::vector< uint32_t > neighbourOffsets_;
+    std::vector< uint32_t > betterNeighbours_;
+
+    std::vector< uint32_t > nearest_;                   // CROWDING: particle nearest to every trial
+
+    size_t numNiches_;
+
+
+    MultimodalEvolution() = delete;
+    MultimodalEvolution( const MultimodalEvolution& ) = delete;
+    MultimodalEvolution& operator=( const MultimodalEvolution& ) = delete;
+
+}; // class MultimodalEvolution
+
+} // namespace MetaOpt
+
+#endif // MULTIMODAL_EVOLUTION_H
@@ -0,0 +1,147 @@
+#ifndef OBSERVER_H
+#define OBSERVER_H
+
+#include "Termination.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+
+namespace MetaOpt
+{
+
+struct RunInfo
+{
+    const char* algorithm;
+    size_t numParticles;
+    size_t numParams;
+    std::string resumedFrom;    // Snapshot path when the run continues a checkpoint, empty otherwise
+};
+
+
+// Read-only view of the optimizer between iterations. The pointers are only valid during the callback.
+template< typename param_t, typename fitness_t >
+struct IterationView
+{
+    uint64_t iteration;             // Iterations completed so far
+    uint64_t evaluations;
+    size_t numParticles;
+    size_t numParams;
+
+    const param_t* bestPosition;
+    fitness_t bestFitness;
+
+    const param_t* positions;       // numParticles rows of numParams, contiguous
+    const fitness_t* fitnesses;
+};
+
+
+
+// Hook into a run. Callbacks come from the thread calling run(), between iterations, while the population is
+// not being modified. An optimizer without observers pays one branch per iteration.
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class Observer
+{
+public:
+
+    using param_t   = __PARAM_T;
+    using fitness_t = __FITNESS_T;
+    using view_t    = IterationView< param_t, fitness_t >;
+
+
+    virtual ~Observer() = default;
+
+
+    virtual void onRunBegin( const RunInfo& ) {}
+
+    // After the initial population is evaluated, or restored from a snapshot
+    virtual void onInitialized( const view_t& ) {}
+
+    virtual void onIteration( const view_t& ) {}
+
+    virtual void onRunEnd( const view_t&, const StopReason ) {}
+
+}; // class Observer
+
+
+
+// Progress report on a stream, what run() used to print. Lines are not flushed one by one.
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class ConsoleObserver : public Observer< __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base   = Observer< __PARAM_T, __FITNESS_T >;
+    using view_t = typename Base::view_t;
+
+
+    // Prints every interval-th iteration; 0 prints only the start and the result
+    explicit ConsoleObserver( std::ostream& out = std::cout, const uint64_t interval = 1u )
+        : out_{ out }
+        , interval_{ interval }
+    {
+    }
+
+
+    void onRunBegin( const RunInfo& info ) override
+    {
+        if ( !info.resumedFrom.empty() )
+        {
+            out_ << "Resuming from " << info.resumedFrom << "\n";
+        }
+    }
+
+
+    void onInitialized( const view_t& view ) override
+    {
+        out_ << "Initial best particle position: ";
+        printPosition( view );
+        out_ << "Initial best particle fitness: " << view.bestFitness << "\n";
+        out_ << "/////////////////////////" << "\n";
+    }
+
+
+    void onIteration( const view_t& view ) override
+    {
+        if ( interval_ > 0 && view.iteration % interval_ == 0 )
+        {
+            out_ << "iteration: " << view.iteration << ", best fitness: " << view.bestFitness << "\n";
+        }
+    }
+
+
+    void onRunEnd( const view_t& view, const StopReason reason ) override
+    {
+        out_ << "Best particle position: ";
+        printPosition( view );
+        out_ << "Best particle fitness: " << view.bestFitness << "\n";
+        out_ << "Stopped by: " << getStopReasonName( reason ) << " after " << view.iteration << " iterations and "
+             << view.evaluations << " evaluations" << std::endl;
+    }
+
+
+private:
+
+    void printPosition( const view_t& view )
+    {
+        out_ << "[";
+
+        for ( size_t i = 0; i < view.numParams; ++i )
+        {
+            out_ << view.bestPosition[i] << ( i + 1 < view.numParams ? ", " : "" );
+        }
+
+        out_ << "]\n";
+    }
+
+
+    std::ostream& out_;
+    uint64_t interval_;
+
+}; // class ConsoleObserver
+
+} // namespace MetaOpt
+
+#endif // OBSERVER_H
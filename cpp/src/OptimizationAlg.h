@@ -1,24 +1,39 @@
 #ifndef OPTIMIZATIONALG_H
 #define OPTIMIZATIONALG_H
 
+#include "Arena.h"
+#include "Checkpoint.h"
+#include "Extent.h"
+#include "FitnessCache.h"
+#include "Observer.h"
 #include "Particle.h"
+#include "Population.h"
 
 #include "Semaphore.h"
 
-#include "Timer.h"
+#include "Profiler.h"
 #include "ThreadPool.h"
 #include "Rng.h"
+#include "Termination.h"
 
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include <thread>
 #include <memory>
 #include <mutex>
 #include <condition_variable>
-
-#include <iostream>
+#include <utility>
 
 
 namespace MetaOpt
@@ -38,33 +53,75 @@ public:
     static_assert( __NUM_PARTICLES > 0, "Number of particles must be greater than 0" );
 
 
-    using particle_t = __PARTICLE_T< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
-    using param_t    = __PARAM_T;
-    using fitness_t  = __FITNESS_T;
+    using particle_t   = __PARTICLE_T< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = Population< __NUM_PARTICLES, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+
+
+    static constexpr size_t   DEFAULT_MAX_ITERATIONS = 50;
+    static constexpr uint64_t DEFAULT_SEED           = 0u;
+    static constexpr double   DEFAULT_RACING_Z       = 2.0;
+    static constexpr size_t   NUM_PARTICLES          = __NUM_PARTICLES;
+    static constexpr size_t   NUM_PARAMS             = particle_t::NUM_PARAMS;
+
+    // Blocks of [numParticles x numParams] reserved in the arena for the population and the algorithm's state
+    static constexpr size_t   ARENA_BLOCKS           = 16;
+
+
+    using fitness_func_t = std::function< fitness_t( const particle_t& ) >;
+
+    using observer_t = Observer< param_t, fitness_t >;
+    using view_t     = IterationView< param_t, fitness_t >;
 
+    // Evaluates positions.size() / getNumParams() candidates stored row-major and writes one fitness per row
+    using batch_fitness_func_t = std::function< void( std::span< const param_t > positions, std::span< fitness_t > fitnesses ) >;
 
-    static constexpr size_t DEFAULT_MAX_ITERATIONS = 50;
-    static constexpr size_t NUM_PARTICLES          = __NUM_PARTICLES;
-    static constexpr size_t NUM_PARAMS             = particle_t::NUM_PARAMS;
 
 
+    OptimizationAlg( const param_t* lowerBound, const param_t* upperBound, const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : OptimizationAlg( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
 
-    OptimizationAlg( const param_t lowerBound[NUM_PARAMS], const param_t upperBound[NUM_PARAMS], const int numThreads = 1 )
-        : upperBound_{}
-        , lowerBound_{}
-        , particles_{}
-        , bestParticle_{ std::make_shared< BestParticle< particle_t > >() }
+
+    // Sizes the problem at run time. A size given as a template argument must agree with the one passed here.
+    // With hugePages the population and algorithm state are backed by huge pages when the system allows it.
+    OptimizationAlg( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound, const int numThreads = 1, const bool hugePages = false )
+        : arena_{ arenaCapacity( checkExtent( numParticles, NUM_PARTICLES ), checkExtent( numParams, NUM_PARAMS ) ), hugePages }
+        , upperBound_{ numParams, arena_ }
+        , lowerBound_{ numParams, arena_ }
+        , population_{ numParticles, numParams, arena_ }
+        , bestParticle_{ std::make_shared< BestParticle< particle_t > >( numParams ) }
         , threadingEnabled_{ numThreads > 1 }
         , threadPool_{ numThreads }
-        , rng_{ Rng<>::getInstance() }
-        , timer_{ Timer::getInstance() }
+        , grainSize_{ 0u }
+        , schedule_{ ThreadPool::Schedule::DYNAMIC }
+        , rngs_( numParticles )
+        , seed_{ DEFAULT_SEED }
+        , profiler_{ static_cast< size_t >( std::max( numThreads, 1 ) ) }
         , fitnessFunc_{ nullptr }
+        , batchFitnessFunc_{ nullptr }
+        , fitnessCache_{ nullptr }
+        , minSamples_{ 1u }
+        , maxSamples_{ 1u }
+        , racingZ_{ DEFAULT_RACING_Z }
+        , termination_{}
+        , stopReason_{ StopReason::NONE }
         , iteration_{ 0 }
+        , evaluationScratch_( std::max( numThreads, 1 ) )
+        , observers_{}
+        , checkpointPath_{}
+        , checkpointInterval_{ 0u }
+        , checkpointWriter_{ nullptr }
+        , snapshotWriter_{}
+        , resumeSnapshot_{ nullptr }
         , maxIterations_{ DEFAULT_MAX_ITERATIONS }
         , particleInsertIdx_{ 0u }
     {
-        std::memcpy( upperBound_, upperBound, NUM_PARAMS * sizeof( param_t ) );
-        std::memcpy( lowerBound_, lowerBound, NUM_PARAMS * sizeof( param_t ) );
+        std::memcpy( upperBound_.data(), upperBound, numParams * sizeof( param_t ) );
+        std::memcpy( lowerBound_.data(), lowerBound, numParams * sizeof( param_t ) );
     }
 
 
@@ -73,47 +130,74 @@ public:
 
     void insertParticle( const particle_t& particle )
     {
-        particles_[particleInsertIdx_++] = particle;
+        population_.loadParticle( particleInsertIdx_++, particle );
     }
 
 
     void run()
     {
+        if ( !fitnessFunc_ && !batchFitnessFunc_ )
+        {
+            throw std::runtime_error( "OptimizationAlg::run: no fitness function set" );
+        }
+
+        profiler_.beginRun();
+
+        termination_.start();
+        stopReason_ = StopReason::NONE;
+
+        for ( EvaluationScratch& scratch : evaluationScratch_ )
+        {
+            scratch.evaluations.store( 0u, std::memory_order_relaxed );
+        }
+
         if ( threadingEnabled_ )
         {
             threadPool_.startThreads();
 
         }
 
-        initializeParticles();
+        if ( fitnessCache_ )
+        {
+            fitnessCache_->resetStats();
+        }
 
+        if ( !observers_.empty() )
+        {
+            const RunInfo info{ getSnapshotTag(), getNumParticles(), getNumParams(), resumeSnapshot_ ? resumeSnapshot_->getPath() : std::string{} };
 
-        postInitialize();
+            for ( const auto& observer : observers_ )
+            {
+                observer->onRunBegin( info );
+            }
+        }
 
+        if ( resumeSnapshot_ )
+        {
+            restoreSnapshot();
+        }
+        else
+        {
+            iteration_ = 0;
 
-        evaluateParticles();
-        updateBestParticle();
+            initializeParticles();
 
 
-        std::cout << "Initial best particle position: [";
+            postInitialize();
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
-        {
-            std::cout << bestParticle_->position_[i] << ( i < NUM_PARAMS - 1 ? ", " : "" );
-        }
 
-        std::cout << "]" << std::endl;
+            evaluateParticles();
+            updateBestParticle();
+        }
 
-        std::cout << "Initial best particle fitness: " << bestParticle_->fitness_ << std::endl;
+        notifyObservers( &observer_t::onInitialized );
 
-        std::cout << "/////////////////////////" << std::endl;
 
+        optimize();
 
-        for ( iteration_ = 0; iteration_ < maxIterations_ & !isConverged(); ++iteration_ )
+        if ( stopReason_ == StopReason::NONE )
         {
-            std::cout << "iteration: " << iteration_ << std::endl;
-
-            iterate();
+            stopReason_ = StopReason::MAX_ITERATIONS;
         }
 
 
@@ -122,148 +206,916 @@ public:
             threadPool_.stopThreads();
         }
 
+        if ( !observers_.empty() )
+        {
+            const view_t view = makeView();
 
-        std::cout << "Best particle position: [";
+            for ( const auto& observer : observers_ )
+            {
+                observer->onRunEnd( view, stopReason_ );
+            }
+        }
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        if ( checkpointWriter_ )
         {
-            std::cout << bestParticle_->position_[i] << ( i < NUM_PARAMS - 1 ? ", " : "" );
+            checkpointWriter_->flush();
         }
 
-        std::cout << "]" << std::endl;
+        if ( fitnessCache_ )
+        {
+            profiler_.setFitnessCacheStats( fitnessCache_->getHits(), fitnessCache_->getMisses() );
+        }
 
-        std::cout << "Best particle fitness: " << bestParticle_->fitness_ << std::endl;
+        profiler_.endRun();
 
         particleInsertIdx_ = 0u;
     }
 
 
+    // Every particle draws from its own stream of this seed, so a run is reproducible for any thread count
+    void setSeed( const uint64_t seed )
+    {
+        seed_ = seed;
+    }
+
+
     void setMaxIterations( const uint64_t maxIterations )
     {
         maxIterations_ = maxIterations;
     }
 
 
-    void setFitnessFunc( std::function< fitness_t( const particle_t& ) > fitnessFunc )
+    // Every interval iterations the complete state is snapshotted and written to path in the background,
+    // replacing the previous snapshot atomically. 0 disables checkpoints.
+    void setCheckpointing( const std::string& path, const uint64_t interval )
+    {
+        checkpointPath_     = path;
+        checkpointInterval_ = interval;
+
+        if ( interval > 0 && !checkpointWriter_ )
+        {
+            checkpointWriter_ = std::make_unique< CheckpointWriter >();
+        }
+    }
+
+
+    // Writes the current state to path at once, e.g. after a run
+    void saveCheckpoint( const std::string& path )
+    {
+        serializeSnapshot( iteration_ );
+
+        CheckpointWriter::writeFile( path, snapshotWriter_.getBuffer() );
+    }
+
+
+    // The next run continues from the snapshot at path instead of a fresh population, and produces the same
+    // results as the run that wrote it would have. The file is mapped and validated now, and read by run().
+    // Continuation is exact for the generational loop; a fitness cache with epsilon > 0 must start out the same.
+    void resumeFrom( const std::string& path )
+    {
+        auto snapshot = std::make_unique< MappedSnapshot >( path );
+
+        const SnapshotHeader& header = snapshot->getHeader();
+
+        if ( std::strncmp( header.algorithm, getSnapshotTag(), SnapshotHeader::TAG_SIZE ) != 0 || header.numParticles != getNumParticles() ||
+             header.numParams != getNumParams() || header.paramSize != sizeof( param_t ) || header.fitnessSize != sizeof( fitness_t ) )
+        {
+            throw std::runtime_error( "OptimizationAlg::resumeFrom: " + path + " was written by a different optimizer or problem size" );
+        }
+
+        resumeSnapshot_ = std::move( snapshot );
+    }
+
+
+    // Observers are called in the order they were added. Without any, a run prints nothing.
+    void addObserver( std::shared_ptr< observer_t > observer )
+    {
+        observers_.push_back( std::move( observer ) );
+    }
+
+
+    void clearObservers()
+    {
+        observers_.clear();
+    }
+
+
+    // Stopping criteria checked after every iteration in addition to the iteration limit
+    Termination< param_t, fitness_t >& getTermination() { return termination_; }
+    const Termination< param_t, fitness_t >& getTermination() const { return termination_; }
+
+    // Criterion that ended the last run
+    StopReason getStopReason() const { return stopReason_; }
+
+    // Iterations completed by the last run
+    uint64_t getIterationCount() const { return iteration_; }
+
+    // Calls of the fitness function in the current or last run; cache hits are not counted
+    uint64_t getEvaluationCount() const
+    {
+        uint64_t evaluations = 0u;
+
+        for ( const EvaluationScratch& scratch : evaluationScratch_ )
+        {
+            evaluations += scratch.evaluations.load( std::memory_order_relaxed );
+        }
+
+        return evaluations;
+    }
+
+
+    void setFitnessFunc( fitness_func_t fitnessFunc )
     {
         fitnessFunc_ = fitnessFunc;
     }
 
 
+    // Particles per work chunk (0 picks one from the population size) and how chunks are spread over the threads
+    void setChunking( const size_t grainSize, const ThreadPool::Schedule schedule = ThreadPool::Schedule::DYNAMIC )
+    {
+        grainSize_ = grainSize;
+        schedule_  = schedule;
+    }
+
+
+    // Takes precedence over the per-particle fitness function. Called once per work chunk and generation.
+    void setBatchFitnessFunc( batch_fitness_func_t batchFitnessFunc )
+    {
+        batchFitnessFunc_ = batchFitnessFunc;
+    }
+
+
+    // Memoizes fitness values on positions snapped to a grid of spacing epsilon (0 matches exact positions only).
+    // The cache persists across runs; disable it for objectives that are not deterministic.
+    void enableFitnessCache( const size_t capacity, const param_t epsilon = static_cast< param_t >( 0 ), const size_t numShards = FitnessCache< param_t, fitness_t >::DEFAULT_NUM_SHARDS )
+    {
+        fitnessCache_ = std::make_unique< FitnessCache< param_t, fitness_t > >( getNumParams(), capacity, epsilon, numShards );
+    }
+
+
+    void disableFitnessCache()
+    {
+        fitnessCache_.reset();
+    }
+
+
+    // Resampling for noisy objectives. Every candidate is evaluated minSamples times and its fitness is the mean.
+    // It is then raced against the fitness it is selected against (getRacingThreshold()): until its mean is
+    // racingZ standard errors worse than that, its samples are doubled, up to maxSamples. Most candidates are
+    // rejected after a few samples and the survivors are sampled fully. minSamples should be 4 or more for the
+    // variance to be meaningful. Replicates of a work chunk are evaluated as one batch and count as evaluations;
+    // they bypass the fitness cache. Single evaluations outside a population, as in local searches, average
+    // minSamples replicates. Algorithms whose selection is not pairwise by index must override getRacingThreshold().
+    void setResampling( const uint32_t minSamples, const uint32_t maxSamples, const double racingZ = DEFAULT_RACING_Z )
+    {
+        if ( minSamples == 0 || maxSamples < minSamples )
+        {
+            throw std::invalid_argument( "OptimizationAlg::setResampling: need 0 < minSamples <= maxSamples" );
+        }
+
+        minSamples_ = minSamples;
+        maxSamples_ = maxSamples;
+        racingZ_    = racingZ;
+    }
+
+
+    void disableResampling()
+    {
+        minSamples_ = 1u;
+        maxSamples_ = 1u;
+    }
+
+
+    bool isResampling() const { return maxSamples_ > 1; }
+
+
     bool isThreadingEnabled() const { return threadingEnabled_; }
 
+    size_t getNumParticles() const { return population_.getNumParticles(); }
 
-    std::function< fitness_t( const particle_t& ) > getFitnessFunc() const { return fitnessFunc_; }
+    size_t getNumParams() const { return population_.getNumParams(); }
+
+
+    fitness_func_t getFitnessFunc() const { return fitnessFunc_; }
+
+    batch_fitness_func_t getBatchFitnessFunc() const { return batchFitnessFunc_; }
 
     particle_t getBestParticle() const { return *bestParticle_; }
 
+    particle_t getParticle( const size_t idx ) const
+    {
+        particle_t particle = makeParticle();
+        population_.storeParticle( idx, particle );
+        return particle;
+    }
 
-protected:
+    const population_t& getPopulation() const { return population_; }
 
-    virtual void postInitialize() {}
 
+    // Copies the count best particles, best first, to rows of positions and to fitnesses. Call between
+    // iterations only, i.e. outside run() or from an observer.
+    void getElites( const size_t count, param_t* positions, fitness_t* fitnesses ) const
+    {
+        const size_t numParams = getNumParams();
+        const size_t n         = std::min( count, getNumParticles() );
 
-    virtual void updateParticle( particle_t& ) = 0;
+        std::vector< size_t > order( getNumParticles() );
 
+        for ( size_t i = 0; i < order.size(); ++i )
+        {
+            order[i] = i;
+        }
 
-    virtual void updateParticles()
+        std::partial_sort( order.begin(), order.begin() + n, order.end(), [this]( const size_t a, const size_t b )
+        {
+            return population_.fitness( a ) < population_.fitness( b );
+        } );
+
+        for ( size_t m = 0; m < n; ++m )
+        {
+            std::memcpy( positions + m * numParams, population_.position( order[m] ), numParams * sizeof( param_t ) );
+            fitnesses[m] = population_.fitness( order[m] );
+        }
+    }
+
+
+    // Each migrant replaces the worst particle if it is better than it. Returns how many were taken in.
+    // Call between iterations only.
+    size_t immigrate( const param_t* positions, const fitness_t* fitnesses, const size_t count )
     {
-        timer_->startUpdateParticleLoop();
+        const size_t numParams = getNumParams();
 
-        if ( threadingEnabled_ )
+        size_t accepted = 0;
+
+        for ( size_t m = 0; m < count; ++m )
         {
-            std::array< std::future< void >, NUM_PARTICLES > futures;
+            const fitness_t* column = population_.fitnesses();
+            const size_t worst      = static_cast< size_t >( std::max_element( column, column + getNumParticles() ) - column );
 
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
+            if ( !( fitnesses[m] < population_.fitness( worst ) ) )
             {
-                futures[i] = threadPool_.enqueue( [this, i]()
-                {
-                    updateParticle( particles_[i] );
-                } );
+                continue;
             }
 
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
-            {
-                futures[i].get();
-            }
+            std::memcpy( population_.position( worst ), positions + m * numParams, numParams * sizeof( param_t ) );
+            population_.fitness( worst ) = fitnesses[m];
+            population_.resetSamples( worst );
+
+            onParticleReplaced( worst );
 
+            bestParticle_->trialPosition( positions + m * numParams, fitnesses[m] );
 
+            ++accepted;
         }
-        else
+
+        return accepted;
+    }
+
+    // Breakdown of the last run
+    Profiler& getProfiler() { return profiler_; }
+    const Profiler& getProfiler() const { return profiler_; }
+
+
+protected:
+
+    virtual void postInitialize() {}
+
+
+    // Main loop, run between the initial evaluation and the final report
+    virtual void optimize()
+    {
+        for ( ; iteration_ < maxIterations_ && !isConverged(); ++iteration_ )
         {
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
+            profiler_.beginIteration( iteration_ );
+
+            iterate();
+
+            profiler_.endIteration();
+
+            notifyObservers( &observer_t::onIteration, 1u );
+
+            if ( checkpointInterval_ > 0 && ( iteration_ + 1 ) % checkpointInterval_ == 0 )
             {
-                updateParticle( particles_[i] );
+                writeCheckpoint( iteration_ + 1 );
             }
         }
+    }
+
+
+    // Particle idx was overwritten from outside, e.g. by a migrant; algorithms keeping per-particle state
+    // beyond position and fitness reset it here
+    virtual void onParticleReplaced( const size_t ) {}
+
+
+    // Name stored in snapshots, so a snapshot is only resumed by the algorithm that wrote it
+    virtual const char* getSnapshotTag() const { return "OptimizationAlg"; }
 
-        timer_->stopUpdateParticleLoop();
+
+    // State of the derived algorithm that a snapshot must carry beyond the population, best particle and
+    // random streams; loadState reads it back in the same order
+    virtual void saveState( SnapshotWriter& ) const {}
+    virtual void loadState( SnapshotReader& ) {}
+
+
+    uint64_t getMaxIterations() const { return maxIterations_; }
+
+
+    // Generates the candidates of particles [begin, end), to be evaluated afterwards. Particle i draws from rngs_[i].
+    virtual void updateBlock( const size_t begin, const size_t end ) = 0;
+
+
+    // Population whose fitness is evaluated after updateBlock
+    virtual population_t& getCandidates() { return population_; }
+
+
+    // Called for [begin, end) once all candidates of the generation are evaluated
+    virtual void selectBlock( const size_t, const size_t ) {}
+
+
+    virtual void updateParticles()
+    {
+        forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            {
+                Profiler::Scope scope( profiler_, Profiler::Phase::UPDATE, worker );
+
+                updateBlock( begin, end );
+            }
+
+            evaluateRange( getCandidates(), begin, end, worker );
+        } );
+
+        forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            Profiler::Scope scope( profiler_, Profiler::Phase::SELECT, worker );
+
+            selectBlock( begin, end );
+        } );
     }
 
 
     virtual void evaluateParticles()
     {
-        timer_->startEvaluateParticleLoop();
+        forEachChunk( [this]( const size_t begin, const size_t end, const size_t worker )
+        {
+            evaluateRange( population_, begin, end, worker );
+        } );
+    }
+
+
+    // Runs func( begin, end, worker ) over chunks of the population on the thread pool
+    template< typename Func >
+    void forEachChunk( Func&& func )
+    {
+        forEachChunk( getNumParticles(), std::forward< Func >( func ) );
+    }
 
+
+    // Same over [0, count), for algorithms whose candidates outnumber or fall short of the population
+    template< typename Func >
+    void forEachChunk( const size_t count, Func&& func )
+    {
         if ( threadingEnabled_ )
         {
-            std::array< std::future< void >, NUM_PARTICLES > futures;
+            profiler_.beginLoop();
+
+            threadPool_.parallelFor( 0, count, grainSize_, func, schedule_ );
+
+            profiler_.endLoop();
+        }
+        else
+        {
+            func( 0, count, 0 );
+        }
+    }
+
+
+    void evaluateRange( population_t& population, const size_t begin, const size_t end, const size_t worker )
+    {
+        Profiler::Scope scope( profiler_, Profiler::Phase::EVALUATE, worker );
+
+        if ( isResampling() )
+        {
+            raceRange( population, begin, end, worker );
+            return;
+        }
+
+        if ( !fitnessCache_ )
+        {
+            // Rows are contiguous, so the chunk is handed over without copying
+            evaluateRows( population.position( begin ), end - begin, population.fitnesses() + begin, worker );
+            return;
+        }
+
+        // Only the cache misses are evaluated, gathered into this worker's scratch rows
+        EvaluationScratch& scratch = evaluationScratch_[worker];
+
+        scratch.indices.clear();
 
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( !fitnessCache_->lookup( population.position( i ), population.fitness( i ) ) )
             {
-                futures[i] = threadPool_.enqueue( [this, i]()
-                {
-                    particles_[i].fitness_ = fitnessFunc_( particles_[i] );
-                } );
+                scratch.indices.push_back( i );
             }
+        }
+
+        const size_t numMisses = scratch.indices.size();
+
+        if ( numMisses == 0 )
+        {
+            return;
+        }
+
+        const size_t numParams = getNumParams();
+
+        scratch.positions.resize( numMisses * numParams );
+        scratch.fitnesses.resize( numMisses );
+
+        for ( size_t m = 0; m < numMisses; ++m )
+        {
+            std::memcpy( scratch.positions.data() + m * numParams, population.position( scratch.indices[m] ), numParams * sizeof( param_t ) );
+        }
+
+        evaluateRows( scratch.positions.data(), numMisses, scratch.fitnesses.data(), worker );
 
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
+        for ( size_t m = 0; m < numMisses; ++m )
+        {
+            population.fitness( scratch.indices[m] ) = scratch.fitnesses[m];
+
+            fitnessCache_->insert( scratch.positions.data() + m * numParams, scratch.fitnesses[m] );
+        }
+    }
+
+
+    // Fitness of a single position, through the cache when enabled
+    fitness_t evaluatePosition( const param_t* position, const size_t worker )
+    {
+        fitness_t fitness;
+
+        if ( isResampling() )
+        {
+            EvaluationScratch& scratch = evaluationScratch_[worker];
+
+            replicateRows( scratch, &position, 1u, &minSamples_, worker );
+
+            fitness = fitness_t{};
+
+            for ( uint32_t r = 0; r < minSamples_; ++r )
             {
-                futures[i].get();
+                fitness += scratch.fitnesses[r];
             }
+
+            return fitness / static_cast< fitness_t >( minSamples_ );
+        }
+
+        if ( fitnessCache_ && fitnessCache_->lookup( position, fitness ) )
+        {
+            return fitness;
+        }
+
+        evaluateRows( position, 1u, &fitness, worker );
+
+        if ( fitnessCache_ )
+        {
+            fitnessCache_->insert( position, fitness );
+        }
+
+        return fitness;
+    }
+
+
+    // Evaluates count contiguous rows with whichever fitness function is set. A batch is timed as a whole,
+    // single evaluations are timed at the profiler's sampling interval.
+    void evaluateRows( const param_t* positions, const size_t count, fitness_t* fitnesses, const size_t worker )
+    {
+        const size_t numParams = getNumParams();
+
+        // Single writer per worker, read by whoever checks the evaluation budget
+        std::atomic< uint64_t >& evaluations = evaluationScratch_[worker].evaluations;
+        evaluations.store( evaluations.load( std::memory_order_relaxed ) + count, std::memory_order_relaxed );
+
+        if ( batchFitnessFunc_ )
+        {
+            const uint64_t start = Profiler::now();
+
+            batchFitnessFunc_( std::span< const param_t >( positions, count * numParams ), std::span< fitness_t >( fitnesses, count ) );
+
+            profiler_.recordBatch( worker, Profiler::now() - start, count );
         }
         else
         {
-            for ( size_t i = 0; i < NUM_PARTICLES; ++i )
+            particle_t particle = makeParticle();
+
+            for ( size_t r = 0; r < count; ++r )
             {
-                particles_[i].fitness_ = fitnessFunc_( particles_[i] );
+                std::memcpy( particle.position_.data(), positions + r * numParams, numParams * sizeof( param_t ) );
+
+                if ( profiler_.sampleEvaluation( worker ) )
+                {
+                    const uint64_t start = Profiler::now();
+
+                    fitnesses[r] = fitnessFunc_( particle );
+
+                    profiler_.recordLatency( worker, Profiler::now() - start );
+                }
+                else
+                {
+                    fitnesses[r] = fitnessFunc_( particle );
+                }
             }
         }
+    }
+
+
+    // Fitness that candidate idx must beat to be selected, and the squared standard error of that value, used to
+    // race candidates under resampling. By default a candidate competes with the particle of the same index, the
+    // one it replaces in pairwise selection, and a population evaluated in place competes with the best particle.
+    // Called concurrently from the workers; algorithms that select otherwise override it.
+    virtual fitness_t getRacingThreshold( const population_t& candidates, const size_t idx, fitness_t& standardError2 ) const
+    {
+        if ( &candidates == &population_ )
+        {
+            standardError2 = fitness_t{};
+            return bestParticle_->fitness_;
+        }
+
+        const uint32_t samples = population_.sampleCount( idx );
+
+        standardError2 = samples > 1 ? population_.variance( idx ) / static_cast< fitness_t >( samples ) : fitness_t{};
+
+        return population_.fitness( idx );
+    }
+
+
+    // Checked before every iteration; sets stopReason_ when a termination criterion is met. Overrides adding
+    // their own test should set stopReason_ to StopReason::CONVERGED when it fires.
+    virtual bool isConverged()
+    {
+        stopReason_ = termination_.check( iteration_, getEvaluationCount(), bestParticle_->fitness_, population_ );
 
-        timer_->stopEvaluateParticleLoop();
+        return stopReason_ != StopReason::NONE;
     }
 
 
-    virtual bool isConverged() { return false; };
+    // Particle sized for this problem
+    particle_t makeParticle() const { return particle_t( getNumParams() ); }
 
 
-    param_t upperBound_[NUM_PARAMS];
-    param_t lowerBound_[NUM_PARAMS];
+    // Backs every run-time sized array of the algorithm, so it is declared, and destroyed, first
+    Arena arena_;
 
-    particle_t particles_[NUM_PARTICLES];
+    AlignedArray< param_t, NUM_PARAMS > upperBound_;
+    AlignedArray< param_t, NUM_PARAMS > lowerBound_;
+
+    population_t population_;
 
     std::shared_ptr< BestParticle< particle_t > > bestParticle_;
 
     bool threadingEnabled_;
     ThreadPool threadPool_;
 
-    Rng<>* rng_;
-    Timer* timer_;
+    size_t grainSize_;
+    ThreadPool::Schedule schedule_;
+
+    std::vector< Rng<> > rngs_;
+    uint64_t seed_;
+
+    Profiler profiler_;
 
-    std::function< fitness_t( const particle_t& ) > fitnessFunc_;
+    fitness_func_t fitnessFunc_;
+    batch_fitness_func_t batchFitnessFunc_;
+
+    std::unique_ptr< FitnessCache< param_t, fitness_t > > fitnessCache_;
+
+    uint32_t minSamples_;
+    uint32_t maxSamples_;
+    double racingZ_;
+
+    Termination< param_t, fitness_t > termination_;
+    StopReason stopReason_;
+
+    uint64_t iteration_;
 
 private:
 
+    // Per worker, aligned so the evaluation counters do not share cache lines
+    struct alignas( CACHE_LINE_SIZE ) EvaluationScratch
+    {
+        std::vector< size_t > indices;
+        std::vector< param_t > positions;
+        std::vector< fitness_t > fitnesses;
+
+        std::vector< const param_t* > rows;         // Resampling
+        std::vector< uint32_t > replicates;
+
+        std::atomic< uint64_t > evaluations{ 0u };
+    };
+
+    std::vector< EvaluationScratch > evaluationScratch_;
+
+
+    // Evaluates replicates[k] copies of rows[k] for every k, as one batch, into scratch.fitnesses
+    void replicateRows( EvaluationScratch& scratch, const param_t* const* rows, const size_t count, const uint32_t* replicates, const size_t worker )
+    {
+        const size_t numParams = getNumParams();
+
+        size_t total = 0u;
+
+        for ( size_t k = 0; k < count; ++k )
+        {
+            total += replicates[k];
+        }
+
+        scratch.positions.resize( total * numParams );
+        scratch.fitnesses.resize( total );
+
+        param_t* out = scratch.positions.data();
+
+        for ( size_t k = 0; k < count; ++k )
+        {
+            for ( uint32_t r = 0; r < replicates[k]; ++r, out += numParams )
+            {
+                std::memcpy( out, rows[k], numParams * sizeof( param_t ) );
+            }
+        }
+
+        evaluateRows( scratch.positions.data(), total, scratch.fitnesses.data(), worker );
+    }
+
+
+    // minSamples replicates of every candidate in [begin, end), then rounds in which every candidate still in the
+    // race doubles its samples. Each round is one batch.
+    void raceRange( population_t& population, const size_t begin, const size_t end, const size_t worker )
+    {
+        EvaluationScratch& scratch = evaluationScratch_[worker];
+
+        scratch.indices.resize( end - begin );
+        scratch.rows.resize( end - begin );
+        scratch.replicates.resize( end - begin );
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            population.resetSamples( i );
+            population.fitness( i ) = fitness_t{};
+
+            scratch.indices[i - begin]    = i;
+            scratch.replicates[i - begin] = minSamples_;
+        }
+
+        size_t numRacing = end - begin;
+
+        while ( numRacing > 0 )
+        {
+            for ( size_t k = 0; k < numRacing; ++k )
+            {
+                scratch.rows[k] = population.position( scratch.indices[k] );
+            }
+
+            replicateRows( scratch, scratch.rows.data(), numRacing, scratch.replicates.data(), worker );
+
+            // Merge every candidate's replicates and keep those still racing, in order, at the front
+            const fitness_t* samples = scratch.fitnesses.data();
+
+            size_t next = 0u;
+
+            for ( size_t k = 0; k < numRacing; ++k )
+            {
+                const size_t i           = scratch.indices[k];
+                const uint32_t count     = scratch.replicates[k];
+                const fitness_t* sampled = samples;
+
+                samples += count;
+
+                // Shifted by the first sample, so that identical samples give exactly no variance
+                fitness_t shift = fitness_t{};
+
+                for ( uint32_t r = 0; r < count; ++r )
+                {
+                    shift += sampled[r] - sampled[0];
+                }
+
+                const fitness_t mean = sampled[0] + shift / static_cast< fitness_t >( count );
+
+                fitness_t squares = fitness_t{};
+
+                for ( uint32_t r = 0; r < count; ++r )
+                {
+                    squares += ( sampled[r] - mean ) * ( sampled[r] - mean );
+                }
+
+                population.mergeSamples( i, count, mean, squares );
+
+                const uint32_t samplesSoFar = population.sampleCount( i );
+
+                if ( samplesSoFar >= maxSamples_ || !isContender( population, i ) )
+                {
+                    continue;
+                }
+
+                scratch.indices[next]    = i;
+                scratch.replicates[next] = std::min( samplesSoFar, maxSamples_ - samplesSoFar );
+                ++next;
+            }
+
+            numRacing = next;
+        }
+    }
+
+
+    // Whether the candidate's mean is not yet racingZ standard errors worse than its threshold. The race is one
+    // sided: clear losers stop early, while candidates that may be selected are sampled up to maxSamples, so the
+    // particles that survive carry accurate estimates. A single sample gives no error estimate.
+    bool isContender( const population_t& population, const size_t idx ) const
+    {
+        const uint32_t samples = population.sampleCount( idx );
+
+        if ( samples < 2 )
+        {
+            return true;
+        }
+
+        const fitness_t ownError2 = population.variance( idx ) / static_cast< fitness_t >( samples );
+
+        fitness_t thresholdError2;
+        const fitness_t threshold = getRacingThreshold( population, idx, thresholdError2 );
+
+        // Nothing to beat, as for the initial population: sampled fully unless its samples all agree
+        if ( !( threshold < std::numeric_limits< fitness_t >::max() ) )
+        {
+            return ownError2 > 0;
+        }
+
+        const fitness_t error2 = ownError2 + thresholdError2;
+        const fitness_t gap    = population.fitness( idx ) - threshold;
+
+        // Samples that all agree decide the race either way
+        if ( !( error2 > 0 ) )
+        {
+            return false;
+        }
+
+        return gap < static_cast< fitness_t >( racingZ_ ) * std::sqrt( error2 );
+    }
+
+    std::vector< std::shared_ptr< observer_t > > observers_;
+
+    std::string checkpointPath_;
+    uint64_t checkpointInterval_;
+    std::unique_ptr< CheckpointWriter > checkpointWriter_;
+    SnapshotWriter snapshotWriter_;
+    std::unique_ptr< MappedSnapshot > resumeSnapshot_;
+
+
+    // View of the state; completedOffset counts an iteration that is done but not yet added to iteration_
+    view_t makeView( const uint64_t completedOffset = 0u ) const
+    {
+        return view_t{ iteration_ + completedOffset, getEvaluationCount(), getNumParticles(), getNumParams(),
+                       bestParticle_->position_.data(), bestParticle_->fitness_, population_.position( 0 ), population_.fitnesses() };
+    }
+
+
+    void notifyObservers( void ( observer_t::*callback )( const view_t& ), const uint64_t completedOffset = 0u )
+    {
+        if ( observers_.empty() )
+        {
+            return;
+        }
+
+        const view_t view = makeView( completedOffset );
+
+        for ( const auto& observer : observers_ )
+        {
+            ( ( *observer ).*callback )( view );
+        }
+    }
+
+
+    // Serializes the state after completedIterations iterations; the loop stalls only for the copy
+    void writeCheckpoint( const uint64_t completedIterations )
+    {
+        serializeSnapshot( completedIterations );
+
+        checkpointWriter_->submit( checkpointPath_, snapshotWriter_.getBuffer() );
+    }
+
+
+    void serializeSnapshot( const uint64_t completedIterations )
+    {
+        const size_t numParticles = getNumParticles();
+        const size_t numParams    = getNumParams();
+
+        SnapshotWriter& writer = snapshotWriter_;
+
+        writer.begin( getSnapshotTag(), numParticles, numParams, sizeof( param_t ), sizeof( fitness_t ) );
+
+        const typename Termination< param_t, fitness_t >::Progress progress = termination_.getProgress();
+
+        writer.write( seed_ );
+        writer.write( completedIterations );
+        writer.write( getEvaluationCount() );
+        writer.write( progress.stallBest );
+        writer.write( progress.lastImprovement );
+        writer.write( progress.elapsedNanos );
+
+        writer.writeArray( population_.position( 0 ), numParticles * numParams );
+        writer.writeArray( population_.fitnesses(), numParticles );
+        writer.writeArray( population_.sampleCounts(), numParticles );
+        writer.writeArray( population_.sumsOfSquares(), numParticles );
+
+        writer.writeArray( bestParticle_->position_.data(), numParams );
+        writer.write( bestParticle_->fitness_ );
+
+        for ( const Rng<>& rng : rngs_ )
+        {
+            writer.write( rng.getGenerator().getState() );
+        }
+
+        saveState( writer );
+
+        writer.finish();
+    }
+
+
+    void restoreSnapshot()
+    {
+        const size_t numParticles = getNumParticles();
+        const size_t numParams    = getNumParams();
+
+        SnapshotReader reader = resumeSnapshot_->getReader();
+
+        typename Termination< param_t, fitness_t >::Progress progress;
+
+        seed_                    = reader.read< uint64_t >();
+        iteration_               = reader.read< uint64_t >();
+        const uint64_t evaluated = reader.read< uint64_t >();
+        progress.stallBest       = reader.read< fitness_t >();
+        progress.lastImprovement = reader.read< uint64_t >();
+        progress.elapsedNanos    = reader.read< int64_t >();
+
+        reader.readArray( population_.position( 0 ), numParticles * numParams );
+        reader.readArray( population_.fitnesses(), numParticles );
+        reader.readArray( population_.sampleCounts(), numParticles );
+        reader.readArray( population_.sumsOfSquares(), numParticles );
+
+        reader.readArray( bestParticle_->position_.data(), numParams );
+        bestParticle_->fitness_ = reader.read< fitness_t >();
+
+        for ( Rng<>& rng : rngs_ )
+        {
+            rng.getGenerator().setState( reader.read< typename Rng<>::generator_t::State >() );
+        }
+
+        loadState( reader );
+
+        evaluationScratch_[0].evaluations.store( evaluated, std::memory_order_relaxed );
+        termination_.resume( progress );
+
+        resumeSnapshot_.reset();
+    }
+
+
+    static size_t checkExtent( const size_t size, const size_t extent )
+    {
+        if ( size == 0 || ( extent != DYNAMIC_EXTENT && size != extent ) )
+        {
+            throw std::invalid_argument( "OptimizationAlg::OptimizationAlg: sizes must be positive and match the template arguments" );
+        }
+
+        return size;
+    }
+
+
+    // Fixed-size algorithms keep their arrays inline and need no arena
+    static size_t arenaCapacity( const size_t numParticles, const size_t numParams )
+    {
+        if constexpr ( !population_t::IS_DYNAMIC )
+        {
+            return 0u;
+        }
+
+        return ARENA_BLOCKS * ( numParticles * numParams * sizeof( param_t ) + numParticles * ( sizeof( fitness_t ) + CACHE_LINE_SIZE ) ) + Arena::HUGE_PAGE_SIZE;
+    }
+
+
     void initializeParticles()
     {
-        timer_->startInitializeParticleLoop();
+        Profiler::Scope scope( profiler_, Profiler::Phase::INITIALIZE, profiler_.getMainSlot() );
 
-        for ( size_t i = particleInsertIdx_; i < NUM_PARTICLES; ++i )
+        for ( size_t i = 0; i < getNumParticles(); ++i )
         {
-            particles_[i].initialize( lowerBound_, upperBound_ );
+            rngs_[i].seed( seed_, i );
         }
 
-        timer_->stopInitializeParticleLoop();
+        for ( size_t i = particleInsertIdx_; i < getNumParticles(); ++i )
+        {
+            param_t* position = population_.position( i );
+
+            for ( size_t j = 0; j < getNumParams(); ++j )
+            {
+                position[j] = rngs_[i].drawUniform( lowerBound_[j], upperBound_[j] );
+            }
+        }
     }
 
 
@@ -276,11 +1128,14 @@ private:
 
     void updateBestParticle()
     {
-        this->bestParticle_->trialParticle( particles_ );
+        Profiler::Scope scope( profiler_, Profiler::Phase::BEST_REDUCTION, profiler_.getMainSlot() );
+
+        const size_t best = population_.argBest();
+
+        this->bestParticle_->trialPosition( population_.position( best ), population_.fitness( best ) );
     }
 
 
-    uint64_t iteration_;
     uint64_t maxIterations_;
 
     uint32_t particleInsertIdx_;
@@ -1,11 +1,16 @@
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
+#include "Extent.h"
 #include "Rng.h"
 
+#include <array>
 #include <cstddef>
 #include <cstring>
 #include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 #include <initializer_list>
 #include <string>
@@ -27,12 +32,24 @@ public:
 
     static constexpr size_t NUM_PARAMS = __NUM_PARAMS;
 
+    // Inline array for a compile-time number of parameters, heap vector for DYNAMIC_EXTENT
+    using storage_t = std::conditional_t< NUM_PARAMS == DYNAMIC_EXTENT, std::vector< param_t >, std::array< param_t, NUM_PARAMS > >;
+
+
     // Constructor
     inline Particle()
         : position_{}
         , fitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        std::memset( position_, 0, NUM_PARAMS * sizeof( param_t ) );
+    }
+
+
+    // Constructor, zeroed position of numParams parameters
+    inline explicit Particle( const size_t numParams )
+        : position_{}
+        , fitness_{ std::numeric_limits< fitness_t >::max() }
+    {
+        resize( numParams );
     }
 
 
@@ -41,20 +58,22 @@ public:
 
 
     // Copy Constructor
-    inline Particle( const Particle ( &other )[NUM_PARAMS] )
+    template< size_t N >
+    inline Particle( const param_t ( &other )[N] )
         : position_{}
         , fitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        std::memcpy( position_, other, NUM_PARAMS * sizeof( param_t ) );
+        resize( N );
+
+        std::memcpy( position_.data(), other, N * sizeof( param_t ) );
     }
 
 
     // Copy Constructor
     inline Particle( const Particle& other )
-        : position_{}
+        : position_{ other.position_ }
         , fitness_{ other.fitness_ }
     {
-        std::memcpy( position_, other.position_, NUM_PARAMS * sizeof( param_t ) );
     }
 
 
@@ -63,12 +82,9 @@ public:
         : position_{}
         , fitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        if ( other.size() != NUM_PARAMS )
-        {
-            throw std::invalid_argument( "Particle::Particle: initializer list size must match number of parameters" );
-        }
+        resize( other.size() );
 
-        std::memset( position_, 0, NUM_PARAMS * sizeof( param_t ) );
+        std::copy( other.begin(), other.end(), position_.begin() );
     }
 
 
@@ -77,8 +93,8 @@ public:
     {
         if ( this != &other )
         {
-            std::memcpy( position_, other.position_, NUM_PARAMS * sizeof( param_t ) );
-            fitness_ = other.fitness_;
+            position_ = other.position_;
+            fitness_  = other.fitness_;
         }
 
         return *this;
@@ -88,9 +104,9 @@ public:
     // Addition operator
     inline Particle operator+( const Particle& other ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] + other.position_[i];
         }
@@ -102,9 +118,9 @@ public:
     // Subtraction operator
     inline Particle operator-( const Particle& other ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] - other.position_[i];
         }
@@ -116,9 +132,9 @@ public:
     // Multiplication operator
     inline Particle operator*( const Particle& other ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] * other.position_[i];
         }
@@ -130,9 +146,9 @@ public:
     // Division operator
     inline Particle operator/( const Particle& other ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] / other.position_[i];
         }
@@ -144,7 +160,7 @@ public:
     // Addition assignment operator
     inline Particle& operator+=( const Particle& other )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] += other.position_[i];
         }
@@ -156,7 +172,7 @@ public:
     // Subtraction assignment operator
     inline Particle& operator-=( const Particle& other )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] -= other.position_[i];
         }
@@ -168,7 +184,7 @@ public:
     // Multiplication assignment operator
     inline Particle& operator*=( const Particle& other )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] *= other.position_[i];
         }
@@ -180,7 +196,7 @@ public:
     // Division assignment operator
     inline Particle& operator/=( const Particle& other )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] /= other.position_[i];
         }
@@ -192,9 +208,9 @@ public:
     // Addition operator
     inline Particle operator+( const param_t scalar ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] + scalar;
         }
@@ -206,9 +222,9 @@ public:
     // Subtraction operator
     inline Particle operator-( const param_t scalar ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] - scalar;
         }
@@ -220,9 +236,9 @@ public:
     // Multiplication operator
     inline Particle operator*( const param_t scalar ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] * scalar;
         }
@@ -234,9 +250,9 @@ public:
     // Division operator
     inline Particle operator/( const param_t scalar ) const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = position_[i] / scalar;
         }
@@ -248,7 +264,7 @@ public:
     // Addition assignment operator
     inline Particle& operator+=( const param_t scalar )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] += scalar;
         }
@@ -260,7 +276,7 @@ public:
     // Subtraction assignment operator
     inline Particle& operator-=( const param_t scalar )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] -= scalar;
         }
@@ -272,7 +288,7 @@ public:
     // Multiplication assignment operator
     inline Particle& operator*=( const param_t scalar )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] *= scalar;
         }
@@ -284,7 +300,7 @@ public:
     // Division assignment operator
     inline Particle& operator/=( const param_t scalar )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             position_[i] /= scalar;
         }
@@ -296,9 +312,9 @@ public:
     // Negation operator
     inline Particle operator-() const
     {
-        Particle result;
+        Particle result( size() );
 
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             result.position_[i] = -position_[i];
         }
@@ -307,20 +323,18 @@ public:
     }
 
 
-    inline void initialize( const param_t lowerBounds[NUM_PARAMS], const param_t upperBounds[NUM_PARAMS] )
+    inline void initialize( const param_t* lowerBounds, const param_t* upperBounds, Rng<>& rng )
     {
-        Rng<>* rng = Rng<>::getInstance();
-
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
-            position_[i] = rng->drawUniform( lowerBounds[i], upperBounds[i] );
+            position_[i] = rng.drawUniform( lowerBounds[i], upperBounds[i] );
         }
     }
 
 
-    inline void clip( const param_t lowerBounds[NUM_PARAMS], const param_t upperBounds[NUM_PARAMS] )
+    inline void clip( const param_t* lowerBounds, const param_t* upperBounds )
     {
-        for ( size_t i = 0; i < NUM_PARAMS; ++i )
+        for ( size_t i = 0; i < size(); ++i )
         {
             if ( position_[i] < lowerBounds[i] )
             {
@@ -336,6 +350,8 @@ public:
 
     inline fitness_t getFitness() const { return fitness_; };
 
+    inline size_t size() const { return position_.size(); }
+
     inline bool operator==( const Particle& other ) const { return fitness_ == other.fitness_; }
     inline bool operator!=( const Particle& other ) const { return fitness_ != other.fitness_; }
     inline bool operator>( const Particle& other ) const { return fitness_ > other.fitness_; }
@@ -343,10 +359,26 @@ public:
     inline bool operator>=( const Particle& other ) const { return fitness_ >= other.fitness_; }
     inline bool operator<=( const Particle& other ) const { return fitness_ <= other.fitness_; }
 
-    param_t position_[NUM_PARAMS];
+    storage_t position_;
     fitness_t fitness_;
 
 
+protected:
+
+    // Only a dynamic particle can change its number of parameters
+    inline void resize( const size_t numParams )
+    {
+        if constexpr ( NUM_PARAMS == DYNAMIC_EXTENT )
+        {
+            position_.assign( numParams, static_cast< param_t >( 0 ) );
+        }
+        else if ( numParams != NUM_PARAMS )
+        {
+            throw std::invalid_argument( "Particle::resize: size must match number of parameters" );
+        }
+    }
+
+
 }; // class Particle
 
 
@@ -396,6 +428,11 @@ public:
     {}
 
 
+    inline explicit BestParticle( const size_t numParams )
+        : Base( numParams )
+    {}
+
+
     inline virtual ~BestParticle() {}
 
 
@@ -420,6 +457,19 @@ public:
     }
 
 
+    inline bool trialPosition( const typename Base::param_t* position, const typename Base::fitness_t fitness )
+    {
+        if ( fitness < this->fitness_ )
+        {
+            std::memcpy( this->position_.data(), position, this->size() * sizeof( typename Base::param_t ) );
+            this->fitness_ = fitness;
+            return true;
+        }
+
+        return false;
+    }
+
+
     template< size_t NUM_PARTICLES >
     inline bool trialParticle( const Base ( &particles )[NUM_PARTICLES] )
     {
@@ -0,0 +1,270 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+
+namespace MetaOpt
+{
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The output is a pure function of ( seed, stream, counter ), so every stream can be advanced independently
+// of every other one without any shared state.
+class Philox4x32
+{
+public:
+
+    using result_type = uint64_t;
+
+
+    static constexpr size_t   NUM_ROUNDS = 10;
+    static constexpr uint32_t MULTIPLIER_0 = 0xD2511F53u;
+    static constexpr uint32_t MULTIPLIER_1 = 0xCD9E8D57u;
+    static constexpr uint32_t WEYL_0       = 0x9E3779B9u;
+    static constexpr uint32_t WEYL_1       = 0xBB67AE85u;
+
+
+    static constexpr result_type min() { return std::numeric_limits< result_type >::min(); }
+    static constexpr result_type max() { return std::numeric_limits< result_type >::max(); }
+
+
+    // Constructor
+    inline explicit Philox4x32( const uint64_t seed = 0u, const uint64_t stream = 0u )
+        : key_{}
+        , stream_{ 0u }
+        , counter_{ 0u }
+        , buffer_{}
+        , bufferIdx_{ 2u }
+    {
+        this->seed( seed, stream );
+    }
+
+
+    inline void seed( const uint64_t seed, const uint64_t stream = 0u )
+    {
+        key_[0]    = static_cast< uint32_t >( seed );
+        key_[1]    = static_cast< uint32_t >( seed >> 32 );
+        stream_    = stream;
+        counter_   = 0u;
+        bufferIdx_ = 2u;
+    }
+
+
+    inline result_type operator()()
+    {
+        if ( bufferIdx_ == 2u )
+        {
+            generateBlock( counter_++, buffer_ );
+            bufferIdx_ = 0u;
+        }
+
+        return buffer_[bufferIdx_++];
+    }
+
+
+    inline void discard( unsigned long long n )
+    {
+        // Skip whole blocks in O(1), then consume the remainder
+        const uint64_t buffered = 2u - bufferIdx_;
+
+        if ( n <= buffered )
+        {
+            bufferIdx_ += static_cast< uint32_t >( n );
+            return;
+        }
+
+        n -= buffered;
+
+        counter_  += n / 2u;
+        bufferIdx_ = 2u;
+
+        if ( n % 2u )
+        {
+            ( *this )();
+        }
+    }
+
+
+    // Writes the next n outputs, the same values n calls to operator() would return
+    inline void fill( result_type* out, const size_t n )
+    {
+        size_t i = 0;
+
+        while ( i < n && bufferIdx_ < 2u )
+        {
+            out[i++] = buffer_[bufferIdx_++];
+        }
+
+        const size_t numBlocks = ( n - i ) / 2u;
+
+        generateBlocks( counter_, numBlocks, out + i );
+
+        counter_ += numBlocks;
+        i        += 2u * numBlocks;
+
+        if ( i < n )
+        {
+            out[i] = ( *this )();
+        }
+    }
+
+
+    // Raw block function: four 32-bit words for ( key, stream, counter ) packed into two 64-bit results
+    inline void generateBlock( const uint64_t counter, result_type ( &out )[2] ) const
+    {
+        uint32_t ctr[4] =
+        {
+            static_cast< uint32_t >( counter ),
+            static_cast< uint32_t >( counter >> 32 ),
+            static_cast< uint32_t >( stream_ ),
+            static_cast< uint32_t >( stream_ >> 32 )
+        };
+
+        uint32_t key[2] = { key_[0], key_[1] };
+
+        for ( size_t r = 0; r < NUM_ROUNDS; ++r )
+        {
+            if ( r > 0 )
+            {
+                key[0] += WEYL_0;
+                key[1] += WEYL_1;
+            }
+
+            const uint64_t prod0 = static_cast< uint64_t >( MULTIPLIER_0 ) * ctr[0];
+            const uint64_t prod1 = static_cast< uint64_t >( MULTIPLIER_1 ) * ctr[2];
+
+            const uint32_t hi0 = static_cast< uint32_t >( prod0 >> 32 );
+            const uint32_t lo0 = static_cast< uint32_t >( prod0 );
+            const uint32_t hi1 = static_cast< uint32_t >( prod1 >> 32 );
+            const uint32_t lo1 = static_cast< uint32_t >( prod1 );
+
+            ctr[0] = hi1 ^ ctr[1] ^ key[0];
+            ctr[1] = lo1;
+            ctr[2] = hi0 ^ ctr[3] ^ key[1];
+            ctr[3] = lo0;
+        }
+
+        out[0] = static_cast< uint64_t >( ctr[0] ) | ( static_cast< uint64_t >( ctr[1] ) << 32 );
+        out[1] = static_cast< uint64_t >( ctr[2] ) | ( static_cast< uint64_t >( ctr[3] ) << 32 );
+    }
+
+
+    // Blocks for counters [counter, counter + count), two results each. Groups of counters go through the
+    // rounds side by side, so the multiplies vectorize across blocks.
+    inline void generateBlocks( uint64_t counter, size_t count, result_type* out ) const
+    {
+        constexpr size_t LANES = 8;
+
+        for ( ; count >= LANES; count -= LANES, counter += LANES, out += 2 * LANES )
+        {
+            uint32_t ctr0[LANES], ctr1[LANES], ctr2[LANES], ctr3[LANES];
+
+            for ( size_t l = 0; l < LANES; ++l )
+            {
+                ctr0[l] = static_cast< uint32_t >( counter + l );
+                ctr1[l] = static_cast< uint32_t >( ( counter + l ) >> 32 );
+                ctr2[l] = static_cast< uint32_t >( stream_ );
+                ctr3[l] = static_cast< uint32_t >( stream_ >> 32 );
+            }
+
+            uint32_t key0 = key_[0];
+            uint32_t key1 = key_[1];
+
+            for ( size_t r = 0; r < NUM_ROUNDS; ++r )
+            {
+                if ( r > 0 )
+                {
+                    key0 += WEYL_0;
+                    key1 += WEYL_1;
+                }
+
+                for ( size_t l = 0; l < LANES; ++l )
+                {
+                    const uint64_t prod0 = static_cast< uint64_t >( MULTIPLIER_0 ) * ctr0[l];
+                    const uint64_t prod1 = static_cast< uint64_t >( MULTIPLIER_1 ) * ctr2[l];
+
+                    ctr0[l] = static_cast< uint32_t >( prod1 >> 32 ) ^ ctr1[l] ^ key0;
+                    ctr1[l] = static_cast< uint32_t >( prod1 );
+                    ctr2[l] = static_cast< uint32_t >( prod0 >> 32 ) ^ ctr3[l] ^ key1;
+                    ctr3[l] = static_cast< uint32_t >( prod0 );
+                }
+            }
+
+            for ( size_t l = 0; l < LANES; ++l )
+            {
+                out[2 * l]     = static_cast< uint64_t >( ctr0[l] ) | ( static_cast< uint64_t >( ctr1[l] ) << 32 );
+                out[2 * l + 1] = static_cast< uint64_t >( ctr2[l] ) | ( static_cast< uint64_t >( ctr3[l] ) << 32 );
+            }
+        }
+
+        for ( ; count > 0; --count, ++counter, out += 2 )
+        {
+            result_type block[2];
+
+            generateBlock( counter, block );
+
+            out[0] = block[0];
+            out[1] = block[1];
+        }
+    }
+
+
+    // Complete generator state with no padding, for checkpoints
+    struct State
+    {
+        uint32_t key[2];
+        uint32_t bufferIdx;
+        uint32_t reserved;
+        uint64_t stream;
+        uint64_t counter;
+        result_type buffer[2];
+    };
+
+
+    inline State getState() const
+    {
+        return State{ { key_[0], key_[1] }, bufferIdx_, 0u, stream_, counter_, { buffer_[0], buffer_[1] } };
+    }
+
+
+    inline void setState( const State& state )
+    {
+        key_[0]    = state.key[0];
+        key_[1]    = state.key[1];
+        bufferIdx_ = state.bufferIdx;
+        stream_    = state.stream;
+        counter_   = state.counter;
+        buffer_[0] = state.buffer[0];
+        buffer_[1] = state.buffer[1];
+    }
+
+
+    inline uint64_t getSeed() const { return static_cast< uint64_t >( key_[0] ) | ( static_cast< uint64_t >( key_[1] ) << 32 ); }
+    inline uint64_t getStream() const { return stream_; }
+
+
+    inline bool operator==( const Philox4x32& other ) const
+    {
+        return key_[0] == other.key_[0] && key_[1] == other.key_[1] && stream_ == other.stream_ &&
+               counter_ == other.counter_ && bufferIdx_ == other.bufferIdx_;
+    }
+
+    inline bool operator!=( const Philox4x32& other ) const { return !( *this == other ); }
+
+
+private:
+
+    uint32_t key_[2];
+    uint64_t stream_;
+    uint64_t counter_;
+
+    result_type buffer_[2];
+    uint32_t bufferIdx_;
+
+}; // class Philox4x32
+
+} // namespace MetaOpt
+
+#endif // PHILOX_H
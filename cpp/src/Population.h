@@ -0,0 +1,294 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include "Arena.h"
+#include "Extent.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+
+namespace MetaOpt
+{
+
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+
+// Fixed-size array aligned to, and padded up to, a whole number of cache lines. The padding is zeroed, so
+// vectorized loops may run over it and neighbouring arrays never share a cache line.
+template< typename __T, size_t __SIZE, size_t __ALIGNMENT = CACHE_LINE_SIZE >
+class AlignedArray
+{
+public:
+
+    using value_type = __T;
+
+    static_assert( __ALIGNMENT % sizeof( value_type ) == 0, "Alignment must be a multiple of the element size" );
+
+    static constexpr size_t SIZE        = __SIZE;
+    static constexpr size_t ALIGNMENT   = __ALIGNMENT;
+    static constexpr size_t PADDED_SIZE = ( ( SIZE * sizeof( value_type ) + ALIGNMENT - 1 ) / ALIGNMENT ) * ALIGNMENT / sizeof( value_type );
+
+
+    inline AlignedArray()
+        : data_{}
+    {
+    }
+
+
+    // Same signature as the dynamic array, so owners can construct either kind alike
+    inline AlignedArray( const size_t size, Arena& )
+        : data_{}
+    {
+        if ( size != SIZE )
+        {
+            throw std::invalid_argument( "AlignedArray::AlignedArray: size must match the compile-time size" );
+        }
+    }
+
+
+    inline void fill( const value_type& value ) { std::fill( data_, data_ + SIZE, value ); }
+
+    inline value_type* data() { return data_; }
+    inline const value_type* data() const { return data_; }
+
+    inline value_type& operator[]( const size_t i ) { return data_[i]; }
+    inline const value_type& operator[]( const size_t i ) const { return data_[i]; }
+
+    static constexpr size_t size() { return SIZE; }
+
+
+private:
+
+    alignas( ALIGNMENT ) value_type data_[PADDED_SIZE == 0 ? 1 : PADDED_SIZE];
+
+}; // class AlignedArray
+
+
+
+// Run-time sized array carved out of an Arena, with the same alignment and padding guarantees. Does not own
+// its memory: the arena releases it.
+template< typename __T, size_t __ALIGNMENT >
+class AlignedArray< __T, DYNAMIC_EXTENT, __ALIGNMENT >
+{
+public:
+
+    using value_type = __T;
+
+    static_assert( __ALIGNMENT % sizeof( value_type ) == 0, "Alignment must be a multiple of the element size" );
+
+    static constexpr size_t SIZE      = DYNAMIC_EXTENT;
+    static constexpr size_t ALIGNMENT = __ALIGNMENT;
+
+
+    inline AlignedArray( const size_t size, Arena& arena )
+        : data_{ arena.allocate< value_type >( paddedSize( size ), ALIGNMENT ) }
+        , size_{ size }
+    {
+        std::fill( data_, data_ + paddedSize( size ), value_type{} );
+    }
+
+
+    inline void fill( const value_type& value ) { std::fill( data_, data_ + size_, value ); }
+
+    inline value_type* data() { return data_; }
+    inline const value_type* data() const { return data_; }
+
+    inline value_type& operator[]( const size_t i ) { return data_[i]; }
+    inline const value_type& operator[]( const size_t i ) const { return data_[i]; }
+
+    inline size_t size() const { return size_; }
+
+
+    static constexpr size_t paddedSize( const size_t size )
+    {
+        return ( ( size * sizeof( value_type ) + ALIGNMENT - 1 ) / ALIGNMENT ) * ALIGNMENT / sizeof( value_type );
+    }
+
+
+private:
+
+    value_type* data_;
+    size_t size_;
+
+    AlignedArray( const AlignedArray& ) = delete;
+    AlignedArray& operator=( const AlignedArray& ) = delete;
+
+}; // class AlignedArray
+
+
+
+// Structure-of-arrays population: all positions in one row-major [numParticles x numParams] block and all
+// fitnesses in a separate block. Rows are contiguous, so any range of particles is also a valid batch.
+// Either extent may be DYNAMIC_EXTENT, in which case the blocks come from an Arena.
+//
+// For noisy objectives the fitness is the running mean of sampleCount samples, with the sum of their squared
+// deviations from it alongside (Welford). These are kept up to date only while resampling is enabled.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class Population
+{
+public:
+
+    using param_t   = __PARAM_T;
+    using fitness_t = __FITNESS_T;
+
+    static constexpr size_t NUM_PARTICLES = __NUM_PARTICLES;
+    static constexpr size_t NUM_PARAMS    = __NUM_PARAMS;
+    static constexpr bool   IS_DYNAMIC    = NUM_PARTICLES == DYNAMIC_EXTENT || NUM_PARAMS == DYNAMIC_EXTENT;
+
+
+    inline Population()
+        requires ( !IS_DYNAMIC )
+        : numParticles_{ NUM_PARTICLES }
+        , numParams_{ NUM_PARAMS }
+        , position_{}
+        , fitness_{}
+        , sampleCount_{}
+        , sumSquares_{}
+    {
+        fitness_.fill( std::numeric_limits< fitness_t >::max() );
+    }
+
+
+    inline Population( const size_t numParticles, const size_t numParams, Arena& arena )
+        : numParticles_{ numParticles }
+        , numParams_{ numParams }
+        , position_{ numParticles * numParams, arena }
+        , fitness_{ numParticles, arena }
+        , sampleCount_{ numParticles, arena }
+        , sumSquares_{ numParticles, arena }
+    {
+        fitness_.fill( std::numeric_limits< fitness_t >::max() );
+    }
+
+
+    inline size_t getNumParticles() const
+    {
+        if constexpr ( NUM_PARTICLES != DYNAMIC_EXTENT ) { return NUM_PARTICLES; }
+        else { return numParticles_; }
+    }
+
+
+    inline size_t getNumParams() const
+    {
+        if constexpr ( NUM_PARAMS != DYNAMIC_EXTENT ) { return NUM_PARAMS; }
+        else { return numParams_; }
+    }
+
+
+    inline param_t* position( const size_t idx ) { return position_.data() + idx * getNumParams(); }
+    inline const param_t* position( const size_t idx ) const { return position_.data() + idx * getNumParams(); }
+
+    inline fitness_t& fitness( const size_t idx ) { return fitness_[idx]; }
+    inline const fitness_t& fitness( const size_t idx ) const { return fitness_[idx]; }
+
+    inline param_t* positions() { return position_.data(); }
+    inline const param_t* positions() const { return position_.data(); }
+
+    inline fitness_t* fitnesses() { return fitness_.data(); }
+    inline const fitness_t* fitnesses() const { return fitness_.data(); }
+
+    inline uint32_t& sampleCount( const size_t idx ) { return sampleCount_[idx]; }
+    inline const uint32_t& sampleCount( const size_t idx ) const { return sampleCount_[idx]; }
+
+    inline fitness_t& sumSquares( const size_t idx ) { return sumSquares_[idx]; }
+    inline const fitness_t& sumSquares( const size_t idx ) const { return sumSquares_[idx]; }
+
+    inline uint32_t* sampleCounts() { return sampleCount_.data(); }
+    inline const uint32_t* sampleCounts() const { return sampleCount_.data(); }
+
+    inline fitness_t* sumsOfSquares() { return sumSquares_.data(); }
+    inline const fitness_t* sumsOfSquares() const { return sumSquares_.data(); }
+
+
+    // Sample variance of the fitness, 0 below two samples
+    inline fitness_t variance( const size_t idx ) const
+    {
+        return sampleCount_[idx] > 1 ? sumSquares_[idx] / static_cast< fitness_t >( sampleCount_[idx] - 1 ) : fitness_t{};
+    }
+
+
+    // Fitness set from outside the sampling, e.g. by a migrant: no statistics
+    inline void resetSamples( const size_t idx )
+    {
+        sampleCount_[idx] = 0u;
+        sumSquares_[idx]  = fitness_t{};
+    }
+
+
+    // Adds count samples with the given mean and sum of squared deviations to the statistics of particle idx
+    inline void mergeSamples( const size_t idx, const uint32_t count, const fitness_t mean, const fitness_t sumSquares )
+    {
+        const uint32_t total = sampleCount_[idx] + count;
+        const fitness_t delta = mean - fitness_[idx];
+        const fitness_t share = static_cast< fitness_t >( count ) / static_cast< fitness_t >( total );
+
+        sumSquares_[idx] += sumSquares + delta * delta * static_cast< fitness_t >( sampleCount_[idx] ) * share;
+        fitness_[idx]    += delta * share;
+
+        sampleCount_[idx] = total;
+    }
+
+
+    // Copies particle srcIdx of src, position and fitness, into particle dstIdx
+    inline void copyParticle( const size_t dstIdx, const Population& src, const size_t srcIdx )
+    {
+        std::memcpy( position( dstIdx ), src.position( srcIdx ), getNumParams() * sizeof( param_t ) );
+        fitness_[dstIdx]     = src.fitness_[srcIdx];
+        sampleCount_[dstIdx] = src.sampleCount_[srcIdx];
+        sumSquares_[dstIdx]  = src.sumSquares_[srcIdx];
+    }
+
+
+    template< typename particle_t >
+    inline void loadParticle( const size_t idx, const particle_t& particle )
+    {
+        if ( particle.size() != getNumParams() )
+        {
+            throw std::invalid_argument( "Population::loadParticle: particle size must match number of parameters" );
+        }
+
+        std::memcpy( position( idx ), particle.position_.data(), getNumParams() * sizeof( param_t ) );
+        fitness_[idx] = particle.fitness_;
+
+        resetSamples( idx );
+    }
+
+
+    // The particle must already have getNumParams() parameters
+    template< typename particle_t >
+    inline void storeParticle( const size_t idx, particle_t& particle ) const
+    {
+        std::memcpy( particle.position_.data(), position( idx ), getNumParams() * sizeof( param_t ) );
+        particle.fitness_ = fitness_[idx];
+    }
+
+
+    // Index of the fittest particle in [begin, end)
+    inline size_t argBest( const size_t begin, const size_t end ) const
+    {
+        return static_cast< size_t >( std::min_element( fitness_.data() + begin, fitness_.data() + end ) - fitness_.data() );
+    }
+
+    inline size_t argBest() const { return argBest( 0, getNumParticles() ); }
+
+
+private:
+
+    size_t numParticles_;
+    size_t numParams_;
+
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > position_;
+    AlignedArray< fitness_t, NUM_PARTICLES > fitness_;
+    AlignedArray< uint32_t, NUM_PARTICLES > sampleCount_;
+    AlignedArray< fitness_t, NUM_PARTICLES > sumSquares_;
+
+}; // class Population
+
+} // namespace MetaOpt
+
+#endif // POPULATION_H
@@ -0,0 +1,663 @@
+#ifndef PROCESS_ISLANDS_H
+#define PROCESS_ISLANDS_H
+
+#include "Migration.h"
+#include "Observer.h"
+#include "SharedMemory.h"
+#include "SpscRing.h"
+#include "Termination.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace MetaOpt
+{
+
+// Island model with one forked worker process per island, for objectives that crash, leak or are not
+// thread-safe. A crashing island only ends itself. Islands exchange migrants through SPSC rings in one POSIX
+// shared memory segment, one ring per topology edge, and report their best particle to the calling process
+// through one more ring each. The calling process coordinates: it tracks the global best, applies its own
+// termination criteria to the whole model and stops every island through a flag in the segment. All traffic is
+// MigrationMessage bytes, so the rings can be swapped for sockets to spread islands over several machines.
+// Fork from a process with no other threads running, and keep the factory free of shared state.
+template< typename __ALG_T >
+class ProcessIslands
+{
+public:
+
+    using alg_t         = __ALG_T;
+    using param_t       = typename alg_t::param_t;
+    using fitness_t     = typename alg_t::fitness_t;
+    using termination_t = Termination< param_t, fitness_t >;
+    using observer_t    = Observer< param_t, fitness_t >;
+    using view_t        = IterationView< param_t, fitness_t >;
+
+    // Builds island idx inside its worker process, after the fork; the model then sets its seed
+    using factory_t = std::function< std::unique_ptr< alg_t >( size_t idx ) >;
+
+    using Topology = MigrationTopology;
+
+
+    enum class IslandStatus
+    {
+        RUNNING,
+        FINISHED,       // Exited normally after its run
+        FAILED          // Threw, exited with an error or was killed by a signal
+    };
+
+    struct IslandResult
+    {
+        pid_t pid;
+        IslandStatus status;
+        int exitCode;               // Exit status, or the signal that killed the worker
+        StopReason stopReason;      // Reported when the island finished its run
+        uint64_t iterations;        // As of the last report
+        uint64_t evaluations;
+        fitness_t bestFitness;
+        uint64_t sent;              // Migration totals
+        uint64_t dropped;
+        uint64_t accepted;
+    };
+
+
+    static constexpr uint64_t DEFAULT_MIGRATION_INTERVAL = 10;
+    static constexpr size_t   DEFAULT_NUM_MIGRANTS       = 2;
+    static constexpr size_t   MAILBOX_CAPACITY           = 4;
+    static constexpr size_t   REPORT_CAPACITY            = 64;
+
+
+    ProcessIslands( const size_t numIslands, const size_t numParams, factory_t factory )
+        : numIslands_{ numIslands }
+        , numParams_{ numParams }
+        , factory_{ std::move( factory ) }
+        , seed_{ 0u }
+        , topology_{ Topology::RING }
+        , torusColumns_{ 0u }
+        , migrationInterval_{ DEFAULT_MIGRATION_INTERVAL }
+        , numMigrants_{ DEFAULT_NUM_MIGRANTS }
+        , reportInterval_{ 1u }
+        , pinProcesses_{ true }
+        , pollInterval_{ std::chrono::microseconds( 500 ) }
+        , shutdownGrace_{ std::chrono::seconds( 5 ) }
+        , termination_{}
+        , stopReason_{ StopReason::NONE }
+        , results_{}
+        , bestIsland_{ 0u }
+        , bestFitness_{ std::numeric_limits< fitness_t >::max() }
+        , bestPosition_( numParams )
+        , segment_{ nullptr }
+        , control_{ nullptr }
+        , counters_{ nullptr }
+        , inboxes_{}
+        , outboxes_{}
+        , reports_{}
+        , rings_{}
+    {
+        if ( numIslands_ == 0 || !factory_ )
+        {
+            throw std::invalid_argument( "ProcessIslands::ProcessIslands: at least one island and a factory are needed" );
+        }
+    }
+
+
+    ~ProcessIslands() = default;
+
+
+    // Island i draws from getIslandSeed( seed, i )
+    void setSeed( const uint64_t seed ) { seed_ = seed; }
+
+    // columns only applies to TORUS, see getMigrationNeighbours
+    void setTopology( const Topology topology, const size_t columns = 0u )
+    {
+        topology_     = topology;
+        torusColumns_ = columns;
+    }
+
+    // Every interval iterations each island sends its numMigrants best particles along the topology.
+    // An interval of 0 keeps the islands isolated.
+    void setMigration( const uint64_t interval, const size_t numMigrants )
+    {
+        migrationInterval_ = interval;
+        numMigrants_       = std::max< size_t >( numMigrants, 1u );
+    }
+
+    // Islands report their best particle every interval iterations, and always at the start and the end
+    void setReportInterval( const uint64_t interval ) { reportInterval_ = std::max< uint64_t >( interval, 1u ); }
+
+    // Pins island i to the i-th CPU the process may run on, wrapping around
+    void setProcessPinning( const bool pin ) { pinProcesses_ = pin; }
+
+    // How long the coordinator sleeps when no island had anything to report
+    void setPollInterval( const std::chrono::microseconds interval ) { pollInterval_ = interval; }
+
+    // Islands still running this long after being told to stop, e.g. stuck in the objective, are killed
+    void setShutdownGrace( const std::chrono::duration< double > grace ) { shutdownGrace_ = grace; }
+
+
+    // Criteria applied by the coordinator to the whole model: the global best, the summed evaluations and the
+    // iterations of the furthest island. Each island still applies its own, configured by the factory.
+    termination_t& getTermination() { return termination_; }
+
+
+    void run()
+    {
+        setUp();
+
+        std::vector< pid_t > pids;
+
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush( nullptr );
+
+        const std::vector< int > cpus = pinProcesses_ ? getAllowedCpus() : std::vector< int >{};
+
+        for ( size_t i = 0; i < numIslands_; ++i )
+        {
+            const pid_t pid = fork();
+
+            if ( pid == 0 )
+            {
+                if ( !cpus.empty() )
+                {
+                    cpu_set_t set;
+                    CPU_ZERO( &set );
+                    CPU_SET( cpus[i % cpus.size()], &set );
+
+                    sched_setaffinity( 0, sizeof( set ), &set );
+                }
+
+                runWorker( i );
+            }
+
+            if ( pid < 0 )
+            {
+                const int error = errno;
+
+                control_->stop.store( true, std::memory_order_relaxed );
+
+                for ( const pid_t started : pids )
+                {
+                    waitpid( started, nullptr, 0 );
+                }
+
+                throw std::system_error( error, std::generic_category(), "ProcessIslands::run: cannot fork" );
+            }
+
+            pids.push_back( pid );
+            results_[i].pid = pid;
+        }
+
+        coordinate();
+    }
+
+
+    // Ends every island at its next iteration; for use from another thread of the calling process
+    void requestStop()
+    {
+        if ( control_ )
+        {
+            control_->stop.store( true, std::memory_order_relaxed );
+        }
+    }
+
+
+    StopReason getStopReason() const { return stopReason_; }
+
+    const std::vector< IslandResult >& getResults() const { return results_; }
+
+    size_t getBestIsland() const { return bestIsland_; }
+    fitness_t getBestFitness() const { return bestFitness_; }
+    const std::vector< param_t >& getBestPosition() const { return bestPosition_; }
+
+
+private:
+
+    struct alignas( CACHE_LINE_SIZE ) Control
+    {
+        std::atomic< bool > stop;
+    };
+
+    // Written by island idx only, read by the coordinator once the worker exited
+    struct alignas( CACHE_LINE_SIZE ) Counters
+    {
+        uint64_t sent;
+        uint64_t dropped;
+        uint64_t accepted;
+    };
+
+
+    // Runs inside the worker: migration and reports to the coordinator, between iterations
+    class Worker : public observer_t
+    {
+    public:
+
+        Worker( ProcessIslands& model, const size_t island, alg_t& alg )
+            : model_{ model }
+            , island_{ island }
+            , alg_{ alg }
+            , positions_( model.numMigrants_ * model.numParams_ )
+            , fitnesses_( model.numMigrants_ )
+        {
+        }
+
+        void onInitialized( const view_t& view ) override
+        {
+            report( view, MigrationMessage::PROGRESS, StopReason::NONE );
+        }
+
+        void onIteration( const view_t& view ) override
+        {
+            if ( model_.migrationInterval_ > 0 && view.iteration % model_.migrationInterval_ == 0 )
+            {
+                migrate( view );
+            }
+
+            if ( view.iteration % model_.reportInterval_ == 0 )
+            {
+                report( view, MigrationMessage::PROGRESS, StopReason::NONE );
+            }
+        }
+
+        void onRunEnd( const view_t& view, const StopReason reason ) override
+        {
+            report( view, MigrationMessage::FINISHED, reason );
+        }
+
+    private:
+
+        void migrate( const view_t& view )
+        {
+            Counters& counters = model_.counters_[island_];
+
+            const size_t numParams = model_.numParams_;
+            const size_t count     = std::min( model_.numMigrants_, alg_.getNumParticles() );
+
+            for ( SpscRing* mailbox : model_.inboxes_[island_] )
+            {
+                while ( const std::byte* slot = mailbox->tryPeek() )
+                {
+                    const MigrationMessage message =
+                        MigrationMessage::decode( slot, fitnesses_.data(), positions_.data(), model_.numMigrants_, numParams );
+
+                    mailbox->release();
+
+                    counters.accepted += alg_.immigrate( positions_.data(), fitnesses_.data(), message.count );
+                }
+            }
+
+            if ( model_.outboxes_[island_].empty() )
+            {
+                return;
+            }
+
+            alg_.getElites( count, positions_.data(), fitnesses_.data() );
+
+            const MigrationMessage message = makeMessage( view, MigrationMessage::MIGRANTS, StopReason::NONE, count );
+
+            for ( SpscRing* mailbox : model_.outboxes_[island_] )
+            {
+                std::byte* slot = mailbox->tryAcquire();
+
+                // A neighbour that has not caught up, or died, keeps the migrants it has not read yet
+                if ( !slot )
+                {
+                    ++counters.dropped;
+                    continue;
+                }
+
+                MigrationMessage::encode( slot, message, fitnesses_.data(), positions_.data() );
+
+                mailbox->commit();
+
+                ++counters.sent;
+            }
+        }
+
+        void report( const view_t& view, const MigrationMessage::Kind kind, const StopReason reason )
+        {
+            SpscRing& ring  = *model_.reports_[island_];
+            std::byte* slot = ring.tryAcquire();
+
+            // Progress reports may be skipped while the coordinator is behind, the final one may not
+            while ( !slot && kind == MigrationMessage::FINISHED )
+            {
+                std::this_thread::yield();
+                slot = ring.tryAcquire();
+            }
+
+            if ( !slot )
+            {
+                return;
+            }
+
+            MigrationMessage::encode( slot, makeMessage( view, kind, reason, 1u ), &view.bestFitness, view.bestPosition );
+
+            ring.commit();
+        }
+
+        MigrationMessage makeMessage( const view_t& view, const MigrationMessage::Kind kind, const StopReason reason, const size_t count ) const
+        {
+            MigrationMessage message{};
+            message.kind        = kind;
+            message.island      = static_cast< uint32_t >( island_ );
+            message.iteration   = view.iteration;
+            message.evaluations = view.evaluations;
+            message.count       = static_cast< uint32_t >( count );
+            message.numParams   = static_cast< uint32_t >( model_.numParams_ );
+            message.stopReason  = static_cast< uint32_t >( reason );
+            return message;
+        }
+
+        ProcessIslands& model_;
+        size_t island_;
+        alg_t& alg_;
+
+        std::vector< param_t > positions_;
+        std::vector< fitness_t > fitnesses_;
+    };
+
+
+    // Lays out the segment: control block, counters, then every ring
+    void setUp()
+    {
+        const size_t migrantSlot = MigrationMessage::getSize< param_t, fitness_t >( numMigrants_, numParams_ );
+        const size_t reportSlot  = MigrationMessage::getSize< param_t, fitness_t >( 1u, numParams_ );
+
+        std::vector< std::pair< size_t, size_t > > edges;
+
+        for ( size_t from = 0; from < numIslands_; ++from )
+        {
+            for ( const size_t to : getMigrationNeighbours( topology_, numIslands_, from, torusColumns_ ) )
+            {
+                edges.emplace_back( from, to );
+            }
+        }
+
+        const size_t migrantBytes = SpscRing::getRequiredBytes( migrantSlot, MAILBOX_CAPACITY );
+        const size_t reportBytes  = SpscRing::getRequiredBytes( reportSlot, REPORT_CAPACITY );
+        const size_t ringsOffset  = sizeof( Control ) + numIslands_ * sizeof( Counters );
+
+        rings_.clear();
+        segment_ = std::make_unique< SharedMemory >( ringsOffset + edges.size() * migrantBytes + numIslands_ * reportBytes );
+
+        std::byte* memory = segment_->data();
+
+        control_  = new ( memory ) Control{ false };
+        counters_ = reinterpret_cast< Counters* >( memory + sizeof( Control ) );
+
+        for ( size_t i = 0; i < numIslands_; ++i )
+        {
+            new ( counters_ + i ) Counters{ 0u, 0u, 0u };
+        }
+
+        std::byte* next = memory + ringsOffset;
+
+        inboxes_.assign( numIslands_, {} );
+        outboxes_.assign( numIslands_, {} );
+        reports_.clear();
+
+        for ( const auto& [from, to] : edges )
+        {
+            rings_.push_back( std::make_unique< SpscRing >( next, migrantSlot, MAILBOX_CAPACITY, true ) );
+            next += migrantBytes;
+
+            outboxes_[from].push_back( rings_.back().get() );
+            inboxes_[to].push_back( rings_.back().get() );
+        }
+
+        for ( size_t i = 0; i < numIslands_; ++i )
+        {
+            rings_.push_back( std::make_unique< SpscRing >( next, reportSlot, REPORT_CAPACITY, true ) );
+            next += reportBytes;
+
+            reports_.push_back( rings_.back().get() );
+        }
+
+        results_.assign( numIslands_, IslandResult{ 0, IslandStatus::RUNNING, 0, StopReason::NONE, 0u, 0u, std::numeric_limits< fitness_t >::max(), 0u, 0u, 0u } );
+
+        stopReason_  = StopReason::NONE;
+        bestIsland_  = 0u;
+        bestFitness_ = std::numeric_limits< fitness_t >::max();
+    }
+
+
+    [[noreturn]] void runWorker( const size_t idx )
+    {
+        int exitCode = 0;
+
+        try
+        {
+            std::unique_ptr< alg_t > alg = factory_( idx );
+
+            if ( !alg || alg->getNumParams() != numParams_ )
+            {
+                throw std::invalid_argument( "ProcessIslands: the factory must build islands with the model's number of parameters" );
+            }
+
+            alg->setSeed( getIslandSeed( seed_, idx ) );
+            alg->getTermination().setStopFlag( &control_->stop );
+            alg->addObserver( std::make_shared< Worker >( *this, idx, *alg ) );
+
+            alg->run();
+        }
+        catch ( const std::exception& e )
+        {
+            std::cerr << "ProcessIslands: island " << idx << ": " << e.what() << std::endl;
+            exitCode = 1;
+        }
+        catch ( ... )
+        {
+            exitCode = 1;
+        }
+
+        std::cout.flush();
+        std::fflush( nullptr );
+
+        // Skips the destructors and exit handlers the worker inherited from the calling process
+        _exit( exitCode );
+    }
+
+
+    void coordinate()
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::vector< param_t > position( numParams_ );
+
+        size_t running = numIslands_;
+        bool stopping  = false;
+        clock::time_point stopTime{};
+
+        termination_.start();
+
+        while ( running > 0 )
+        {
+            const bool received = drainReports( position );
+
+            for ( IslandResult& result : results_ )
+            {
+                int status;
+
+                if ( result.status != IslandStatus::RUNNING || waitpid( result.pid, &status, WNOHANG ) != result.pid )
+                {
+                    continue;
+                }
+
+                const bool clean = WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+
+                result.status   = clean ? IslandStatus::FINISHED : IslandStatus::FAILED;
+                result.exitCode = WIFSIGNALED( status ) ? WTERMSIG( status ) : WEXITSTATUS( status );
+
+                --running;
+            }
+
+            if ( !stopping )
+            {
+                uint64_t iterations  = 0;
+                uint64_t evaluations = 0;
+
+                for ( const IslandResult& result : results_ )
+                {
+                    iterations   = std::max( iterations, result.iterations );
+                    evaluations += result.evaluations;
+
+                    if ( result.stopReason == StopReason::TARGET_FITNESS )
+                    {
+                        stopReason_ = StopReason::TARGET_FITNESS;
+                    }
+                }
+
+                if ( stopReason_ == StopReason::NONE )
+                {
+                    stopReason_ = termination_.checkProgress( iterations, evaluations, bestFitness_ );
+                }
+
+                if ( stopReason_ != StopReason::NONE || control_->stop.load( std::memory_order_relaxed ) )
+                {
+                    control_->stop.store( true, std::memory_order_relaxed );
+
+                    stopping = true;
+                    stopTime = clock::now();
+                }
+            }
+            else if ( running > 0 && clock::now() - stopTime > shutdownGrace_ )
+            {
+                for ( const IslandResult& result : results_ )
+                {
+                    if ( result.status == IslandStatus::RUNNING )
+                    {
+                        kill( result.pid, SIGKILL );
+                    }
+                }
+            }
+
+            if ( !received && running > 0 )
+            {
+                std::this_thread::sleep_for( pollInterval_ );
+            }
+        }
+
+        // What the islands wrote before exiting
+        drainReports( position );
+
+        for ( size_t i = 0; i < numIslands_; ++i )
+        {
+            results_[i].sent     = counters_[i].sent;
+            results_[i].dropped  = counters_[i].dropped;
+            results_[i].accepted = counters_[i].accepted;
+        }
+
+        // Every island ended on its own: the model stopped for the reason the best one did
+        if ( stopReason_ == StopReason::NONE )
+        {
+            stopReason_ = control_->stop.load( std::memory_order_relaxed ) ? StopReason::STOP_REQUESTED : results_[bestIsland_].stopReason;
+        }
+    }
+
+
+    // Returns whether any report arrived
+    bool drainReports( std::vector< param_t >& position )
+    {
+        bool received = false;
+
+        for ( size_t i = 0; i < numIslands_; ++i )
+        {
+            while ( const std::byte* slot = reports_[i]->tryPeek() )
+            {
+                fitness_t fitness;
+
+                const MigrationMessage message = MigrationMessage::decode( slot, &fitness, position.data(), 1u, numParams_ );
+
+                reports_[i]->release();
+
+                IslandResult& result = results_[i];
+
+                result.iterations  = message.iteration;
+                result.evaluations = message.evaluations;
+                result.bestFitness = fitness;
+
+                if ( message.kind == MigrationMessage::FINISHED )
+                {
+                    result.stopReason = static_cast< StopReason >( message.stopReason );
+                }
+
+                if ( fitness < bestFitness_ )
+                {
+                    bestFitness_  = fitness;
+                    bestIsland_   = i;
+                    bestPosition_ = position;
+                }
+
+                received = true;
+            }
+        }
+
+        return received;
+    }
+
+
+    size_t numIslands_;
+    size_t numParams_;
+    factory_t factory_;
+
+    uint64_t seed_;
+    Topology topology_;
+    size_t torusColumns_;
+    uint64_t migrationInterval_;
+    size_t numMigrants_;
+    uint64_t reportInterval_;
+    bool pinProcesses_;
+
+    std::chrono::microseconds pollInterval_;
+    std::chrono::duration< double > shutdownGrace_;
+
+    termination_t termination_;
+    StopReason stopReason_;
+
+    std::vector< IslandResult > results_;
+    size_t bestIsland_;
+    fitness_t bestFitness_;
+    std::vector< param_t > bestPosition_;
+
+    std::unique_ptr< SharedMemory > segment_;
+    Control* control_;
+    Counters* counters_;
+
+    // Rings inside the segment; workers inherit these views with the mapping, at the same addresses
+    std::vector< std::vector< SpscRing* > > inboxes_;
+    std::vector< std::vector< SpscRing* > > outboxes_;
+    std::vector< SpscRing* > reports_;
+    std::vector< std::unique_ptr< SpscRing > > rings_;
+
+
+    ProcessIslands() = delete;
+    ProcessIslands( const ProcessIslands& ) = delete;
+    ProcessIslands& operator=( const ProcessIslands& ) = delete;
+
+}; // class ProcessIslands
+
+} // namespace MetaOpt
+
+#endif // PROCESS_ISLANDS_H
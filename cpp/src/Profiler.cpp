@@ -0,0 +1,468 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+
+
+namespace MetaOpt
+{
+
+namespace
+{
+
+std::atomic< uint64_t > nextRunId{ 1u };
+
+
+double toSeconds( const uint64_t nanos )
+{
+    return static_cast< double >( nanos ) * 1e-9;
+}
+
+
+double toMicroseconds( const uint64_t nanos )
+{
+    return static_cast< double >( nanos ) * 1e-3;
+}
+
+
+void writePhases( std::ostream& out, const std::array< uint64_t, Profiler::NUM_PHASES >& phaseNanos )
+{
+    out << "{";
+
+    for ( size_t p = 0; p < Profiler::NUM_PHASES; ++p )
+    {
+        out << ( p > 0 ? ", " : "" ) << "\"" << Profiler::getPhaseName( static_cast< Profiler::Phase >( p ) ) << "\": " << toSeconds( phaseNanos[p] );
+    }
+
+    out << "}";
+}
+
+} // namespace
+
+
+
+LatencyHistogram::LatencyHistogram()
+    : buckets_{}
+    , count_{ 0u }
+    , sum_{ 0u }
+    , max_{ 0u }
+{
+}
+
+
+void LatencyHistogram::merge( const LatencyHistogram& other )
+{
+    for ( size_t b = 0; b < NUM_BUCKETS; ++b )
+    {
+        buckets_[b] += other.buckets_[b];
+    }
+
+    count_ += other.count_;
+    sum_   += other.sum_;
+    max_    = std::max( max_, other.max_ );
+}
+
+
+void LatencyHistogram::reset()
+{
+    buckets_.fill( 0u );
+    count_ = 0u;
+    sum_   = 0u;
+    max_   = 0u;
+}
+
+
+uint64_t LatencyHistogram::percentile( const double quantile ) const
+{
+    if ( count_ == 0 )
+    {
+        return 0u;
+    }
+
+    const uint64_t rank = std::max< uint64_t >( 1u, static_cast< uint64_t >( std::clamp( quantile, 0.0, 1.0 ) * static_cast< double >( count_ ) + 0.5 ) );
+
+    uint64_t seen = 0u;
+
+    for ( size_t b = 0; b < NUM_BUCKETS; ++b )
+    {
+        seen += buckets_[b];
+
+        if ( seen >= rank )
+        {
+            if ( b < LINEAR_LIMIT )
+            {
+                return b;
+            }
+
+            const size_t exponent = ( b - LINEAR_LIMIT ) / SUB_BUCKETS + SUB_BUCKET_BITS + 1;
+            const size_t sub      = ( b - LINEAR_LIMIT ) % SUB_BUCKETS;
+            const uint64_t width  = uint64_t{ 1 } << ( exponent - SUB_BUCKET_BITS );
+
+            return std::min( ( SUB_BUCKETS + sub ) * width + width / 2, max_ );
+        }
+    }
+
+    return max_;
+}
+
+
+
+Profiler::Profiler( const size_t numWorkers )
+    : numWorkers_{ std::max< size_t >( numWorkers, 1u ) }
+    , slots_{}
+    , traceEnabled_{ false }
+    , latencySampleInterval_{ DEFAULT_LATENCY_SAMPLE_INTERVAL }
+    , runId_{ 0u }
+    , runStart_{ 0u }
+    , runStop_{ 0u }
+    , loopStart_{ 0u }
+    , iterations_{}
+    , iterationBaseline_{}
+    , fitnessCacheHits_{ 0u }
+    , fitnessCacheMisses_{ 0u }
+{
+    if constexpr ( ENABLED )
+    {
+        slots_.resize( numWorkers_ + 1 );
+    }
+}
+
+
+void Profiler::beginRun()
+{
+    if constexpr ( ENABLED )
+    {
+        for ( Slot& slot : slots_ )
+        {
+            slot.phaseNanos.fill( 0u );
+            slot.phaseCounts.fill( 0u );
+            slot.loopBusyNanos = 0u;
+            slot.evaluations   = 0u;
+            slot.sinceSample   = 0u;
+            slot.latency.reset();
+            slot.events.clear();
+        }
+
+        iterations_.clear();
+
+        fitnessCacheHits_   = 0u;
+        fitnessCacheMisses_ = 0u;
+
+        runId_    = nextRunId.fetch_add( 1u, std::memory_order_relaxed );
+        runStart_ = now();
+        runStop_  = runStart_;
+    }
+}
+
+
+void Profiler::endRun()
+{
+    runStop_ = now();
+}
+
+
+void Profiler::beginIteration( const uint64_t iteration )
+{
+    if constexpr ( ENABLED )
+    {
+        iterations_.push_back( { iteration, now(), 0u, {} } );
+        iterationBaseline_ = sumPhases();
+    }
+}
+
+
+void Profiler::endIteration()
+{
+    if constexpr ( ENABLED )
+    {
+        IterationRecord& record = iterations_.back();
+
+        record.duration = now() - record.start;
+
+        const std::array< uint64_t, NUM_PHASES > totals = sumPhases();
+
+        for ( size_t p = 0; p < NUM_PHASES; ++p )
+        {
+            record.phaseNanos[p] = totals[p] - iterationBaseline_[p];
+        }
+    }
+}
+
+
+void Profiler::beginLoop()
+{
+    if constexpr ( ENABLED )
+    {
+        for ( size_t w = 0; w < numWorkers_; ++w )
+        {
+            slots_[w].loopBusyNanos = 0u;
+        }
+
+        loopStart_ = now();
+    }
+}
+
+
+void Profiler::endLoop()
+{
+    if constexpr ( ENABLED )
+    {
+        const uint64_t loopNanos = now() - loopStart_;
+
+        for ( size_t w = 0; w < numWorkers_; ++w )
+        {
+            Slot& slot = slots_[w];
+
+            slot.phaseNanos[static_cast< size_t >( Phase::QUEUE_WAIT )] += loopNanos - std::min( loopNanos, slot.loopBusyNanos );
+            slot.phaseCounts[static_cast< size_t >( Phase::QUEUE_WAIT )] += 1u;
+        }
+    }
+}
+
+
+void Profiler::setFitnessCacheStats( const uint64_t hits, const uint64_t misses )
+{
+    fitnessCacheHits_   = hits;
+    fitnessCacheMisses_ = misses;
+}
+
+
+uint64_t Profiler::getPhaseNanos( const Phase phase ) const
+{
+    return ENABLED ? sumPhases()[static_cast< size_t >( phase )] : 0u;
+}
+
+
+uint64_t Profiler::getPhaseNanos( const size_t slot, const Phase phase ) const
+{
+    return ENABLED ? slots_[slot].phaseNanos[static_cast< size_t >( phase )] : 0u;
+}
+
+
+uint64_t Profiler::getEvaluationCount() const
+{
+    uint64_t evaluations = 0u;
+
+    for ( const Slot& slot : slots_ )
+    {
+        evaluations += slot.evaluations;
+    }
+
+    return evaluations;
+}
+
+
+LatencyHistogram Profiler::getEvaluationLatency() const
+{
+    LatencyHistogram merged;
+
+    for ( const Slot& slot : slots_ )
+    {
+        merged.merge( slot.latency );
+    }
+
+    return merged;
+}
+
+
+std::array< uint64_t, Profiler::NUM_PHASES > Profiler::sumPhases() const
+{
+    std::array< uint64_t, NUM_PHASES > totals{};
+
+    for ( const Slot& slot : slots_ )
+    {
+        for ( size_t p = 0; p < NUM_PHASES; ++p )
+        {
+            totals[p] += slot.phaseNanos[p];
+        }
+    }
+
+    return totals;
+}
+
+
+const char* Profiler::getPhaseName( const Phase phase )
+{
+    switch ( phase )
+    {
+        case Phase::INITIALIZE:     return "initialize";
+        case Phase::UPDATE:         return "update";
+        case Phase::EVALUATE:       return "evaluate";
+        case Phase::SELECT:         return "select";
+        case Phase::BEST_REDUCTION: return "bestReduction";
+        case Phase::QUEUE_WAIT:     return "queueWait";
+        default:                    return "unknown";
+    }
+}
+
+
+void Profiler::printSummary( std::ostream& out ) const
+{
+    if constexpr ( !ENABLED )
+    {
+        out << "profiling compiled out (METAOPT_PROFILING=0)" << std::endl;
+        return;
+    }
+
+    out << "run                   : " << toSeconds( getRunNanos() ) << " sec, " << iterations_.size() << " iterations" << std::endl;
+
+    const std::array< uint64_t, NUM_PHASES > totals = sumPhases();
+
+    // Phase times are summed over threads, so with a pool they can exceed the run time
+    for ( size_t p = 0; p < NUM_PHASES; ++p )
+    {
+        const std::string name = getPhaseName( static_cast< Phase >( p ) );
+
+        out << name << std::string( name.size() < 22 ? 22 - name.size() : 0, ' ' ) << ": " << toSeconds( totals[p] ) << " sec" << std::endl;
+    }
+
+    const LatencyHistogram latency = getEvaluationLatency();
+
+    if ( latency.getCount() > 0 )
+    {
+        out << "evaluation latency    : p50 " << latency.percentile( 0.5 ) << " ns, p99 " << latency.percentile( 0.99 ) << " ns, max "
+            << latency.getMax() << " ns (" << latency.getCount() << " of " << getEvaluationCount() << " evaluations sampled)" << std::endl;
+    }
+
+    const uint64_t lookups = fitnessCacheHits_ + fitnessCacheMisses_;
+
+    if ( lookups > 0 )
+    {
+        out << "fitnessCache          : " << fitnessCacheHits_ << " hits, " << fitnessCacheMisses_ << " misses ("
+            << 100.0 * static_cast< double >( fitnessCacheHits_ ) / static_cast< double >( lookups ) << "% hit rate)" << std::endl;
+    }
+}
+
+
+void Profiler::printSummary() const
+{
+    printSummary( std::cout );
+}
+
+
+void Profiler::writeJson( std::ostream& out ) const
+{
+    if constexpr ( !ENABLED )
+    {
+        out << "{\"enabled\": false}" << std::endl;
+        return;
+    }
+
+    const LatencyHistogram latency = getEvaluationLatency();
+
+    out << "{\n";
+    out << "  \"enabled\": true,\n";
+    out << "  \"run\": {\"id\": " << runId_ << ", \"seconds\": " << toSeconds( getRunNanos() ) << ", \"iterations\": " << iterations_.size()
+        << ", \"evaluations\": " << getEvaluationCount() << "},\n";
+
+    out << "  \"phases\": ";
+    writePhases( out, sumPhases() );
+    out << ",\n";
+
+    out << "  \"evaluationLatencyNs\": {\"samples\": " << latency.getCount() << ", \"mean\": " << latency.getMean() << ", \"p50\": " << latency.percentile( 0.5 )
+        << ", \"p90\": " << latency.percentile( 0.9 ) << ", \"p99\": " << latency.percentile( 0.99 ) << ", \"max\": " << latency.getMax() << "},\n";
+
+    out << "  \"fitnessCache\": {\"hits\": " << fitnessCacheHits_ << ", \"misses\": " << fitnessCacheMisses_ << "},\n";
+
+    out << "  \"threads\": [\n";
+
+    for ( size_t s = 0; s < slots_.size(); ++s )
+    {
+        out << "    {\"slot\": " << s << ", \"name\": \"" << ( s == getMainSlot() ? "main" : "worker " + std::to_string( s ) ) << "\", \"evaluations\": "
+            << slots_[s].evaluations << ", \"phases\": ";
+        writePhases( out, slots_[s].phaseNanos );
+        out << "}" << ( s + 1 < slots_.size() ? "," : "" ) << "\n";
+    }
+
+    out << "  ],\n";
+
+    out << "  \"iterations\": [\n";
+
+    for ( size_t i = 0; i < iterations_.size(); ++i )
+    {
+        const IterationRecord& record = iterations_[i];
+
+        out << "    {\"iteration\": " << record.iteration << ", \"seconds\": " << toSeconds( record.duration ) << ", \"phases\": ";
+        writePhases( out, record.phaseNanos );
+        out << "}" << ( i + 1 < iterations_.size() ? "," : "" ) << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}" << std::endl;
+}
+
+
+bool Profiler::writeJson( const std::string& path ) const
+{
+    std::ofstream file( path );
+
+    if ( !file )
+    {
+        return false;
+    }
+
+    writeJson( file );
+
+    return static_cast< bool >( file );
+}
+
+
+void Profiler::writeChromeTrace( std::ostream& out ) const
+{
+    out << "{\"traceEvents\": [\n";
+
+    bool first = true;
+
+    auto separator = [&first]()
+    {
+        const char* sep = first ? "  " : ",\n  ";
+        first = false;
+        return sep;
+    };
+
+    if constexpr ( ENABLED )
+    {
+        for ( size_t s = 0; s < slots_.size(); ++s )
+        {
+            out << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << runId_ << ", \"tid\": " << s
+                << ", \"args\": {\"name\": \"" << ( s == getMainSlot() ? "main" : "worker " + std::to_string( s ) ) << "\"}}";
+        }
+
+        for ( const IterationRecord& record : iterations_ )
+        {
+            out << separator() << "{\"name\": \"iteration " << record.iteration << "\", \"cat\": \"iteration\", \"ph\": \"X\", \"pid\": " << runId_
+                << ", \"tid\": " << getMainSlot() << ", \"ts\": " << toMicroseconds( record.start - runStart_ )
+                << ", \"dur\": " << toMicroseconds( record.duration ) << "}";
+        }
+
+        for ( size_t s = 0; s < slots_.size(); ++s )
+        {
+            for ( const TraceEvent& event : slots_[s].events )
+            {
+                out << separator() << "{\"name\": \"" << getPhaseName( event.phase ) << "\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": " << runId_
+                    << ", \"tid\": " << s << ", \"ts\": " << toMicroseconds( event.start - runStart_ ) << ", \"dur\": " << toMicroseconds( event.duration ) << "}";
+            }
+        }
+    }
+
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+
+bool Profiler::writeChromeTrace( const std::string& path ) const
+{
+    std::ofstream file( path );
+
+    if ( !file )
+    {
+        return false;
+    }
+
+    writeChromeTrace( file );
+
+    return static_cast< bool >( file );
+}
+
+} // namespace MetaOpt
@@ -0,0 +1,342 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+// Set to 0 (CMake option METAOPT_PROFILING=OFF) to compile every probe down to nothing
+#ifndef METAOPT_PROFILING
+#define METAOPT_PROFILING 1
+#endif
+
+
+namespace MetaOpt
+{
+
+// Log-linear histogram of durations in nanoseconds: exact below 32 ns, then 16 buckets per power of two, so any
+// reported percentile is within about 6% of the true value. Fixed size, no allocation when recording.
+class LatencyHistogram
+{
+public:
+
+    static constexpr size_t SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS     = size_t{ 1 } << SUB_BUCKET_BITS;
+    static constexpr size_t LINEAR_LIMIT    = 2 * SUB_BUCKETS;
+    static constexpr size_t NUM_BUCKETS     = LINEAR_LIMIT + ( 64 - SUB_BUCKET_BITS - 1 ) * SUB_BUCKETS;
+
+
+    LatencyHistogram();
+
+
+    // Adds count samples of nanos each
+    inline void record( const uint64_t nanos, const uint64_t count = 1u )
+    {
+        buckets_[bucketOf( nanos )] += count;
+        count_ += count;
+        sum_   += nanos * count;
+        max_    = nanos > max_ ? nanos : max_;
+    }
+
+
+    void merge( const LatencyHistogram& other );
+
+    void reset();
+
+
+    // Midpoint of the bucket holding the given quantile in [0, 1]; 0 when empty
+    uint64_t percentile( const double quantile ) const;
+
+    uint64_t getCount() const { return count_; }
+    uint64_t getMax() const { return max_; }
+    double getMean() const { return count_ > 0 ? static_cast< double >( sum_ ) / static_cast< double >( count_ ) : 0.0; }
+
+
+private:
+
+    static inline size_t bucketOf( const uint64_t nanos )
+    {
+        if ( nanos < LINEAR_LIMIT )
+        {
+            return static_cast< size_t >( nanos );
+        }
+
+        const size_t exponent = std::bit_width( nanos ) - 1;
+        const size_t sub      = static_cast< size_t >( nanos >> ( exponent - SUB_BUCKET_BITS ) ) & ( SUB_BUCKETS - 1 );
+
+        return LINEAR_LIMIT + ( exponent - SUB_BUCKET_BITS - 1 ) * SUB_BUCKETS + sub;
+    }
+
+
+    std::array< uint64_t, NUM_BUCKETS > buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+
+}; // class LatencyHistogram
+
+
+
+// Per-optimizer profiler. Phase time is accumulated per thread slot (one per pool worker plus one for the
+// thread driving the run) without synchronization: every slot has a single writer, and the slots are only read
+// after the thread pool's loop barrier. Totals are kept per run and per iteration; timestamped events for the
+// Chrome trace are only recorded when tracing is switched on.
+class Profiler
+{
+public:
+
+    static constexpr bool ENABLED = METAOPT_PROFILING;
+
+    enum class Phase : uint8_t
+    {
+        INITIALIZE,
+        UPDATE,
+        EVALUATE,
+        SELECT,
+        BEST_REDUCTION,
+        QUEUE_WAIT,         // Time a worker sat idle at the end of a parallel loop
+        NUM_PHASES
+    };
+
+    static constexpr size_t NUM_PHASES = static_cast< size_t >( Phase::NUM_PHASES );
+
+    // A clock read costs tens of nanoseconds, so by default only every 32nd single evaluation is timed
+    static constexpr uint32_t DEFAULT_LATENCY_SAMPLE_INTERVAL = 32;
+
+
+    // Adds the time between construction and destruction to a phase of one slot
+    class Scope
+    {
+    public:
+
+        inline Scope( Profiler& profiler, const Phase phase, const size_t slot )
+            : profiler_{ profiler }
+            , phase_{ phase }
+            , slot_{ slot }
+            , start_{ Profiler::now() }
+        {
+        }
+
+        inline ~Scope()
+        {
+            profiler_.addPhase( slot_, phase_, start_, Profiler::now() );
+        }
+
+    private:
+
+        Profiler& profiler_;
+        Phase phase_;
+        size_t slot_;
+        uint64_t start_;
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+    };
+
+
+    explicit Profiler( const size_t numWorkers );
+
+    ~Profiler() = default;
+
+
+    // Nanoseconds on the steady clock, or 0 when profiling is compiled out
+    static inline uint64_t now()
+    {
+        if constexpr ( ENABLED )
+        {
+            return static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+        }
+        else
+        {
+            return 0u;
+        }
+    }
+
+
+    // Slot of the thread that drives the run, as opposed to the pool workers
+    size_t getMainSlot() const { return numWorkers_; }
+
+    size_t getNumWorkers() const { return numWorkers_; }
+
+
+    // Timestamped events are needed for writeChromeTrace only, and cost memory per phase entered
+    void setTraceEnabled( const bool enabled ) { traceEnabled_ = enabled; }
+
+    bool isTraceEnabled() const { return traceEnabled_; }
+
+
+    // Every interval-th evaluation of a slot goes into the latency histogram; 1 times all of them
+    void setLatencySampleInterval( const uint32_t interval ) { latencySampleInterval_ = interval > 0 ? interval : 1u; }
+
+    uint32_t getLatencySampleInterval() const { return latencySampleInterval_; }
+
+
+    void beginRun();
+    void endRun();
+
+    void beginIteration( const uint64_t iteration );
+    void endIteration();
+
+
+    inline void addPhase( const size_t slot, const Phase phase, const uint64_t start, const uint64_t stop )
+    {
+        if constexpr ( ENABLED )
+        {
+            Slot& s = slots_[slot];
+
+            s.phaseNanos[static_cast< size_t >( phase )] += stop - start;
+            s.phaseCounts[static_cast< size_t >( phase )] += 1u;
+            s.loopBusyNanos += stop - start;
+
+            if ( traceEnabled_ )
+            {
+                s.events.push_back( { start, stop - start, phase } );
+            }
+        }
+    }
+
+
+    // Counts one evaluation and tells whether to time it
+    inline bool sampleEvaluation( const size_t slot )
+    {
+        if constexpr ( ENABLED )
+        {
+            Slot& s = slots_[slot];
+
+            ++s.evaluations;
+
+            if ( ++s.sinceSample >= latencySampleInterval_ )
+            {
+                s.sinceSample = 0u;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    inline void recordLatency( const size_t slot, const uint64_t nanos )
+    {
+        if constexpr ( ENABLED )
+        {
+            slots_[slot].latency.record( nanos );
+        }
+    }
+
+
+    // Counts a batch of evaluations that took nanos together; each goes into the histogram at the mean latency
+    inline void recordBatch( const size_t slot, const uint64_t nanos, const size_t count )
+    {
+        if constexpr ( ENABLED )
+        {
+            if ( count > 0 )
+            {
+                slots_[slot].evaluations += count;
+                slots_[slot].latency.record( nanos / count, count );
+            }
+        }
+    }
+
+
+    // Brackets one parallel loop: afterwards every worker's idle share of the loop is booked as QUEUE_WAIT
+    void beginLoop();
+    void endLoop();
+
+
+    void setFitnessCacheStats( const uint64_t hits, const uint64_t misses );
+
+
+    uint64_t getPhaseNanos( const Phase phase ) const;
+    uint64_t getPhaseNanos( const size_t slot, const Phase phase ) const;
+    uint64_t getRunNanos() const { return runStop_ - runStart_; }
+
+    uint64_t getEvaluationCount() const;
+
+    // Sampled evaluation latencies merged over all slots
+    LatencyHistogram getEvaluationLatency() const;
+
+
+    void printSummary( std::ostream& out ) const;
+    void printSummary() const;
+
+    // Totals, per-thread and per-iteration breakdowns and latency percentiles of the last run
+    void writeJson( std::ostream& out ) const;
+    bool writeJson( const std::string& path ) const;
+
+    // Trace-event format, loadable in chrome://tracing and Perfetto. Needs setTraceEnabled( true ) before the run.
+    void writeChromeTrace( std::ostream& out ) const;
+    bool writeChromeTrace( const std::string& path ) const;
+
+
+    static const char* getPhaseName( const Phase phase );
+
+
+private:
+
+    struct TraceEvent
+    {
+        uint64_t start;
+        uint64_t duration;
+        Phase phase;
+    };
+
+    struct alignas( 64 ) Slot
+    {
+        std::array< uint64_t, NUM_PHASES > phaseNanos{};
+        std::array< uint64_t, NUM_PHASES > phaseCounts{};
+        uint64_t loopBusyNanos = 0u;
+
+        uint64_t evaluations = 0u;
+        uint32_t sinceSample = 0u;
+        LatencyHistogram latency;
+
+        std::vector< TraceEvent > events;
+    };
+
+    struct IterationRecord
+    {
+        uint64_t iteration;
+        uint64_t start;
+        uint64_t duration;
+        std::array< uint64_t, NUM_PHASES > phaseNanos;
+    };
+
+
+    std::array< uint64_t, NUM_PHASES > sumPhases() const;
+
+
+    size_t numWorkers_;
+    std::vector< Slot > slots_;
+
+    bool traceEnabled_;
+    uint32_t latencySampleInterval_;
+
+    uint64_t runId_;
+    uint64_t runStart_;
+    uint64_t runStop_;
+
+    uint64_t loopStart_;
+
+    std::vector< IterationRecord > iterations_;
+    std::array< uint64_t, NUM_PHASES > iterationBaseline_;
+
+    uint64_t fitnessCacheHits_;
+    uint64_t fitnessCacheMisses_;
+
+
+    Profiler() = delete;
+    Profiler( const Profiler& ) = delete;
+    Profiler& operator=( const Profiler& ) = delete;
+
+}; // class Profiler
+
+} // namespace MetaOpt
+
+#endif // PROFILER_H
@@ -2,127 +2,325 @@
 #define RNG_H
 
 #include <algorithm>
-#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <limits>
+#include <numbers>
 #include <stdexcept>
-#include <random>
-#include <mutex>
-#include <numeric>
+#include <type_traits>
+#include <utility>
+
+#include "Philox.h"
+#include "Sampling.h"
 
 
 
 namespace MetaOpt
 {
 
-template< typename __GENERATOR = std::mt19937 >
+// Single random stream. Instances are not shared between threads: every particle owns its own stream derived
+// from the run seed, so no locking is needed and results do not depend on how work is scheduled.
+// The generator must be splittable, i.e. provide seed( seed, stream ).
+template< typename __GENERATOR = Philox4x32 >
 class Rng
 {
 public:
 
     using generator_t = __GENERATOR;
 
+    static_assert( sizeof( typename generator_t::result_type ) == sizeof( uint64_t ), "Samplers consume 64 random bits per draw" );
 
-    ~Rng() = default;
+    // Raw draws converted per bulk call in one pass
+    static constexpr size_t BULK_CHUNK = 64;
 
 
-    static Rng* getInstance()
+    Rng()
+        : generator_{}
     {
-        static Rng instance;
-        return &instance;
     }
 
 
-    void setSeed( const uint64_t seed )
+    explicit Rng( const uint64_t seed, const uint64_t stream = 0u )
+        : generator_{ seed, stream }
     {
-        generator_.seed( seed );
     }
 
 
-    template< typename float_t >
-    inline float_t drawUniform( const float_t lowerBound = static_cast< float_t >( 0 ), const float_t upperBound = static_cast< float_t >( 1 ) )
+    ~Rng() = default;
+
+    Rng( const Rng& ) = default;
+    Rng& operator=( const Rng& ) = default;
+
+
+    void seed( const uint64_t seed, const uint64_t stream = 0u )
     {
-        std::uniform_real_distribution< float_t > realDistribution_{ lowerBound, upperBound };
+        generator_.seed( seed, stream );
+    }
+
+
+    generator_t& getGenerator() { return generator_; }
+    const generator_t& getGenerator() const { return generator_; }
 
-        std::lock_guard< std::mutex > lock( mutex_ );
 
-        return realDistribution_( generator_ );
+    // Uniform in [lowerBound, upperBound)
+    template< typename float_t >
+    inline float_t drawUniform( const float_t lowerBound = static_cast< float_t >( 0 ), const float_t upperBound = static_cast< float_t >( 1 ) )
+    {
+        return lowerBound + ( upperBound - lowerBound ) * unitInterval< float_t >( generator_() );
     }
 
 
     template< typename float_t, size_t N >
     inline void drawUniform( float_t ( &out )[N], const float_t lowerBound = static_cast< float_t >( 0 ), const float_t upperBound = static_cast< float_t >( 1 ) )
     {
-        std::uniform_real_distribution< float_t > realDistribution_{ lowerBound, upperBound };
+        fillUniform( out, N, lowerBound, upperBound );
+    }
 
-        std::lock_guard< std::mutex > lock( mutex_ );
 
-        for ( size_t i = 0; i < N; ++i )
+    // Same values as count calls to drawUniform, generated in blocks and converted in a vectorizable loop
+    template< typename float_t >
+    inline void fillUniform( float_t* out, const size_t count, const float_t lowerBound = static_cast< float_t >( 0 ), const float_t upperBound = static_cast< float_t >( 1 ) )
+    {
+        const float_t scale = upperBound - lowerBound;
+
+        uint64_t bits[BULK_CHUNK];
+
+        for ( size_t begin = 0; begin < count; begin += BULK_CHUNK )
         {
-            out[i] = realDistribution_( generator_ );
+            const size_t n = std::min( BULK_CHUNK, count - begin );
+
+            drawBits( bits, n );
+
+            for ( size_t i = 0; i < n; ++i )
+            {
+                out[begin + i] = lowerBound + scale * unitInterval< float_t >( bits[i] );
+            }
         }
     }
 
 
+    // Uniform in [lowerBound, upperBound], unbiased (Lemire's multiply-shift with rejection)
     template< typename int_t >
     inline int_t drawUniformInt( const int_t lowerBound, const int_t upperBound )
     {
-        std::uniform_int_distribution< int_t > intDistribution_{ lowerBound, upperBound };
+        const uint64_t span = static_cast< uint64_t >( upperBound ) - static_cast< uint64_t >( lowerBound );
 
-        std::lock_guard< std::mutex > lock( mutex_ );
+        if ( span == std::numeric_limits< uint64_t >::max() )
+        {
+            return static_cast< int_t >( generator_() );
+        }
+
+        return static_cast< int_t >( static_cast< uint64_t >( lowerBound ) + drawBelow( span + 1u ) );
+    }
 
-        return intDistribution_( generator_ );
+
+    // Standard normal scaled to N( mean, stddev^2 ), by the Ziggurat method: one table lookup and one
+    // multiply in about 99% of the draws
+    template< typename float_t >
+    inline float_t drawNormal( const float_t mean = static_cast< float_t >( 0 ), const float_t stddev = static_cast< float_t >( 1 ) )
+    {
+        return mean + stddev * static_cast< float_t >( drawStandardNormal() );
+    }
+
+
+    template< typename float_t >
+    inline void fillNormal( float_t* out, const size_t count, const float_t mean = static_cast< float_t >( 0 ), const float_t stddev = static_cast< float_t >( 1 ) )
+    {
+        for ( size_t i = 0; i < count; ++i )
+        {
+            out[i] = mean + stddev * static_cast< float_t >( drawStandardNormal() );
+        }
+    }
+
+
+    template< typename float_t >
+    inline float_t drawCauchy( const float_t location = static_cast< float_t >( 0 ), const float_t scale = static_cast< float_t >( 1 ) )
+    {
+        return location + scale * static_cast< float_t >( std::tan( std::numbers::pi * ( unitInterval< double >( generator_() ) - 0.5 ) ) );
+    }
+
+
+    // Lévy-stable step by Mantegna's algorithm
+    template< typename float_t >
+    inline float_t drawLevy( const MantegnaLevy& levy )
+    {
+        const double u = levy.getSigmaU() * drawStandardNormal();
+        const double v = drawStandardNormal();
+
+        return static_cast< float_t >( u / std::pow( std::abs( v ), levy.getInvBeta() ) );
+    }
+
+
+    // Draws the normals of a block of BULK_CHUNK steps first, all numerators then all denominators, and turns them
+    // into steps in a separate branch-free pass. The values differ from count calls to drawLevy.
+    template< typename float_t >
+    inline void fillLevy( float_t* out, const size_t count, const MantegnaLevy& levy )
+    {
+        const double sigmaU  = levy.getSigmaU();
+        const double invBeta = levy.getInvBeta();
+
+        double numerators[BULK_CHUNK];
+        double denominators[BULK_CHUNK];
+
+        for ( size_t begin = 0; begin < count; begin += BULK_CHUNK )
+        {
+            const size_t n = std::min( BULK_CHUNK, count - begin );
+
+            for ( size_t i = 0; i < n; ++i )
+            {
+                numerators[i] = drawStandardNormal();
+            }
+
+            for ( size_t i = 0; i < n; ++i )
+            {
+                denominators[i] = drawStandardNormal();
+            }
+
+            for ( size_t i = 0; i < n; ++i )
+            {
+                out[begin + i] = static_cast< float_t >( sigmaU * numerators[i] * std::pow( std::abs( denominators[i] ), -invBeta ) );
+            }
+        }
     }
 
 
     template< size_t N >
-    void choice( uint ( &out)[N], const uint upperBound, const bool replace = false )
+    void choice( uint ( &out )[N], const uint upperBound, const bool replace = false )
     {
-        std::uniform_int_distribution< uint > intDistribution_{ 0, upperBound - 1 };
+        choice( out, N, upperBound, replace );
+    }
 
-        std::lock_guard< std::mutex > lock( mutex_ );
 
+    // count indices in [0, upperBound). Without replacement this is Floyd's algorithm followed by a shuffle of the
+    // picks, so every ordered selection is equally likely. Cost is O(count^2) whatever upperBound is, meant for the
+    // handful of indices the variation operators need.
+    void choice( uint* out, const size_t count, const uint upperBound, const bool replace = false )
+    {
         if ( replace )
         {
-            for ( size_t i = 0; i < N; i++ )
+            for ( size_t i = 0; i < count; ++i )
             {
-                out[i] = intDistribution_( generator_ );
+                out[i] = static_cast< uint >( drawBelow( upperBound ) );
             }
+
+            return;
+        }
+
+        if ( count > upperBound )
+        {
+            throw std::invalid_argument( "Rng::choice: N must be less than or equal to upperBound" );
+        }
+
+        for ( size_t k = 0; k < count; ++k )
+        {
+            const uint candidate = static_cast< uint >( upperBound - count + k );
+            const uint pick      = static_cast< uint >( drawBelow( static_cast< uint64_t >( candidate ) + 1u ) );
+
+            out[k] = std::find( out, out + k, pick ) != out + k ? candidate : pick;
+        }
+
+        for ( size_t k = count; k > 1; --k )
+        {
+            std::swap( out[k - 1], out[drawBelow( k )] );
+        }
+    }
+
+
+private:
+
+    inline void drawBits( uint64_t* bits, const size_t count )
+    {
+        if constexpr ( requires { generator_.fill( bits, count ); } )
+        {
+            generator_.fill( bits, count );
         }
         else
         {
-            if ( N > upperBound )
+            for ( size_t i = 0; i < count; ++i )
             {
-                throw std::invalid_argument( "Rng::choice: N must be less than or equal to upperBound" );
+                bits[i] = generator_();
             }
+        }
+    }
+
 
-            uint choices[upperBound];
-            std::iota( choices, choices + upperBound, 0u );
-            
-            std::shuffle( choices, choices + upperBound, generator_ );
+    // Uniform in [0, bound), bound > 0
+    inline uint64_t drawBelow( const uint64_t bound )
+    {
+        unsigned __int128 product = static_cast< unsigned __int128 >( generator_() ) * bound;
+        uint64_t low = static_cast< uint64_t >( product );
+
+        if ( low < bound )
+        {
+            const uint64_t threshold = ( 0u - bound ) % bound;
 
-            std::memcpy( out, choices, N * sizeof( uint ) );
+            while ( low < threshold )
+            {
+                product = static_cast< unsigned __int128 >( generator_() ) * bound;
+                low     = static_cast< uint64_t >( product );
+            }
         }
+
+        return static_cast< uint64_t >( product >> 64 );
     }
 
 
-private:
+    inline double drawStandardNormal()
+    {
+        const ZigguratTables& tables = ZigguratTables::get();
 
+        while ( true )
+        {
+            // The low bits pick the layer, the high bits the position in it
+            const uint64_t bits  = generator_();
+            const size_t   layer = bits & ( ZigguratTables::NUM_LAYERS - 1 );
+            const double   u     = 2.0 * unitInterval< double >( bits ) - 1.0;
 
-    Rng()
-        : generator_{ 0 }
-        , mutex_{}
-    {
+            if ( std::abs( u ) < tables.ratio[layer] )
+            {
+                return u * tables.x[layer];
+            }
+
+            if ( layer == 0 )
+            {
+                return drawNormalTail( u < 0.0 );
+            }
+
+            const double x  = u * tables.x[layer];
+            const double f0 = std::exp( -0.5 * ( tables.x[layer] * tables.x[layer] - x * x ) );
+            const double f1 = std::exp( -0.5 * ( tables.x[layer + 1] * tables.x[layer + 1] - x * x ) );
+
+            if ( f1 + unitInterval< double >( generator_() ) * ( f0 - f1 ) < 1.0 )
+            {
+                return x;
+            }
+        }
     }
 
-    generator_t generator_;
 
-    std::mutex mutex_;
+    // Beyond R, sampled with Marsaglia's exponential rejection
+    inline double drawNormalTail( const bool negative )
+    {
+        double x;
+        double y;
 
-    Rng( const Rng& ) = delete;
-    Rng& operator=( const Rng& ) = delete;
+        do
+        {
+            x = std::log( 1.0 - unitInterval< double >( generator_() ) ) / ZigguratTables::R;
+            y = std::log( 1.0 - unitInterval< double >( generator_() ) );
+        }
+        while ( -2.0 * y < x * x );
+
+        return negative ? x - ZigguratTables::R : ZigguratTables::R - x;
+    }
+
+
+    generator_t generator_;
 
 }; // class Rng
 
 } // namespace MetaOpt
 
-#endif // RNG_H
\ No newline at end of file
+#endif // RNG_H
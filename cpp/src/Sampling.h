@@ -0,0 +1,123 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace MetaOpt
+{
+
+// Maps 64 random bits to [0, 1) by filling the mantissa of a number in [1, 2). Branch free and plain integer
+// arithmetic, so loops over whole buffers vectorize.
+template< typename float_t >
+inline float_t unitInterval( const uint64_t bits )
+{
+    static_assert( std::is_floating_point_v< float_t >, "Uniform draws need a floating point type" );
+
+    if constexpr ( std::is_same_v< float_t, double > )
+    {
+        return std::bit_cast< double >( ( bits >> 12 ) | 0x3FF0000000000000ull ) - 1.0;
+    }
+    else if constexpr ( std::is_same_v< float_t, float > )
+    {
+        return std::bit_cast< float >( static_cast< uint32_t >( bits >> 41 ) | 0x3F800000u ) - 1.0f;
+    }
+    else
+    {
+        return static_cast< float_t >( bits >> 11 ) * static_cast< float_t >( 0x1.0p-53 );
+    }
+}
+
+
+
+// Layer boundaries of the 128-layer Ziggurat for the standard normal (Marsaglia and Tsang 2000, in the
+// formulation of Doornik 2005). Built once on first use.
+struct ZigguratTables
+{
+    static constexpr size_t NUM_LAYERS = 128;
+    static constexpr double R          = 3.442619855899;           // Start of the tail
+    static constexpr double V          = 9.91256303526217e-3;      // Area of every layer
+
+
+    ZigguratTables()
+    {
+        double f = std::exp( -0.5 * R * R );
+
+        x[0] = V / f;
+        x[1] = R;
+        x[NUM_LAYERS] = 0.0;
+
+        for ( size_t i = 2; i < NUM_LAYERS; ++i )
+        {
+            x[i] = std::sqrt( -2.0 * std::log( V / x[i - 1] + f ) );
+            f    = std::exp( -0.5 * x[i] * x[i] );
+        }
+
+        for ( size_t i = 0; i < NUM_LAYERS; ++i )
+        {
+            ratio[i] = x[i + 1] / x[i];
+        }
+    }
+
+
+    static const ZigguratTables& get()
+    {
+        static const ZigguratTables tables;
+        return tables;
+    }
+
+
+    double x[NUM_LAYERS + 1];
+    double ratio[NUM_LAYERS];
+};
+
+
+
+// Parameters of Mantegna's algorithm for Lévy-stable steps of index beta in (0, 2]: step = u / |v|^( 1 / beta )
+// with u ~ N( 0, sigmaU^2 ) and v ~ N( 0, 1 ). sigmaU involves gamma functions, so it is computed once here.
+class MantegnaLevy
+{
+public:
+
+    static constexpr double DEFAULT_BETA = 1.5;
+
+
+    explicit MantegnaLevy( const double beta = DEFAULT_BETA )
+        : beta_{ beta }
+        , invBeta_{ 1.0 / beta }
+        , sigmaU_{ 0.0 }
+    {
+        if ( !( beta > 0.0 && beta <= 2.0 ) )
+        {
+            throw std::invalid_argument( "MantegnaLevy::MantegnaLevy: beta must be in (0, 2]" );
+        }
+
+        const double numerator   = std::tgamma( 1.0 + beta ) * std::sin( std::numbers::pi * beta / 2.0 );
+        const double denominator = std::tgamma( ( 1.0 + beta ) / 2.0 ) * beta * std::pow( 2.0, ( beta - 1.0 ) / 2.0 );
+
+        sigmaU_ = std::pow( numerator / denominator, invBeta_ );
+    }
+
+
+    double getBeta() const { return beta_; }
+    double getInvBeta() const { return invBeta_; }
+    double getSigmaU() const { return sigmaU_; }
+
+
+private:
+
+    double beta_;
+    double invBeta_;
+    double sigmaU_;
+
+}; // class MantegnaLevy
+
+} // namespace MetaOpt
+
+#endif // SAMPLING_H
@@ -0,0 +1,61 @@
+#include "SharedMemory.h"
+
+#include <atomic>
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace MetaOpt
+{
+
+SharedMemory::SharedMemory( const size_t size )
+    : data_{ nullptr }
+    , size_{ size }
+    , fd_{ -1 }
+{
+    static std::atomic< uint64_t > counter{ 0u };
+
+    const std::string name = "/metaopt-" + std::to_string( getpid() ) + "-" + std::to_string( counter.fetch_add( 1u ) );
+
+    fd_ = shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR );
+
+    if ( fd_ < 0 )
+    {
+        throw std::system_error( errno, std::generic_category(), "SharedMemory::SharedMemory: cannot create " + name );
+    }
+
+    shm_unlink( name.c_str() );
+
+    if ( ftruncate( fd_, static_cast< off_t >( size_ ) ) != 0 )
+    {
+        const int error = errno;
+        close( fd_ );
+        throw std::system_error( error, std::generic_category(), "SharedMemory::SharedMemory: cannot size " + name );
+    }
+
+    void* mapping = mmap( nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+
+    if ( mapping == MAP_FAILED )
+    {
+        const int error = errno;
+        close( fd_ );
+        throw std::system_error( error, std::generic_category(), "SharedMemory::SharedMemory: cannot map " + name );
+    }
+
+    data_ = static_cast< std::byte* >( mapping );
+}
+
+
+SharedMemory::~SharedMemory()
+{
+    munmap( data_, size_ );
+    close( fd_ );
+}
+
+} // namespace MetaOpt
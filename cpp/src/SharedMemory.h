@@ -0,0 +1,46 @@
+#ifndef SHARED_MEMORY_H
+#define SHARED_MEMORY_H
+
+#include <cstddef>
+
+
+namespace MetaOpt
+{
+
+// Zero-filled POSIX shared memory segment, mapped read-write. Its name is unlinked right after mapping, so
+// only this process, the children it forks afterwards and programs given its descriptor can reach it, and
+// nothing is left behind when they exit or crash.
+class SharedMemory
+{
+public:
+
+    explicit SharedMemory( const size_t size );
+
+    ~SharedMemory();
+
+
+    std::byte* data() { return data_; }
+    const std::byte* data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    // Close-on-exec descriptor of the segment, e.g. to dup2 into a program that maps it itself
+    int getFd() const { return fd_; }
+
+
+private:
+
+    std::byte* data_;
+    size_t size_;
+    int fd_;
+
+
+    SharedMemory() = delete;
+    SharedMemory( const SharedMemory& ) = delete;
+    SharedMemory& operator=( const SharedMemory& ) = delete;
+
+}; // class SharedMemory
+
+} // namespace MetaOpt
+
+#endif // SHARED_MEMORY_H
@@ -0,0 +1,496 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Uniform grid over a population for fixed-radius neighbour queries. Cells are cubes as wide as the query radius,
+// laid over the first MAX_GRID_DIMS parameters only: a neighbour always lies in one of the 3^G cells around the
+// query point in that projection, and candidates are then checked on the full distance. The cells are kept as one
+// array of (cell key, particle) entries sorted by key, so a cell is a contiguous range. When there are not many more
+// cells than points, the start of every cell is tabulated; otherwise cells are found by binary search.
+//
+// rebuild() takes a forEach( count, func ) that runs func( begin, end, worker ) over [0, count), usually on a thread
+// pool. Cell keys are computed in parallel; when few particles changed cell since the last rebuild, only those are
+// taken out, sorted and merged back, otherwise the entries are sorted in parallel chunks. Either way the entries
+// end up in the same order, so queries do not depend on the number of threads.
+template< typename __PARAM_T = double >
+class SpatialGrid
+{
+public:
+
+    using param_t = __PARAM_T;
+
+
+    static constexpr size_t   MAX_GRID_DIMS         = 3;
+    static constexpr uint32_t MAX_CELLS             = 1u << 21;     // Per dimension, so that keys fit 64 bits
+    static constexpr size_t   SORT_CHUNKS           = 16;
+    static constexpr size_t   TABLE_CELLS_PER_POINT = 4;
+
+
+    // Constructor
+    SpatialGrid()
+        : positions_{ nullptr }
+        , numPoints_{ 0u }
+        , numParams_{ 0u }
+        , gridDims_{ 0u }
+        , cellSize_{ 0 }
+        , origin_{}
+        , numCells_{}
+        , strides_{}
+        , numGridCells_{ 0u }
+        , keys_{}
+        , newKeys_{}
+        , entries_{}
+        , moved_{}
+        , merged_{}
+        , cellStarts_{}
+        , numMoved_{ 0u }
+    {
+    }
+
+
+    // Indexes count rows of numParams parameters, which must stay in place until the next rebuild. The grid covers
+    // [lowerBound, upperBound] in cells of cellSize; points outside fall in the border cells.
+    template< typename ForEach >
+    void rebuild( const param_t* positions, const size_t count, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                  const param_t cellSize, ForEach&& forEach )
+    {
+        const size_t gridDims = std::min( numParams, MAX_GRID_DIMS );
+
+        bool relaid = count != numPoints_ || numParams != numParams_ || cellSize != cellSize_;
+
+        numGridCells_ = 1u;
+
+        for ( size_t k = 0; k < gridDims; ++k )
+        {
+            const param_t width     = std::ceil( ( upperBound[k] - lowerBound[k] ) / cellSize );
+            const uint32_t numCells = width < 1 ? 1u : static_cast< uint32_t >( std::min< param_t >( width, MAX_CELLS ) );
+
+            relaid = relaid || origin_[k] != lowerBound[k] || numCells_[k] != numCells;
+
+            origin_[k]    = lowerBound[k];
+            numCells_[k]  = numCells;
+            strides_[k]   = numGridCells_;
+            numGridCells_ *= numCells;
+        }
+
+        positions_ = positions;
+        numPoints_ = count;
+        numParams_ = numParams;
+        gridDims_  = gridDims;
+        cellSize_  = cellSize;
+
+        newKeys_.resize( count );
+
+        forEach( count, [this]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                newKeys_[i] = cellKey( positions_ + i * numParams_ );
+            }
+        } );
+
+        if ( relaid || keys_.size() != count )
+        {
+            keys_.swap( newKeys_ );
+            numMoved_ = count;
+            sortAll( forEach );
+            tabulateCells();
+            return;
+        }
+
+        moved_.clear();
+
+        for ( size_t i = 0; i < count; ++i )
+        {
+            if ( newKeys_[i] != keys_[i] )
+            {
+                moved_.push_back( Entry{ newKeys_[i], static_cast< uint32_t >( i ) } );
+            }
+        }
+
+        keys_.swap( newKeys_ );
+        numMoved_ = moved_.size();
+
+        if ( 4 * moved_.size() > count )
+        {
+            sortAll( forEach );
+            tabulateCells();
+            return;
+        }
+
+        // Entries whose particle left their cell go, the moved ones are merged back at their new cells
+        std::erase_if( entries_, [this]( const Entry& entry ) { return entry.key != keys_[entry.particle]; } );
+
+        std::sort( moved_.begin(), moved_.end() );
+
+        merged_.resize( count );
+        std::merge( entries_.begin(), entries_.end(), moved_.begin(), moved_.end(), merged_.begin() );
+        entries_.swap( merged_ );
+
+        tabulateCells();
+    }
+
+
+    // Calls func( j, squaredDistance ) for every indexed point j within the cell size of point, point included if
+    // indexed. Thread safe between rebuilds.
+    template< typename Func >
+    void forEachNeighbour( const param_t* point, Func&& func ) const
+    {
+        uint32_t cell[MAX_GRID_DIMS];
+        cellOf( point, cell );
+
+        const param_t radius2 = cellSize_ * cellSize_;
+
+        uint32_t low[MAX_GRID_DIMS];
+        uint32_t high[MAX_GRID_DIMS];
+
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            low[k]  = cell[k] > 0 ? cell[k] - 1 : 0u;
+            high[k] = std::min( cell[k] + 1, numCells_[k] - 1 );
+        }
+
+        forEachCell( low, high, [&]( const uint64_t key, const uint32_t* )
+        {
+            scanCell( key, point, radius2, func );
+        } );
+    }
+
+
+    // Nearest indexed point to point and its squared distance, searched ring by ring of cells around it until no
+    // closer point can remain. Once the rings have covered more cells than there are points, all points are scanned
+    // instead. Ties go to the lower index. Returns getNumPoints() when the grid is empty.
+    size_t nearest( const param_t* point, param_t& distance2 ) const
+    {
+        uint32_t cell[MAX_GRID_DIMS];
+        cellOf( point, cell );
+
+        uint32_t maxRing = 0u;
+
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            maxRing = std::max( maxRing, std::max( cell[k], numCells_[k] - 1 - cell[k] ) );
+        }
+
+        size_t best      = numPoints_;
+        param_t bestDist = std::numeric_limits< param_t >::infinity();
+
+        size_t visited = 0u;
+
+        for ( uint32_t ring = 0; ring <= maxRing; ++ring )
+        {
+            // Points in ring r are at least r - 1 cells away in the projection, so at least that far in full
+            if ( ring > 1 && static_cast< param_t >( ring - 1 ) * cellSize_ * static_cast< param_t >( ring - 1 ) * cellSize_ >= bestDist )
+            {
+                break;
+            }
+
+            uint32_t low[MAX_GRID_DIMS];
+            uint32_t high[MAX_GRID_DIMS];
+
+            for ( size_t k = 0; k < gridDims_; ++k )
+            {
+                low[k]  = cell[k] >= ring ? cell[k] - ring : 0u;
+                high[k] = std::min( cell[k] + ring, numCells_[k] - 1 );
+            }
+
+            size_t boxCells = 1u;
+
+            for ( size_t k = 0; k < gridDims_; ++k )
+            {
+                boxCells *= high[k] - low[k] + 1;
+            }
+
+            visited += boxCells;
+
+            if ( visited > numPoints_ && ring > 1 )
+            {
+                for ( size_t j = 0; j < numPoints_; ++j )
+                {
+                    const param_t dist = squaredDistance( point, positions_ + j * numParams_, numParams_ );
+
+                    if ( dist < bestDist || ( dist == bestDist && j < best ) )
+                    {
+                        best     = j;
+                        bestDist = dist;
+                    }
+                }
+
+                break;
+            }
+
+            forEachCell( low, high, [&]( const uint64_t key, const uint32_t* other )
+            {
+                // Only the shell of the ring, inner cells were scanned before
+                if ( ringOf( other, cell ) != ring )
+                {
+                    return;
+                }
+
+                scanCell( key, point, std::numeric_limits< param_t >::infinity(), [&]( const size_t j, const param_t dist )
+                {
+                    if ( dist < bestDist || ( dist == bestDist && j < best ) )
+                    {
+                        best     = j;
+                        bestDist = dist;
+                    }
+                } );
+            } );
+        }
+
+        distance2 = bestDist;
+        return best;
+    }
+
+
+    static inline param_t squaredDistance( const param_t* __restrict a, const param_t* __restrict b, const size_t numParams )
+    {
+        // Four independent sums, a single one is a serial dependency the compiler may not reorder
+        param_t sums[4] = { 0, 0, 0, 0 };
+
+        size_t j = 0;
+
+        for ( ; j + 4 <= numParams; j += 4 )
+        {
+            for ( size_t l = 0; l < 4; ++l )
+            {
+                const param_t d = a[j + l] - b[j + l];
+                sums[l] += d * d;
+            }
+        }
+
+        for ( ; j < numParams; ++j )
+        {
+            const param_t d = a[j] - b[j];
+            sums[0] += d * d;
+        }
+
+        return ( sums[0] + sums[1] ) + ( sums[2] + sums[3] );
+    }
+
+
+    size_t getNumPoints() const { return numPoints_; }
+    param_t getCellSize() const { return cellSize_; }
+
+    // Points that changed cell in the last rebuild, all of them when the grid was laid out anew
+    size_t getNumMoved() const { return numMoved_; }
+
+
+private:
+
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t particle;
+
+        bool operator<( const Entry& other ) const { return key < other.key || ( key == other.key && particle < other.particle ); }
+    };
+
+
+    void cellOf( const param_t* point, uint32_t* cell ) const
+    {
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            const param_t offset = std::floor( ( point[k] - origin_[k] ) / cellSize_ );
+
+            cell[k] = offset <= 0 ? 0u : static_cast< uint32_t >( std::min< param_t >( offset, static_cast< param_t >( numCells_[k] - 1 ) ) );
+        }
+    }
+
+
+    uint64_t cellKey( const param_t* point ) const
+    {
+        uint32_t cell[MAX_GRID_DIMS];
+        cellOf( point, cell );
+
+        return keyOf( cell );
+    }
+
+
+    uint64_t keyOf( const uint32_t* cell ) const
+    {
+        uint64_t key = 0u;
+
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            key += static_cast< uint64_t >( cell[k] ) * strides_[k];
+        }
+
+        return key;
+    }
+
+
+    // Chebyshev distance in cells between two cells
+    uint32_t ringOf( const uint32_t* other, const uint32_t* cell ) const
+    {
+        uint32_t ring = 0u;
+
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            ring = std::max( ring, other[k] > cell[k] ? other[k] - cell[k] : cell[k] - other[k] );
+        }
+
+        return ring;
+    }
+
+
+    // Calls func( key, cell ) for every cell of the box [low, high]
+    template< typename Func >
+    void forEachCell( const uint32_t* low, const uint32_t* high, Func&& func ) const
+    {
+        uint32_t cell[MAX_GRID_DIMS];
+
+        for ( size_t k = 0; k < gridDims_; ++k )
+        {
+            cell[k] = low[k];
+        }
+
+        while ( true )
+        {
+            func( keyOf( cell ), static_cast< const uint32_t* >( cell ) );
+
+            size_t k = 0;
+
+            for ( ; k < gridDims_ && cell[k] == high[k]; ++k )
+            {
+                cell[k] = low[k];
+            }
+
+            if ( k == gridDims_ )
+            {
+                return;
+            }
+
+            ++cell[k];
+        }
+    }
+
+
+    // Calls func( j, squaredDistance ) for the points of a cell closer than radius2
+    template< typename Func >
+    void scanCell( const uint64_t key, const param_t* point, const param_t radius2, Func&& func ) const
+    {
+        size_t first;
+        size_t last;
+
+        if ( !cellStarts_.empty() )
+        {
+            first = cellStarts_[key];
+            last  = cellStarts_[key + 1];
+        }
+        else
+        {
+            const auto range = std::equal_range( entries_.begin(), entries_.end(), Entry{ key, 0u }, []( const Entry& a, const Entry& b ) { return a.key < b.key; } );
+
+            first = static_cast< size_t >( range.first - entries_.begin() );
+            last  = static_cast< size_t >( range.second - entries_.begin() );
+        }
+
+        for ( size_t e = first; e < last; ++e )
+        {
+            const size_t j     = static_cast< size_t >( entries_[e].particle );
+            const param_t dist = squaredDistance( point, positions_ + j * numParams_, numParams_ );
+
+            if ( dist < radius2 )
+            {
+                func( j, dist );
+            }
+        }
+    }
+
+
+    // Start of every cell in the entries, when the grid is small enough
+    void tabulateCells()
+    {
+        if ( numGridCells_ > TABLE_CELLS_PER_POINT * std::max< size_t >( numPoints_, 1024u ) )
+        {
+            cellStarts_.clear();
+            return;
+        }
+
+        cellStarts_.assign( numGridCells_ + 1, 0u );
+
+        for ( const Entry& entry : entries_ )
+        {
+            ++cellStarts_[entry.key + 1];
+        }
+
+        std::partial_sum( cellStarts_.begin(), cellStarts_.end(), cellStarts_.begin() );
+    }
+
+
+    // Chunks sorted in parallel, then merged pairwise
+    template< typename ForEach >
+    void sortAll( ForEach&& forEach )
+    {
+        entries_.resize( numPoints_ );
+
+        for ( size_t i = 0; i < numPoints_; ++i )
+        {
+            entries_[i] = Entry{ keys_[i], static_cast< uint32_t >( i ) };
+        }
+
+        const size_t chunk = ( numPoints_ + SORT_CHUNKS - 1 ) / SORT_CHUNKS;
+
+        if ( chunk == 0 )
+        {
+            return;
+        }
+
+        forEach( SORT_CHUNKS, [this, chunk]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t c = begin; c < end; ++c )
+            {
+                const size_t first = std::min( c * chunk, numPoints_ );
+                const size_t last  = std::min( first + chunk, numPoints_ );
+
+                std::sort( entries_.begin() + first, entries_.begin() + last );
+            }
+        } );
+
+        for ( size_t width = chunk; width < numPoints_; width *= 2 )
+        {
+            for ( size_t first = 0; first + width < numPoints_; first += 2 * width )
+            {
+                std::inplace_merge( entries_.begin() + first, entries_.begin() + first + width,
+                                    entries_.begin() + std::min( first + 2 * width, numPoints_ ) );
+            }
+        }
+    }
+
+
+    const param_t* positions_;
+    size_t numPoints_;
+    size_t numParams_;
+    size_t gridDims_;
+    param_t cellSize_;
+    param_t origin_[MAX_GRID_DIMS];
+    uint32_t numCells_[MAX_GRID_DIMS];
+    uint64_t strides_[MAX_GRID_DIMS];
+    uint64_t numGridCells_;
+
+    std::vector< uint64_t > keys_;          // Cell of every point
+    std::vector< uint64_t > newKeys_;
+    std::vector< Entry > entries_;          // Sorted by cell
+    std::vector< Entry > moved_;
+    std::vector< Entry > merged_;
+    std::vector< uint32_t > cellStarts_;
+
+    size_t numMoved_;
+
+}; // class SpatialGrid
+
+} // namespace MetaOpt
+
+#endif // SPATIAL_GRID_H
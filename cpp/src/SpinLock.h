@@ -0,0 +1,60 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <atomic>
+#include <thread>
+
+
+namespace MetaOpt
+{
+
+// Test-and-test-and-set lock for critical sections of a few hundred cycles, such as copying one population row.
+// Satisfies Lockable, so it works with std::lock_guard.
+class SpinLock
+{
+public:
+
+    SpinLock()
+        : locked_{ false }
+    {
+    }
+
+    ~SpinLock() = default;
+
+
+    inline void lock()
+    {
+        while ( locked_.exchange( true, std::memory_order_acquire ) )
+        {
+            while ( locked_.load( std::memory_order_relaxed ) )
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+
+    inline bool try_lock()
+    {
+        return !locked_.load( std::memory_order_relaxed ) && !locked_.exchange( true, std::memory_order_acquire );
+    }
+
+
+    inline void unlock()
+    {
+        locked_.store( false, std::memory_order_release );
+    }
+
+
+private:
+
+    std::atomic< bool > locked_;
+
+    SpinLock( const SpinLock& ) = delete;
+    SpinLock& operator=( const SpinLock& ) = delete;
+
+}; // class SpinLock
+
+} // namespace MetaOpt
+
+#endif // SPINLOCK_H
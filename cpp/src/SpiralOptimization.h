@@ -0,0 +1,324 @@
+#ifndef SPIRAL_OPTIMIZATION_H
+#define SPIRAL_OPTIMIZATION_H
+
+
+#include "OptimizationAlg.h"
+#include "Particle.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Spiral optimization (Tamura and Yasuda). Every generation each particle moves along a spiral around the best point:
+//     x = x* + r R( theta ) ( x - x* ),
+// clipped to the bounds, where R( theta ) is the composition of the rotations by theta in every plane of two
+// parameters. The n ( n - 1 ) / 2 Givens rotations are composed into a matrix once per run, its rows built in parallel,
+// and the whole population is then rotated by one tiled matrix product per generation, chunk by chunk on the pool.
+template< size_t __NUM_PARTICLES, size_t __NUM_PARAMS, typename __PARAM_T = double, typename __FITNESS_T = double >
+class SpiralOptimization : public OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base         = OptimizationAlg< __NUM_PARTICLES, Particle, __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using particle_t   = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
+    using param_t      = __PARAM_T;
+    using fitness_t    = __FITNESS_T;
+    using population_t = typename Base::population_t;
+
+
+    static constexpr size_t  NUM_PARTICLES          = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS             = __NUM_PARAMS;
+    static constexpr param_t DEFAULT_RADIUS         = 0.95;
+    static constexpr param_t DEFAULT_ANGLE          = 0.7853981633974483;    // pi / 4
+    static constexpr size_t  ROTATION_TILE_ROWS     = 32;                    // Rows of the rotation reused per pass over particles
+    static constexpr size_t  ROTATION_TILE_COLUMNS  = 256;
+    static constexpr size_t  ROTATION_BUILD_COLUMNS = 64;                    // Columns of R composed together
+
+
+    // Constructor
+    SpiralOptimization( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
+        requires ( !population_t::IS_DYNAMIC )
+        : SpiralOptimization( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    SpiralOptimization( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                        const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
+        , radius_{ DEFAULT_RADIUS }
+        , angle_{ DEFAULT_ANGLE }
+        , rotationBuilt_{ false }
+        , rotation_( numParams * numParams )
+        , center_( numParams )
+        , displacements_{ numParticles * numParams, this->arena_ }
+    {
+    }
+
+    // Destructor
+    virtual ~SpiralOptimization() {}
+
+
+    // Contraction per generation, below 1 for the particles to converge on the best point
+    void setRadius( const param_t radius ) { radius_ = radius; }
+
+
+    // Rotation angle in every plane; the composed rotation is rebuilt at the next generation
+    void setAngle( const param_t angle )
+    {
+        angle_         = angle;
+        rotationBuilt_ = false;
+    }
+
+
+protected:
+
+    // Spiral step of particles [begin, end): displacements from the center, times the transposed rotation one tile at
+    // a time, so a tile is streamed once for all particles of the chunk
+    void updateBlock( const size_t begin, const size_t end ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            param_t* position     = this->population_.position( i );
+            param_t* displacement = displacements_.data() + i * numParams;
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                displacement[j] = position[j] - center_[j];
+            }
+
+            std::fill( position, position + numParams, static_cast< param_t >( 0 ) );
+        }
+
+        for ( size_t columnBegin = 0; columnBegin < numParams; columnBegin += ROTATION_TILE_COLUMNS )
+        {
+            const size_t columnEnd = std::min( columnBegin + ROTATION_TILE_COLUMNS, numParams );
+
+            for ( size_t rowBegin = 0; rowBegin < numParams; rowBegin += ROTATION_TILE_ROWS )
+            {
+                const size_t rowEnd = std::min( rowBegin + ROTATION_TILE_ROWS, numParams );
+
+                const param_t* tile = rotation_.data() + rowBegin * numParams + columnBegin;
+
+                size_t i = begin;
+
+                // Two particles at a time, so every load of the tile feeds both
+                for ( ; i + 2 <= end; i += 2 )
+                {
+                    axpyRows2( this->population_.position( i ) + columnBegin, this->population_.position( i + 1 ) + columnBegin,
+                               displacements_.data() + i * numParams + rowBegin, displacements_.data() + ( i + 1 ) * numParams + rowBegin, tile,
+                               numParams, rowEnd - rowBegin, columnEnd - columnBegin );
+                }
+
+                for ( ; i < end; ++i )
+                {
+                    axpyRows( this->population_.position( i ) + columnBegin, displacements_.data() + i * numParams + rowBegin, tile, numParams,
+                              rowEnd - rowBegin, columnEnd - columnBegin );
+                }
+            }
+        }
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            placeParticle( this->population_.position( i ), center_.data(), this->lowerBound_.data(), this->upperBound_.data(), numParams, radius_ );
+        }
+    }
+
+
+    // y += sum_r a[r] x_r over numRows rows of x, four at a time
+    static inline void axpyRows( param_t* __restrict y, const param_t* __restrict a, const param_t* __restrict x, const size_t stride,
+                                 const size_t numRows, const size_t count )
+    {
+        size_t r = 0;
+
+        for ( ; r + 4 <= numRows; r += 4 )
+        {
+            const param_t* x0 = x + r * stride;
+            const param_t* x1 = x0 + stride;
+            const param_t* x2 = x1 + stride;
+            const param_t* x3 = x2 + stride;
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+                y[j] += a[r] * x0[j] + a[r + 1] * x1[j] + a[r + 2] * x2[j] + a[r + 3] * x3[j];
+            }
+        }
+
+        for ( ; r < numRows; ++r )
+        {
+            const param_t* x0 = x + r * stride;
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+                y[j] += a[r] * x0[j];
+            }
+        }
+    }
+
+
+    // axpyRows for two particles sharing the rows of x
+    static inline void axpyRows2( param_t* __restrict y0, param_t* __restrict y1, const param_t* __restrict a0, const param_t* __restrict a1,
+                                  const param_t* __restrict x, const size_t stride, const size_t numRows, const size_t count )
+    {
+        size_t r = 0;
+
+        for ( ; r + 4 <= numRows; r += 4 )
+        {
+            const param_t* x0 = x + r * stride;
+            const param_t* x1 = x0 + stride;
+            const param_t* x2 = x1 + stride;
+            const param_t* x3 = x2 + stride;
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+                y0[j] += a0[r] * x0[j] + a0[r + 1] * x1[j] + a0[r + 2] * x2[j] + a0[r + 3] * x3[j];
+                y1[j] += a1[r] * x0[j] + a1[r + 1] * x1[j] + a1[r + 2] * x2[j] + a1[r + 3] * x3[j];
+            }
+        }
+
+        for ( ; r < numRows; ++r )
+        {
+            const param_t* x0 = x + r * stride;
+
+            for ( size_t j = 0; j < count; ++j )
+            {
+                y0[j] += a0[r] * x0[j];
+                y1[j] += a1[r] * x0[j];
+            }
+        }
+    }
+
+
+    // x = clip( center + radius x ), x holding the rotated displacement
+    static inline void placeParticle( param_t* __restrict x, const param_t* __restrict center, const param_t* __restrict lowerBound,
+                                      const param_t* __restrict upperBound, const size_t numParams, const param_t radius )
+    {
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            x[j] = std::min( std::max( center[j] + radius * x[j], lowerBound[j] ), upperBound[j] );
+        }
+    }
+
+
+    // Particles move in place around the best point found so far
+    void updateParticles() override
+    {
+        if ( !rotationBuilt_ )
+        {
+            buildRotation();
+        }
+
+        std::memcpy( center_.data(), this->bestParticle_->position_.data(), this->getNumParams() * sizeof( param_t ) );
+
+        Base::updateParticles();
+    }
+
+
+    const char* getSnapshotTag() const override { return "SpiralOptimization"; }
+
+
+    void saveState( SnapshotWriter& writer ) const override
+    {
+        writer.write( radius_ );
+        writer.write( angle_ );
+    }
+
+
+    void loadState( SnapshotReader& reader ) override
+    {
+        radius_ = reader.read< param_t >();
+
+        setAngle( reader.read< param_t >() );
+    }
+
+
+private:
+
+    // R = G_last ... G_first, applied to the identity one Givens rotation at a time. A rotation in plane ( p, q ) mixes
+    // rows p and q of R, so every chunk of columns of R goes through the whole sequence on its own, in slices narrow
+    // enough to stay in cache, and is then transposed into the matching rows of rotation_.
+    void buildRotation()
+    {
+        Profiler::Scope scope( this->profiler_, Profiler::Phase::INITIALIZE, this->profiler_.getMainSlot() );
+
+        const size_t numParams = this->getNumParams();
+        const param_t c        = std::cos( angle_ );
+        const param_t s        = std::sin( angle_ );
+
+        std::vector< param_t > composed( numParams * numParams, static_cast< param_t >( 0 ) );
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            composed[j * numParams + j] = 1;
+        }
+
+        this->forEachChunk( numParams, [this, &composed, numParams, c, s]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t sliceBegin = begin; sliceBegin < end; sliceBegin += ROTATION_BUILD_COLUMNS )
+            {
+                const size_t width = std::min( sliceBegin + ROTATION_BUILD_COLUMNS, end ) - sliceBegin;
+
+                // Planes ( p, q ) for q > p, in order. Up to plane ( p, sliceBegin ), rows p and q < sliceBegin are
+                // still zero within the slice.
+                for ( size_t p = 0; p + 1 < numParams; ++p )
+                {
+                    for ( size_t q = std::max( p + 1, sliceBegin ); q < numParams; ++q )
+                    {
+                        rotateRows( composed.data() + p * numParams + sliceBegin, composed.data() + q * numParams + sliceBegin, width, c, s );
+                    }
+                }
+            }
+
+            for ( size_t row = begin; row < end; ++row )
+            {
+                for ( size_t j = 0; j < numParams; ++j )
+                {
+                    rotation_[row * numParams + j] = composed[j * numParams + row];
+                }
+            }
+        } );
+
+        rotationBuilt_ = true;
+    }
+
+
+    static inline void rotateRows( param_t* __restrict x, param_t* __restrict y, const size_t count, const param_t c, const param_t s )
+    {
+        for ( size_t j = 0; j < count; ++j )
+        {
+            const param_t xj = x[j];
+            const param_t yj = y[j];
+
+            x[j] = c * xj - s * yj;
+            y[j] = s * xj + c * yj;
+        }
+    }
+
+
+    param_t radius_;
+    param_t angle_;
+
+    bool rotationBuilt_;
+    std::vector< param_t > rotation_;       // R transposed, row-major, so a displacement row d maps to d rotation_
+    std::vector< param_t > center_;
+
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > displacements_;
+
+
+    SpiralOptimization() = delete;
+    SpiralOptimization( const SpiralOptimization& ) = delete;
+    SpiralOptimization& operator=( const SpiralOptimization& ) = delete;
+
+}; // class SpiralOptimization
+
+} // namespace MetaOpt
+
+#endif // SPIRAL_OPTIMIZATION_H
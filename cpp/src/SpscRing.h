@@ -0,0 +1,196 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "Population.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+
+namespace MetaOpt
+{
+
+// Lock-free ring of fixed-size byte slots between exactly one producer and one consumer thread. Slots are
+// filled and drained in place, so a record is copied once on each side. Each index lives on its own cache line
+// next to a cached copy of the other side's index, so the shared lines only move when the cache runs out.
+// The ring either owns its memory or is placed in memory given by the caller, e.g. shared between processes;
+// indices and slots are addressed relative to that memory, so every process may map it at its own address.
+class SpscRing
+{
+public:
+
+    // capacity is rounded up to a power of two
+    SpscRing( const size_t slotSize, const size_t capacity )
+        : slotSize_{ roundSlotSize( slotSize ) }
+        , mask_{ roundUp( capacity ) - 1 }
+        , memory_{ static_cast< std::byte* >( ::operator new( getRequiredBytes( slotSize, capacity ), std::align_val_t{ CACHE_LINE_SIZE } ) ) }
+        , control_{ new ( memory_ ) Control{} }
+        , slots_{ memory_ + sizeof( Control ) }
+        , ownsMemory_{ true }
+    {
+    }
+
+
+    // Ring in memory of at least getRequiredBytes() bytes aligned to a cache line. Exactly one of the processes
+    // sharing it initializes it, before any of them use it.
+    SpscRing( void* memory, const size_t slotSize, const size_t capacity, const bool initialize )
+        : slotSize_{ roundSlotSize( slotSize ) }
+        , mask_{ roundUp( capacity ) - 1 }
+        , memory_{ static_cast< std::byte* >( memory ) }
+        , control_{ initialize ? new ( memory_ ) Control{} : std::launder( reinterpret_cast< Control* >( memory_ ) ) }
+        , slots_{ memory_ + sizeof( Control ) }
+        , ownsMemory_{ false }
+    {
+        static_assert( std::atomic< uint64_t >::is_always_lock_free, "SpscRing needs lock-free 64-bit atomics to be shared between processes" );
+    }
+
+
+    ~SpscRing()
+    {
+        if ( ownsMemory_ )
+        {
+            control_->~Control();
+            ::operator delete( memory_, std::align_val_t{ CACHE_LINE_SIZE } );
+        }
+    }
+
+
+    static size_t getRequiredBytes( const size_t slotSize, const size_t capacity )
+    {
+        return sizeof( Control ) + roundSlotSize( slotSize ) * roundUp( capacity );
+    }
+
+
+    // Producer: next free slot, or nullptr when the ring is full
+    std::byte* tryAcquire()
+    {
+        Side& producer = control_->producer;
+
+        const uint64_t head = producer.index.load( std::memory_order_relaxed );
+
+        if ( head - producer.cachedOther > mask_ )
+        {
+            producer.cachedOther = control_->consumer.index.load( std::memory_order_acquire );
+
+            if ( head - producer.cachedOther > mask_ )
+            {
+                return nullptr;
+            }
+        }
+
+        return slots_ + ( head & mask_ ) * slotSize_;
+    }
+
+
+    // Producer: publishes the slot returned by tryAcquire
+    void commit()
+    {
+        Side& producer = control_->producer;
+
+        producer.index.store( producer.index.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+        producer.index.notify_one();
+    }
+
+
+    // Consumer: oldest published slot, or nullptr when the ring is empty
+    const std::byte* tryPeek()
+    {
+        Side& consumer = control_->consumer;
+
+        const uint64_t tail = consumer.index.load( std::memory_order_relaxed );
+
+        if ( tail == consumer.cachedOther )
+        {
+            consumer.cachedOther = control_->producer.index.load( std::memory_order_acquire );
+
+            if ( tail == consumer.cachedOther )
+            {
+                return nullptr;
+            }
+        }
+
+        return slots_ + ( tail & mask_ ) * slotSize_;
+    }
+
+
+    // Consumer: hands the slot returned by tryPeek back to the producer
+    void release()
+    {
+        Side& consumer = control_->consumer;
+
+        consumer.index.store( consumer.index.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+    }
+
+
+    // Consumer: blocks while nothing was published beyond what it has seen. Only a commit wakes it, so
+    // shutting a consumer down takes a slot that tells it to stop. Only works within one process; a consumer
+    // in another process than its producer polls tryPeek instead.
+    void waitForData()
+    {
+        control_->producer.index.wait( control_->consumer.index.load( std::memory_order_relaxed ), std::memory_order_acquire );
+    }
+
+
+    size_t getSlotSize() const { return slotSize_; }
+    size_t getCapacity() const { return mask_ + 1; }
+
+
+private:
+
+    static size_t roundSlotSize( const size_t slotSize )
+    {
+        return ( slotSize + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+
+
+    static size_t roundUp( const size_t capacity )
+    {
+        if ( capacity == 0 )
+        {
+            throw std::invalid_argument( "SpscRing::SpscRing: capacity must be positive" );
+        }
+
+        size_t rounded = 1;
+
+        while ( rounded < capacity )
+        {
+            rounded <<= 1;
+        }
+
+        return rounded;
+    }
+
+
+    struct alignas( CACHE_LINE_SIZE ) Side
+    {
+        std::atomic< uint64_t > index{ 0u };
+        uint64_t cachedOther = 0u;
+    };
+
+    struct Control
+    {
+        Side producer;
+        Side consumer;
+    };
+
+
+    size_t slotSize_;
+    size_t mask_;
+    std::byte* memory_;
+    Control* control_;
+    std::byte* slots_;
+    bool ownsMemory_;
+
+
+    SpscRing( const SpscRing& ) = delete;
+    SpscRing& operator=( const SpscRing& ) = delete;
+
+}; // class SpscRing
+
+} // namespace MetaOpt
+
+#endif // SPSC_RING_H
@@ -22,6 +22,7 @@ public:
 
 
     static constexpr size_t  NUM_PARTICLES     = __NUM_PARTICLES;
+    static constexpr size_t  NUM_PARAMS        = __NUM_PARAMS;
     static constexpr param_t DEFAULT_INERTIA   = 0.5;
     static constexpr param_t DEFAULT_COGNITIVE = 1.0;
     static constexpr param_t DEFAULT_SOCIAL    = 1.0;
@@ -30,10 +31,24 @@ public:
 
     // Constructor
     SwarmOptimization( const param_t lowerBound[__NUM_PARAMS], const param_t upperBound[__NUM_PARAMS], const int numThreads = 1 )
-        : Base( lowerBound, upperBound, numThreads )
+        requires ( !Base::population_t::IS_DYNAMIC )
+        : SwarmOptimization( NUM_PARTICLES, NUM_PARAMS, lowerBound, upperBound, numThreads )
+    {
+    }
+
+
+    // Constructor, sizes given at run time
+    SwarmOptimization( const size_t numParticles, const size_t numParams, const param_t* lowerBound, const param_t* upperBound,
+                       const int numThreads = 1, const bool hugePages = false )
+        : Base( numParticles, numParams, lowerBound, upperBound, numThreads, hugePages )
         , inertia_  { DEFAULT_INERTIA }
         , cognitive_{ DEFAULT_COGNITIVE }
         , social_   { DEFAULT_SOCIAL }
+        , velocities_{ numParticles * numParams, this->arena_ }
+        , bestPositions_{ numParticles * numParams, this->arena_ }
+        , bestFitnesses_{ numParticles, this->arena_ }
+        , cognitiveDraws_{ numParticles * numParams, this->arena_ }
+        , socialDraws_{ numParticles * numParams, this->arena_ }
     {
     }
 
@@ -48,20 +63,140 @@ public:
 protected:
 
 
-    virtual void updateParticle( particle_t& particle ) override
+    virtual void postInitialize() override
+    {
+        velocities_.fill( static_cast< param_t >( 0 ) );
+    }
+
+
+    virtual void updateBlock( const size_t begin, const size_t end ) override
+    {
+        // Random coefficients are drawn first, each particle from its own stream, so the update below is a
+        // flat loop over contiguous rows
+        const size_t numParams = this->getNumParams();
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            Rng<>& rng = this->rngs_[i];
+
+            rng.fillUniform( cognitiveDraws_.data() + i * numParams, numParams );
+            rng.fillUniform( socialDraws_.data() + i * numParams, numParams );
+        }
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            const size_t offset = i * numParams;
+
+            moveParticle( this->population_.position( i ), velocities_.data() + offset, bestPositions_.data() + offset,
+                          this->bestParticle_->position_.data(), cognitiveDraws_.data() + offset, socialDraws_.data() + offset,
+                          this->lowerBound_.data(), this->upperBound_.data(), numParams, inertia_, cognitive_, social_ );
+        }
+    }
+
+
+    // Velocity and position update of one particle. Kept free of member accesses so the compiler can prove
+    // the rows do not alias and vectorize the loop.
+    static inline void moveParticle( param_t* __restrict position, param_t* __restrict velocity, const param_t* __restrict bestPosition,
+                                     const param_t* __restrict globalBest, const param_t* __restrict cognitiveDraw, const param_t* __restrict socialDraw,
+                                     const param_t* __restrict lowerBound, const param_t* __restrict upperBound, const size_t numParams,
+                                     const param_t inertia, const param_t cognitive, const param_t social )
     {
-        for ( size_t j = 0; j < particle.NUM_PARAMS; j++ )
+        for ( size_t j = 0; j < numParams; ++j )
         {
-            particle.velocity_[j] = inertia_ * particle.velocity_[j] +
-                                    cognitive_ * this->rng_->drawUniform( 0.0, 1.0 ) * ( particle.bestPosition_[j] - particle.position_[j] ) +
-                                    social_ * this->rng_->drawUniform( 0.0, 1.0 ) * ( this->bestParticle_->position_[j] - particle.position_[j] );
+            velocity[j] = inertia * velocity[j] +
+                          cognitive * cognitiveDraw[j] * ( bestPosition[j] - position[j] ) +
+                          social * socialDraw[j] * ( globalBest[j] - position[j] );
+
+            position[j] = std::min( std::max( position[j] + velocity[j], lowerBound[j] ), upperBound[j] );
+        }
+    }
+
 
-            particle.position_[j] += particle.velocity_[j];
+    // Personal best update
+    virtual void selectBlock( const size_t begin, const size_t end ) override
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( this->population_.fitness( i ) < bestFitnesses_[i] )
+            {
+                updatePersonalBest( i );
+            }
         }
+    }
+
 
-        particle.clip( this->lowerBound_, this->upperBound_ );
+    // The initial positions are the first personal bests
+    virtual void evaluateParticles() override
+    {
+        bestFitnesses_.fill( std::numeric_limits< fitness_t >::max() );
+
+        Base::evaluateParticles();
 
-        particle.fitness_ = this->fitnessFunc_( particle );
+        for ( size_t i = 0; i < this->getNumParticles(); ++i )
+        {
+            updatePersonalBest( i );
+        }
+    }
+
+
+    // A particle is raced against its personal best, the value selectBlock compares it with
+    virtual fitness_t getRacingThreshold( const typename Base::population_t&, const size_t idx, fitness_t& standardError2 ) const override
+    {
+        standardError2 = fitness_t{};
+        return bestFitnesses_[idx];
+    }
+
+
+    // A migrant starts at rest, with its arrival position as personal best
+    virtual void onParticleReplaced( const size_t idx ) override
+    {
+        const size_t numParams = this->getNumParams();
+
+        std::fill( velocities_.data() + idx * numParams, velocities_.data() + ( idx + 1 ) * numParams, static_cast< param_t >( 0 ) );
+
+        updatePersonalBest( idx );
+    }
+
+
+    virtual const char* getSnapshotTag() const override { return "SwarmOptimization"; }
+
+
+    virtual void saveState( SnapshotWriter& writer ) const override
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+
+        writer.write( inertia_ );
+        writer.write( cognitive_ );
+        writer.write( social_ );
+
+        writer.writeArray( velocities_.data(), numParticles * numParams );
+        writer.writeArray( bestPositions_.data(), numParticles * numParams );
+        writer.writeArray( bestFitnesses_.data(), numParticles );
+    }
+
+
+    virtual void loadState( SnapshotReader& reader ) override
+    {
+        const size_t numParticles = this->getNumParticles();
+        const size_t numParams    = this->getNumParams();
+
+        inertia_   = reader.read< param_t >();
+        cognitive_ = reader.read< param_t >();
+        social_    = reader.read< param_t >();
+
+        reader.readArray( velocities_.data(), numParticles * numParams );
+        reader.readArray( bestPositions_.data(), numParticles * numParams );
+        reader.readArray( bestFitnesses_.data(), numParticles );
+    }
+
+
+    void updatePersonalBest( const size_t idx )
+    {
+        const size_t numParams = this->getNumParams();
+
+        std::memcpy( bestPositions_.data() + idx * numParams, this->population_.position( idx ), numParams * sizeof( param_t ) );
+        bestFitnesses_[idx] = this->population_.fitness( idx );
     }
 
 
@@ -69,6 +204,13 @@ protected:
     param_t cognitive_;
     param_t social_;
 
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > velocities_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > bestPositions_;
+    AlignedArray< fitness_t, NUM_PARTICLES >                            bestFitnesses_;
+
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > cognitiveDraws_;
+    AlignedArray< param_t, extentProduct( NUM_PARTICLES, NUM_PARAMS ) > socialDraws_;
+
 
     SwarmOptimization() = delete;
     SwarmOptimization( const SwarmOptimization& ) = delete;
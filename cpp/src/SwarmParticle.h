@@ -17,14 +17,27 @@ public:
     using Base      = Particle< __NUM_PARAMS, __PARAM_T, __FITNESS_T >;
     using param_t   = __PARAM_T;
     using fitness_t = __FITNESS_T;
+    using storage_t = typename Base::storage_t;
 
 
     // Constructor
     inline SwarmParticle()
         : Base()
         , velocity_{}
+        , bestPosition_{}
+        , bestFitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        std::memset( velocity_, 0, Base::NUM_PARAMS * sizeof( param_t ) );
+    }
+
+
+    // Constructor, zeroed state of numParams parameters
+    inline explicit SwarmParticle( const size_t numParams )
+        : Base( numParams )
+        , velocity_{}
+        , bestPosition_{}
+        , bestFitness_{ std::numeric_limits< fitness_t >::max() }
+    {
+        resizeState();
     }
 
 
@@ -33,11 +46,14 @@ public:
 
 
     // Copy constructor
-    inline SwarmParticle( const param_t ( &other )[Base::NUM_PARAMS] )
+    template< size_t N >
+    inline SwarmParticle( const param_t ( &other )[N] )
         : Base( other )
         , velocity_{}
+        , bestPosition_{}
+        , bestFitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        std::memset( velocity_, 0, Base::NUM_PARAMS * sizeof( param_t ) );
+        resizeState();
     }
 
 
@@ -45,8 +61,9 @@ public:
     inline SwarmParticle( const SwarmParticle& other )
         : Base( other )
         , velocity_{ other.velocity_ }
+        , bestPosition_{ other.bestPosition_ }
+        , bestFitness_{ other.bestFitness_ }
     {
-        std::memcpy( velocity_, other.velocity_, Base::NUM_PARAMS * sizeof( param_t ) );
     }
 
 
@@ -54,13 +71,10 @@ public:
     inline SwarmParticle( const std::initializer_list< param_t >& other )
         : Base( other )
         , velocity_{}
+        , bestPosition_{}
+        , bestFitness_{ std::numeric_limits< fitness_t >::max() }
     {
-        if ( other.size() != Base::NUM_PARAMS )
-        {
-            throw std::invalid_argument( "Initializer list size does not match number of parameters" );
-        }
-
-        std::memset( velocity_, 0, Base::NUM_PARAMS * sizeof( param_t ) );
+        resizeState();
     }
 
 
@@ -71,17 +85,32 @@ public:
         {
             Base::operator=( other );
 
-            std::memcpy( velocity_, other.velocity_, Base::NUM_PARAMS * sizeof( param_t ) );
-            std::memcpy( bestPosition_, other.bestPosition_, Base::NUM_PARAMS * sizeof( param_t ) );
+            velocity_     = other.velocity_;
+            bestPosition_ = other.bestPosition_;
+            bestFitness_  = other.bestFitness_;
         }
 
         return *this;
     }
 
 
-    param_t velocity_[Base::NUM_PARAMS];
+    storage_t velocity_;
 
-    param_t bestPosition_[Base::NUM_PARAMS];
+    storage_t bestPosition_;
+
+    fitness_t bestFitness_;
+
+
+private:
+
+    inline void resizeState()
+    {
+        if constexpr ( Base::NUM_PARAMS == DYNAMIC_EXTENT )
+        {
+            velocity_.assign( this->size(), static_cast< param_t >( 0 ) );
+            bestPosition_.assign( this->size(), static_cast< param_t >( 0 ) );
+        }
+    }
 
 
 }; // class SwarmParticle
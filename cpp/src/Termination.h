@@ -0,0 +1,321 @@
+#ifndef TERMINATION_H
+#define TERMINATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Why a run stopped
+enum class StopReason : uint8_t
+{
+    NONE,
+    MAX_ITERATIONS,
+    STALLED,            // No improvement of the best fitness over the stall window
+    FITNESS_SPREAD,     // Population fitness values within the tolerance of each other
+    DIAMETER,           // Population bounding box narrower than the tolerance in every dimension
+    TARGET_FITNESS,
+    EVALUATION_BUDGET,
+    TIME_LIMIT,
+    STOP_REQUESTED,     // The stop flag was raised from outside
+    CONVERGED           // An isConverged override of the algorithm
+};
+
+
+inline const char* getStopReasonName( const StopReason reason )
+{
+    switch ( reason )
+    {
+        case StopReason::NONE:              return "none";
+        case StopReason::MAX_ITERATIONS:    return "maxIterations";
+        case StopReason::STALLED:           return "stalled";
+        case StopReason::FITNESS_SPREAD:    return "fitnessSpread";
+        case StopReason::DIAMETER:          return "diameter";
+        case StopReason::TARGET_FITNESS:    return "targetFitness";
+        case StopReason::EVALUATION_BUDGET: return "evaluationBudget";
+        case StopReason::TIME_LIMIT:        return "timeLimit";
+        case StopReason::STOP_REQUESTED:    return "stopRequested";
+        case StopReason::CONVERGED:         return "converged";
+    }
+
+    return "unknown";
+}
+
+
+
+// Set of stopping criteria checked once per iteration, each disabled until configured. Whichever is met
+// first stops the run. Target, budget, time and stall checks are O(1); the spread check reads the fitness
+// column and the diameter check one pass over the positions, so only enabled criteria cost anything.
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class Termination
+{
+public:
+
+    using param_t   = __PARAM_T;
+    using fitness_t = __FITNESS_T;
+    using clock     = std::chrono::steady_clock;
+
+
+    Termination()
+    {
+        clear();
+    }
+
+
+    // Stops after window iterations in which the best fitness improved by no more than tolerance in total
+    void setStallWindow( const uint64_t window, const fitness_t tolerance = static_cast< fitness_t >( 0 ) )
+    {
+        stallWindow_    = window;
+        stallTolerance_ = tolerance;
+    }
+
+
+    // Stops once max - min of the population's fitness values is at most tolerance
+    void setFitnessSpreadTolerance( const fitness_t tolerance )
+    {
+        spreadEnabled_   = true;
+        spreadTolerance_ = tolerance;
+    }
+
+
+    // Stops once the population's bounding box is at most tolerance wide along every parameter
+    void setDiameterTolerance( const param_t tolerance )
+    {
+        diameterEnabled_   = true;
+        diameterTolerance_ = tolerance;
+    }
+
+
+    // Stops once the best fitness is at or below target
+    void setTargetFitness( const fitness_t target )
+    {
+        targetEnabled_ = true;
+        target_        = target;
+    }
+
+
+    // Stops once this many fitness evaluations were made, the initial population included. Checked between
+    // iterations, so the last iteration may overshoot the budget.
+    void setEvaluationBudget( const uint64_t evaluations )
+    {
+        evaluationBudget_ = evaluations;
+    }
+
+
+    // Stops once the run has taken longer than limit
+    void setTimeLimit( const std::chrono::duration< double > limit )
+    {
+        timeLimit_ = std::chrono::duration_cast< clock::duration >( limit );
+    }
+
+
+    // Stops once *flag is true, so another thread can end the run at the next iteration. nullptr disables it.
+    void setStopFlag( const std::atomic< bool >* flag )
+    {
+        stopFlag_ = flag;
+    }
+
+
+    // Disables every criterion
+    void clear()
+    {
+        stopFlag_          = nullptr;
+        stallWindow_       = 0u;
+        stallTolerance_    = static_cast< fitness_t >( 0 );
+        spreadEnabled_     = false;
+        spreadTolerance_   = static_cast< fitness_t >( 0 );
+        diameterEnabled_   = false;
+        diameterTolerance_ = static_cast< param_t >( 0 );
+        targetEnabled_     = false;
+        target_            = static_cast< fitness_t >( 0 );
+        evaluationBudget_  = 0u;
+        timeLimit_         = clock::duration::zero();
+    }
+
+
+    // Called at the start of a run, before the initial population is evaluated
+    void start()
+    {
+        startTime_       = clock::now();
+        stallBest_       = std::numeric_limits< fitness_t >::max();
+        lastImprovement_ = 0u;
+    }
+
+
+    // Criteria that need no access to the population. Safe to call from any single thread at a time.
+    StopReason checkProgress( const uint64_t iteration, const uint64_t evaluations, const fitness_t bestFitness )
+    {
+        if ( stopFlag_ && stopFlag_->load( std::memory_order_relaxed ) )
+        {
+            return StopReason::STOP_REQUESTED;
+        }
+
+        if ( targetEnabled_ && bestFitness <= target_ )
+        {
+            return StopReason::TARGET_FITNESS;
+        }
+
+        if ( evaluationBudget_ > 0 && evaluations >= evaluationBudget_ )
+        {
+            return StopReason::EVALUATION_BUDGET;
+        }
+
+        if ( timeLimit_ > clock::duration::zero() && clock::now() - startTime_ >= timeLimit_ )
+        {
+            return StopReason::TIME_LIMIT;
+        }
+
+        if ( stallWindow_ > 0 )
+        {
+            if ( bestFitness < stallBest_ - stallTolerance_ || stallBest_ == std::numeric_limits< fitness_t >::max() )
+            {
+                stallBest_       = bestFitness;
+                lastImprovement_ = iteration;
+            }
+            else if ( iteration >= lastImprovement_ + stallWindow_ )
+            {
+                return StopReason::STALLED;
+            }
+        }
+
+        return StopReason::NONE;
+    }
+
+
+    // Criteria computed over the population; it must not be modified meanwhile
+    template< typename population_t >
+    StopReason checkPopulation( const population_t& population )
+    {
+        const size_t numParticles = population.getNumParticles();
+
+        if ( spreadEnabled_ )
+        {
+            const auto [minIt, maxIt] = std::minmax_element( population.fitnesses(), population.fitnesses() + numParticles );
+
+            if ( *maxIt - *minIt <= spreadTolerance_ )
+            {
+                return StopReason::FITNESS_SPREAD;
+            }
+        }
+
+        if ( diameterEnabled_ && diameter( population ) <= diameterTolerance_ )
+        {
+            return StopReason::DIAMETER;
+        }
+
+        return StopReason::NONE;
+    }
+
+
+    template< typename population_t >
+    StopReason check( const uint64_t iteration, const uint64_t evaluations, const fitness_t bestFitness, const population_t& population )
+    {
+        const StopReason reason = checkProgress( iteration, evaluations, bestFitness );
+
+        return reason != StopReason::NONE ? reason : checkPopulation( population );
+    }
+
+
+    // Run-dependent state, carried over by checkpoints so a resumed run stops where the original would have
+    struct Progress
+    {
+        fitness_t stallBest;
+        uint64_t lastImprovement;
+        int64_t elapsedNanos;
+    };
+
+
+    Progress getProgress() const
+    {
+        return Progress{ stallBest_, lastImprovement_, std::chrono::duration_cast< std::chrono::nanoseconds >( getElapsed() ).count() };
+    }
+
+
+    // Replaces start() when a run is resumed
+    void resume( const Progress& progress )
+    {
+        startTime_       = clock::now() - std::chrono::duration_cast< clock::duration >( std::chrono::nanoseconds( progress.elapsedNanos ) );
+        stallBest_       = progress.stallBest;
+        lastImprovement_ = progress.lastImprovement;
+    }
+
+
+    bool needsPopulation() const { return spreadEnabled_ || diameterEnabled_; }
+
+    clock::duration getElapsed() const { return clock::now() - startTime_; }
+
+
+private:
+
+    // Widest side of the population's bounding box. Rows are folded into running min/max rows, a pass the
+    // compiler vectorizes.
+    template< typename population_t >
+    param_t diameter( const population_t& population )
+    {
+        const size_t numParticles = population.getNumParticles();
+        const size_t numParams    = population.getNumParams();
+
+        lower_.assign( population.position( 0 ), population.position( 0 ) + numParams );
+        upper_.assign( population.position( 0 ), population.position( 0 ) + numParams );
+
+        param_t* __restrict lower = lower_.data();
+        param_t* __restrict upper = upper_.data();
+
+        for ( size_t i = 1; i < numParticles; ++i )
+        {
+            const param_t* __restrict row = population.position( i );
+
+            for ( size_t j = 0; j < numParams; ++j )
+            {
+                lower[j] = std::min( lower[j], row[j] );
+                upper[j] = std::max( upper[j], row[j] );
+            }
+        }
+
+        param_t widest = static_cast< param_t >( 0 );
+
+        for ( size_t j = 0; j < numParams; ++j )
+        {
+            widest = std::max( widest, upper[j] - lower[j] );
+        }
+
+        return widest;
+    }
+
+
+    const std::atomic< bool >* stopFlag_;
+
+    uint64_t stallWindow_;
+    fitness_t stallTolerance_;
+
+    bool spreadEnabled_;
+    fitness_t spreadTolerance_;
+
+    bool diameterEnabled_;
+    param_t diameterTolerance_;
+
+    bool targetEnabled_;
+    fitness_t target_;
+
+    uint64_t evaluationBudget_;
+    clock::duration timeLimit_;
+
+    clock::time_point startTime_;
+    fitness_t stallBest_;
+    uint64_t lastImprovement_;
+
+    std::vector< param_t > lower_;
+    std::vector< param_t > upper_;
+
+}; // class Termination
+
+} // namespace MetaOpt
+
+#endif // TERMINATION_H
@@ -1,7 +1,8 @@
 
-
 #include "ThreadPool.h"
 
+#include <algorithm>
+
 
 namespace MetaOpt
 {
@@ -15,8 +16,13 @@ ThreadPool::ThreadPool( const int numThreads )
     , queue_mtx_{}
     , cv_{}
     , stop_{ true }
+    , loopRanges_{ std::make_unique< LoopRange[] >( std::max( numThreads, 1 ) ) }
+    , loop_{ nullptr }
+    , loopGeneration_{ 0u }
+    , loopRemaining_{ 0 }
+    , loop_mtx_{}
 {
-    workers_.resize( numThreads );
+    workers_.reserve( numThreads );
 }
 
 
@@ -35,30 +41,7 @@ void ThreadPool::startThreads()
     {
         for ( size_t i{0}; i < numThreads_; ++i )
         {
-            workers_.emplace_back( std::thread( [this]
-            {
-                while ( true )
-                {
-                    std::function< void() > task;
-
-                    {
-                        std::unique_lock< std::mutex > lock( this->queue_mtx_ );
-
-                        this->cv_.wait( lock, [this] { return this->stop_ || !this->tasks_.empty(); } );
-
-                        if ( this->stop_ && this->tasks_.empty() )
-                        {
-                            return;
-                        }
-
-                        task = std::move( this->tasks_.front() );
-
-                        this->tasks_.pop();
-                    }
-
-                    task();
-                }
-            } ) );
+            workers_.emplace_back( &ThreadPool::workerLoop, this, i, loopGeneration_ );
         }
 
         stop_ = false;
@@ -84,8 +67,141 @@ void ThreadPool::stopThreads()
                 worker.join();
             }
         }
+
+        workers_.clear();
     }
 }
 
-} // namespace MetaOpt
 
+void ThreadPool::workerLoop( const size_t worker, uint64_t seenGeneration )
+{
+    while ( true )
+    {
+        std::function< void() > task;
+        LoopJob* loop = nullptr;
+
+        {
+            std::unique_lock< std::mutex > lock( queue_mtx_ );
+
+            cv_.wait( lock, [this, seenGeneration] { return stop_ || !tasks_.empty() || loopGeneration_ != seenGeneration; } );
+
+            if ( loopGeneration_ != seenGeneration )
+            {
+                seenGeneration = loopGeneration_;
+                loop = loop_;
+            }
+            else if ( stop_ && tasks_.empty() )
+            {
+                return;
+            }
+            else
+            {
+                task = std::move( tasks_.front() );
+
+                tasks_.pop();
+            }
+        }
+
+        if ( loop )
+        {
+            workOnLoop( *loop, worker );
+
+            if ( loopRemaining_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+            {
+                loopRemaining_.notify_one();
+            }
+        }
+        else
+        {
+            task();
+        }
+    }
+}
+
+
+void ThreadPool::runLoop( const size_t begin, const size_t end, const size_t grain, const Schedule schedule, loop_func_t invoke, void* context )
+{
+    std::lock_guard< std::mutex > loopLock( loop_mtx_ );
+
+    const size_t count      = end - begin;
+    const size_t numWorkers = static_cast< size_t >( numThreads_ );
+
+    // Each worker starts on its own contiguous share of the range
+    for ( size_t w = 0; w < numWorkers; ++w )
+    {
+        loopRanges_[w].next.store( begin + w * count / numWorkers, std::memory_order_relaxed );
+        loopRanges_[w].end = begin + ( w + 1 ) * count / numWorkers;
+    }
+
+    LoopJob job{ invoke, context, grain > 0 ? grain : std::max< size_t >( 1u, count / ( 4u * numWorkers ) ), schedule, { false }, nullptr };
+
+    loopRemaining_.store( numThreads_, std::memory_order_relaxed );
+
+    {
+        std::unique_lock< std::mutex > lock( queue_mtx_ );
+
+        loop_ = &job;
+        ++loopGeneration_;
+    }
+
+    cv_.notify_all();
+
+    int remaining;
+
+    while ( ( remaining = loopRemaining_.load( std::memory_order_acquire ) ) != 0 )
+    {
+        loopRemaining_.wait( remaining, std::memory_order_acquire );
+    }
+
+    {
+        std::unique_lock< std::mutex > lock( queue_mtx_ );
+
+        loop_ = nullptr;
+    }
+
+    if ( job.error )
+    {
+        std::rethrow_exception( job.error );
+    }
+}
+
+
+void ThreadPool::workOnLoop( LoopJob& job, const size_t worker )
+{
+    const size_t numWorkers = static_cast< size_t >( numThreads_ );
+
+    try
+    {
+        for ( size_t k = 0; k < numWorkers; ++k )
+        {
+            // Own share first, then steal from the other shares in round-robin order
+            if ( k > 0 && job.schedule == Schedule::STATIC )
+            {
+                break;
+            }
+
+            LoopRange& range = loopRanges_[( worker + k ) % numWorkers];
+
+            while ( !job.failed.load( std::memory_order_relaxed ) )
+            {
+                const size_t chunkBegin = range.next.fetch_add( job.grain, std::memory_order_relaxed );
+
+                if ( chunkBegin >= range.end )
+                {
+                    break;
+                }
+
+                job.invoke( job.context, chunkBegin, std::min( chunkBegin + job.grain, range.end ), worker );
+            }
+        }
+    }
+    catch ( ... )
+    {
+        if ( !job.failed.exchange( true ) )
+        {
+            job.error = std::current_exception();
+        }
+    }
+}
+
+} // namespace MetaOpt
@@ -3,9 +3,12 @@
 
 
 #include <iostream>
+#include <atomic>
 #include <thread>
 #include <mutex>
+#include <memory>
 #include <condition_variable>
+#include <exception>
 #include <queue>
 #include <functional>
 #include <future>
@@ -19,6 +22,13 @@ class ThreadPool
 {
   public:
 
+    enum class Schedule
+    {
+        STATIC,  // Every worker only processes its own contiguous share of the range
+        DYNAMIC  // Workers claim grains from their own share first, then steal from the other shares
+    };
+
+
     ThreadPool() = delete;
     ThreadPool( const int numThreads );
     ~ThreadPool();
@@ -26,12 +36,45 @@ class ThreadPool
     void startThreads();
     void stopThreads();
 
+    int getNumThreads() const { return numThreads_; }
+
     template< class F, class... Args >
     auto enqueue( F&& f, Args&& ...args ) -> std::future< typename std::result_of< F( Args... ) >::type >;
 
+    // Calls fn( chunkBegin, chunkEnd, worker ) over [begin, end) in chunks of at most grain iterations (0 picks a
+    // grain automatically) and returns once the whole range is done. Runs inline when the threads are stopped.
+    template< class F >
+    void parallelFor( const size_t begin, const size_t end, const size_t grain, F&& fn, const Schedule schedule = Schedule::DYNAMIC );
+
 
   private:
 
+    using loop_func_t = void ( * )( void* context, size_t begin, size_t end, size_t worker );
+
+    // Share of a loop owned by one worker. Padded so that claiming grains never bounces a shared cache line.
+    struct alignas( 64 ) LoopRange
+    {
+        std::atomic< size_t > next;
+        size_t end;
+    };
+
+    struct LoopJob
+    {
+        loop_func_t invoke;
+        void* context;
+        size_t grain;
+        Schedule schedule;
+
+        std::atomic< bool > failed;
+        std::exception_ptr error;
+    };
+
+    void workerLoop( const size_t worker, uint64_t seenGeneration );
+
+    void runLoop( const size_t begin, const size_t end, const size_t grain, const Schedule schedule, loop_func_t invoke, void* context );
+    void workOnLoop( LoopJob& job, const size_t worker );
+
+
     int numThreads_;
     std::vector< std::thread > workers_;
     std::queue< std::function< void() > > tasks_;
@@ -40,6 +83,16 @@ class ThreadPool
     std::condition_variable cv_;
     bool stop_;
 
+    std::unique_ptr< LoopRange[] > loopRanges_;
+    LoopJob* loop_;
+    uint64_t loopGeneration_;
+
+    // Completion barrier, reused by every loop
+    std::atomic< int > loopRemaining_;
+
+    // Serializes loops submitted from different threads
+    std::mutex loop_mtx_;
+
 }; // class ThreadPool
 
 
@@ -73,7 +126,33 @@ auto ThreadPool::enqueue( F&& f, Args&& ... args ) -> std::future< typename std:
 }
 
 
+// Parallel loop without any per-iteration allocation: the callable is passed by address to the workers
+template< class F >
+void ThreadPool::parallelFor( const size_t begin, const size_t end, const size_t grain, F&& fn, const Schedule schedule )
+{
+    if ( begin >= end )
+    {
+        return;
+    }
+
+    if ( stop_ )
+    {
+        fn( begin, end, size_t{ 0 } );
+        return;
+    }
+
+    using func_t = std::remove_reference_t< F >;
+
+    loop_func_t invoke = []( void* context, size_t chunkBegin, size_t chunkEnd, size_t worker )
+    {
+        ( *static_cast< func_t* >( context ) )( chunkBegin, chunkEnd, worker );
+    };
+
+    runLoop( begin, end, grain, schedule, invoke, const_cast< void* >( static_cast< const void* >( std::addressof( fn ) ) ) );
+}
+
+
 } // namespace MetaOpt
 
 
-#endif // THREAD_POOL_H
\ No newline at end of file
+#endif // THREAD_POOL_H
@@ -0,0 +1,378 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+
+
+namespace MetaOpt
+{
+
+TrajectoryWriter::TrajectoryWriter( const std::string& path, const TrajectoryHeader& header, const Options& options )
+    : header_{ header }
+    , options_{ options }
+    , bestPositionOffset_{ 0u }
+    , fitnessesOffset_{ 0u }
+    , positionsOffset_{ 0u }
+    , slotSize_{ 0u }
+    , ring_{ nullptr }
+    , file_{}
+    , columns_{}
+    , columnWidths_{}
+    , chunkSize_{ 0u }
+    , numDropped_{ 0u }
+    , numStalls_{ 0u }
+    , error_{ nullptr }
+    , thread_{}
+    , closed_{ false }
+{
+    std::memcpy( header_.magic, TrajectoryHeader::MAGIC, sizeof( header_.magic ) );
+
+    header_.version    = TrajectoryHeader::VERSION;
+    header_.headerSize = sizeof( TrajectoryHeader );
+
+    const size_t numParticles = header_.numParticles;
+    const size_t numParams    = header_.numParams;
+    const bool population     = ( header_.flags & TrajectoryHeader::POPULATION ) != 0;
+
+    bestPositionOffset_ = BEST_FITNESS_OFFSET + pad8( header_.fitnessSize );
+    fitnessesOffset_    = bestPositionOffset_ + pad8( numParams * header_.paramSize );
+    positionsOffset_    = fitnessesOffset_ + ( population ? pad8( numParticles * header_.fitnessSize ) : 0u );
+    slotSize_           = positionsOffset_ + ( population ? numParticles * numParams * header_.paramSize : 0u );
+
+    // Bytes per record of every column, in file order
+    columnWidths_ = { sizeof( uint64_t ), sizeof( uint64_t ), sizeof( uint64_t ), header_.fitnessSize, numParams * header_.paramSize };
+
+    if ( population )
+    {
+        columnWidths_.push_back( numParticles * header_.fitnessSize );
+        columnWidths_.push_back( numParticles * numParams * header_.paramSize );
+    }
+
+    columns_.resize( columnWidths_.size() );
+
+    for ( size_t c = 0; c < columns_.size(); ++c )
+    {
+        columns_[c].reserve( columnWidths_[c] * std::max< size_t >( options_.chunkRecords, 1u ) );
+    }
+
+    const size_t capacity = std::clamp< size_t >( options_.ringBytes / slotSize_, 4u, 1024u );
+
+    ring_ = std::make_unique< SpscRing >( slotSize_, capacity );
+
+    file_.open( path, std::ios::binary | std::ios::trunc );
+
+    if ( !file_ )
+    {
+        throw std::runtime_error( "TrajectoryWriter::TrajectoryWriter: cannot create " + path );
+    }
+
+    file_.write( reinterpret_cast< const char* >( &header_ ), sizeof( header_ ) );
+
+    thread_ = std::thread( &TrajectoryWriter::loop, this );
+}
+
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    if ( !closed_ )
+    {
+        try
+        {
+            close();
+        }
+        catch ( ... )
+        {
+        }
+    }
+}
+
+
+std::byte* TrajectoryWriter::acquire()
+{
+    std::byte* slot = ring_->tryAcquire();
+
+    if ( slot )
+    {
+        return slot;
+    }
+
+    if ( options_.dropWhenFull )
+    {
+        ++numDropped_;
+        return nullptr;
+    }
+
+    ++numStalls_;
+
+    while ( !( slot = ring_->tryAcquire() ) )
+    {
+        std::this_thread::yield();
+    }
+
+    return slot;
+}
+
+
+void TrajectoryWriter::commit()
+{
+    ring_->commit();
+}
+
+
+void TrajectoryWriter::close()
+{
+    if ( closed_ )
+    {
+        return;
+    }
+
+    closed_ = true;
+
+    // The end marker is never dropped
+    std::byte* slot;
+
+    while ( !( slot = ring_->tryAcquire() ) )
+    {
+        std::this_thread::yield();
+    }
+
+    const RecordPrefix end{ END, 0u, 0u, 0u };
+    std::memcpy( slot, &end, sizeof( end ) );
+
+    ring_->commit();
+
+    thread_.join();
+
+    file_.close();
+
+    if ( error_ )
+    {
+        std::rethrow_exception( error_ );
+    }
+}
+
+
+void TrajectoryWriter::loop()
+{
+    try
+    {
+        while ( true )
+        {
+            const std::byte* slot = ring_->tryPeek();
+
+            if ( !slot )
+            {
+                ring_->waitForData();
+                continue;
+            }
+
+            RecordPrefix prefix;
+            std::memcpy( &prefix, slot, sizeof( prefix ) );
+
+            if ( prefix.kind == END )
+            {
+                ring_->release();
+                break;
+            }
+
+            appendRecord( slot );
+
+            ring_->release();
+
+            if ( chunkSize_ >= options_.chunkRecords )
+            {
+                writeChunk();
+            }
+        }
+
+        writeChunk();
+
+        file_.flush();
+
+        if ( !file_ )
+        {
+            throw std::runtime_error( "TrajectoryWriter: write failed" );
+        }
+    }
+    catch ( ... )
+    {
+        error_ = std::current_exception();
+
+        // Keep draining, so the producer never waits on a dead writer
+        while ( true )
+        {
+            const std::byte* slot = ring_->tryPeek();
+
+            if ( !slot )
+            {
+                ring_->waitForData();
+                continue;
+            }
+
+            RecordPrefix prefix;
+            std::memcpy( &prefix, slot, sizeof( prefix ) );
+
+            ring_->release();
+
+            if ( prefix.kind == END )
+            {
+                break;
+            }
+        }
+    }
+}
+
+
+void TrajectoryWriter::appendRecord( const std::byte* slot )
+{
+    const size_t offsets[] = { offsetof( RecordPrefix, iteration ), offsetof( RecordPrefix, timeNanos ), offsetof( RecordPrefix, evaluations ),
+                               BEST_FITNESS_OFFSET, bestPositionOffset_, fitnessesOffset_, positionsOffset_ };
+
+    for ( size_t c = 0; c < columns_.size(); ++c )
+    {
+        columns_[c].insert( columns_[c].end(), slot + offsets[c], slot + offsets[c] + columnWidths_[c] );
+    }
+
+    ++chunkSize_;
+}
+
+
+void TrajectoryWriter::writeChunk()
+{
+    if ( chunkSize_ == 0 )
+    {
+        return;
+    }
+
+    TrajectoryChunkHeader chunk{ TrajectoryChunkHeader::MAGIC, static_cast< uint32_t >( chunkSize_ ), 0u };
+
+    for ( const std::vector< std::byte >& column : columns_ )
+    {
+        chunk.payloadSize += pad8( column.size() );
+    }
+
+    file_.write( reinterpret_cast< const char* >( &chunk ), sizeof( chunk ) );
+
+    static constexpr char PADDING[8] = {};
+
+    for ( std::vector< std::byte >& column : columns_ )
+    {
+        file_.write( reinterpret_cast< const char* >( column.data() ), static_cast< std::streamsize >( column.size() ) );
+        file_.write( PADDING, static_cast< std::streamsize >( pad8( column.size() ) - column.size() ) );
+
+        column.clear();
+    }
+
+    chunkSize_ = 0;
+}
+
+
+
+TrajectoryReader::TrajectoryReader( const std::string& path )
+    : header_{}
+    , numRecords_{ 0u }
+    , columns_( NUM_COLUMNS )
+{
+    std::ifstream file( path, std::ios::binary );
+
+    if ( !file || !file.read( reinterpret_cast< char* >( &header_ ), sizeof( header_ ) ) )
+    {
+        throw std::runtime_error( "TrajectoryReader::TrajectoryReader: cannot read " + path );
+    }
+
+    if ( std::memcmp( header_.magic, TrajectoryHeader::MAGIC, sizeof( header_.magic ) ) != 0 || header_.version != TrajectoryHeader::VERSION ||
+         header_.headerSize != sizeof( TrajectoryHeader ) )
+    {
+        throw std::runtime_error( "TrajectoryReader::TrajectoryReader: " + path + " is not a trajectory log of a supported version" );
+    }
+
+    const size_t widths[NUM_COLUMNS] = { sizeof( uint64_t ), sizeof( uint64_t ), sizeof( uint64_t ), header_.fitnessSize,
+                                         header_.numParams * header_.paramSize, header_.numParticles * header_.fitnessSize,
+                                         header_.numParticles * header_.numParams * header_.paramSize };
+
+    const size_t numColumns = hasPopulation() ? NUM_COLUMNS : FITNESSES;
+
+    std::vector< char > payload;
+    TrajectoryChunkHeader chunk;
+
+    while ( file.read( reinterpret_cast< char* >( &chunk ), sizeof( chunk ) ) )
+    {
+        if ( chunk.magic != TrajectoryChunkHeader::MAGIC )
+        {
+            break;
+        }
+
+        size_t expected = 0;
+
+        for ( size_t c = 0; c < numColumns; ++c )
+        {
+            expected += ( chunk.numRecords * widths[c] + 7u ) & ~size_t{ 7u };
+        }
+
+        payload.resize( chunk.payloadSize );
+
+        if ( chunk.payloadSize != expected || !file.read( payload.data(), static_cast< std::streamsize >( payload.size() ) ) )
+        {
+            break;
+        }
+
+        size_t offset = 0;
+
+        for ( size_t c = 0; c < numColumns; ++c )
+        {
+            const size_t bytes = chunk.numRecords * widths[c];
+            const std::byte* data = reinterpret_cast< const std::byte* >( payload.data() ) + offset;
+
+            columns_[c].insert( columns_[c].end(), data, data + bytes );
+
+            offset += ( bytes + 7u ) & ~size_t{ 7u };
+        }
+
+        numRecords_ += chunk.numRecords;
+    }
+}
+
+
+double TrajectoryReader::widen( const std::byte* data, const size_t idx, const uint32_t size )
+{
+    if ( size == sizeof( double ) )
+    {
+        double value;
+        std::memcpy( &value, data + idx * sizeof( double ), sizeof( double ) );
+        return value;
+    }
+
+    if ( size == sizeof( float ) )
+    {
+        float value;
+        std::memcpy( &value, data + idx * sizeof( float ), sizeof( float ) );
+        return value;
+    }
+
+    throw std::invalid_argument( "TrajectoryReader: only float and double values can be widened" );
+}
+
+
+double TrajectoryReader::getBestFitnessValue( const size_t record ) const
+{
+    return widen( columns_[BEST_FITNESS].data(), record, header_.fitnessSize );
+}
+
+
+double TrajectoryReader::getBestPositionValue( const size_t record, const size_t param ) const
+{
+    return widen( columns_[BEST_POSITION].data(), record * getNumParams() + param, header_.paramSize );
+}
+
+
+double TrajectoryReader::getFitnessValue( const size_t record, const size_t particle ) const
+{
+    return widen( columns_[FITNESSES].data(), record * getNumParticles() + particle, header_.fitnessSize );
+}
+
+
+double TrajectoryReader::getPositionValue( const size_t record, const size_t particle, const size_t param ) const
+{
+    return widen( columns_[POSITIONS].data(), ( record * getNumParticles() + particle ) * getNumParams() + param, header_.paramSize );
+}
+
+} // namespace MetaOpt
@@ -0,0 +1,355 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "Observer.h"
+#include "SpscRing.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace MetaOpt
+{
+
+// Trajectory log: this header, then chunks of up to chunkRecords records stored column by column:
+// iteration[n], timeNanos[n], evaluations[n], bestFitness[n], bestPosition[n x numParams] and, with
+// POPULATION set, fitnesses[n x numParticles] and positions[n x numParticles x numParams]. Every column
+// starts on an 8-byte boundary.
+struct TrajectoryHeader
+{
+    static constexpr char     MAGIC[8]   = { 'M', 'E', 'T', 'A', 'O', 'P', 'T', 'R' };
+    static constexpr uint32_t VERSION    = 1u;
+    static constexpr size_t   TAG_SIZE   = 32;
+    static constexpr uint32_t POPULATION = 1u;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    char algorithm[TAG_SIZE];
+    uint64_t numParticles;
+    uint64_t numParams;
+    uint32_t paramSize;
+    uint32_t fitnessSize;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+
+struct TrajectoryChunkHeader
+{
+    static constexpr uint32_t MAGIC = 0x4B484354u;  // "TCHK"
+
+    uint32_t magic;
+    uint32_t numRecords;
+    uint64_t payloadSize;
+};
+
+
+
+// Byte-level side of the recorder. The optimizer thread fills ring slots, a background thread transposes them
+// into column chunks and writes those to the file.
+class TrajectoryWriter
+{
+public:
+
+    struct Options
+    {
+        size_t ringBytes    = 64u << 20;    // Ring capacity; between 4 and 1024 records fit
+        size_t chunkRecords = 64;
+        bool dropWhenFull   = false;        // Otherwise the optimizer waits for the writer
+    };
+
+
+    TrajectoryWriter( const std::string& path, const TrajectoryHeader& header, const Options& options );
+
+    ~TrajectoryWriter();
+
+
+    // Slot to fill with one record, laid out as described by the offsets below; nullptr when the ring is full
+    // and records may be dropped
+    std::byte* acquire();
+
+    void commit();
+
+    // Writes everything recorded so far and closes the file. Rethrows an error of the writer thread.
+    void close();
+
+
+    size_t getBestPositionOffset() const { return bestPositionOffset_; }
+    size_t getFitnessesOffset() const { return fitnessesOffset_; }
+    size_t getPositionsOffset() const { return positionsOffset_; }
+
+    uint64_t getNumDropped() const { return numDropped_; }
+    uint64_t getNumStalls() const { return numStalls_; }
+
+
+    // Slot prefix
+    struct RecordPrefix
+    {
+        uint64_t kind;          // RECORD or END
+        uint64_t iteration;
+        uint64_t timeNanos;
+        uint64_t evaluations;
+    };
+
+    static constexpr uint64_t RECORD = 0u;
+    static constexpr uint64_t END    = 1u;
+
+    static constexpr size_t BEST_FITNESS_OFFSET = sizeof( RecordPrefix );
+
+
+private:
+
+    void loop();
+
+    void appendRecord( const std::byte* slot );
+
+    void writeChunk();
+
+
+    static size_t pad8( const size_t bytes ) { return ( bytes + 7u ) & ~size_t{ 7u }; }
+
+
+    TrajectoryHeader header_;
+    Options options_;
+
+    size_t bestPositionOffset_;
+    size_t fitnessesOffset_;
+    size_t positionsOffset_;
+    size_t slotSize_;
+
+    std::unique_ptr< SpscRing > ring_;
+    std::ofstream file_;
+
+    // Columns of the chunk being assembled, in file order
+    std::vector< std::vector< std::byte > > columns_;
+    std::vector< size_t > columnWidths_;
+    size_t chunkSize_;
+
+    uint64_t numDropped_;
+    uint64_t numStalls_;
+
+    std::exception_ptr error_;
+    std::thread thread_;
+    bool closed_;
+
+
+    TrajectoryWriter( const TrajectoryWriter& ) = delete;
+    TrajectoryWriter& operator=( const TrajectoryWriter& ) = delete;
+
+}; // class TrajectoryWriter
+
+
+
+// Loads a trajectory log into contiguous columns. A chunk cut short by a crash ends the log.
+class TrajectoryReader
+{
+public:
+
+    explicit TrajectoryReader( const std::string& path );
+
+
+    const TrajectoryHeader& getHeader() const { return header_; }
+
+    size_t getNumRecords() const { return numRecords_; }
+    size_t getNumParticles() const { return header_.numParticles; }
+    size_t getNumParams() const { return header_.numParams; }
+    bool hasPopulation() const { return ( header_.flags & TrajectoryHeader::POPULATION ) != 0; }
+
+
+    uint64_t getIteration( const size_t record ) const { return column< uint64_t >( ITERATION )[record]; }
+    uint64_t getTimeNanos( const size_t record ) const { return column< uint64_t >( TIME )[record]; }
+    uint64_t getEvaluations( const size_t record ) const { return column< uint64_t >( EVALUATIONS )[record]; }
+
+
+    template< typename fitness_t >
+    fitness_t getBestFitness( const size_t record ) const
+    {
+        return checkedColumn< fitness_t >( BEST_FITNESS, header_.fitnessSize )[record];
+    }
+
+    template< typename param_t >
+    const param_t* getBestPosition( const size_t record ) const
+    {
+        return checkedColumn< param_t >( BEST_POSITION, header_.paramSize ) + record * getNumParams();
+    }
+
+    template< typename fitness_t >
+    const fitness_t* getFitnesses( const size_t record ) const
+    {
+        return checkedColumn< fitness_t >( FITNESSES, header_.fitnessSize ) + record * getNumParticles();
+    }
+
+    template< typename param_t >
+    const param_t* getPositions( const size_t record ) const
+    {
+        return checkedColumn< param_t >( POSITIONS, header_.paramSize ) + record * getNumParticles() * getNumParams();
+    }
+
+
+    // Values of any stored width widened to double, for tools that do not know the types
+    double getBestFitnessValue( const size_t record ) const;
+    double getBestPositionValue( const size_t record, const size_t param ) const;
+    double getFitnessValue( const size_t record, const size_t particle ) const;
+    double getPositionValue( const size_t record, const size_t particle, const size_t param ) const;
+
+
+private:
+
+    enum Column : size_t { ITERATION, TIME, EVALUATIONS, BEST_FITNESS, BEST_POSITION, FITNESSES, POSITIONS, NUM_COLUMNS };
+
+
+    template< typename T >
+    const T* column( const Column c ) const { return reinterpret_cast< const T* >( columns_[c].data() ); }
+
+    template< typename T >
+    const T* checkedColumn( const Column c, const uint32_t storedSize ) const
+    {
+        if ( sizeof( T ) != storedSize || columns_[c].empty() )
+        {
+            throw std::invalid_argument( "TrajectoryReader: column not recorded with this type" );
+        }
+
+        return column< T >( c );
+    }
+
+    static double widen( const std::byte* data, const size_t idx, const uint32_t size );
+
+
+    TrajectoryHeader header_;
+    size_t numRecords_;
+    std::vector< std::vector< std::byte > > columns_;
+
+}; // class TrajectoryReader
+
+
+
+// Observer writing the best particle, and optionally the whole population, of every interval-th iteration to a
+// trajectory log. The optimizer thread only copies into the ring; encoding and I/O run on the writer thread.
+// Each run rewrites the file.
+template< typename __PARAM_T = double, typename __FITNESS_T = double >
+class TrajectoryRecorder : public Observer< __PARAM_T, __FITNESS_T >
+{
+public:
+
+    using Base      = Observer< __PARAM_T, __FITNESS_T >;
+    using param_t   = __PARAM_T;
+    using fitness_t = __FITNESS_T;
+    using view_t    = typename Base::view_t;
+
+
+    explicit TrajectoryRecorder( const std::string& path, const bool recordPopulation = false, const uint64_t interval = 1u,
+                                 const TrajectoryWriter::Options& options = TrajectoryWriter::Options{} )
+        : path_{ path }
+        , recordPopulation_{ recordPopulation }
+        , interval_{ interval > 0 ? interval : 1u }
+        , options_{ options }
+        , writer_{ nullptr }
+        , start_{}
+        , lastRecorded_{ 0u }
+    {
+    }
+
+
+    void onRunBegin( const RunInfo& info ) override
+    {
+        TrajectoryHeader header{};
+
+        std::strncpy( header.algorithm, info.algorithm, TrajectoryHeader::TAG_SIZE - 1 );
+
+        header.numParticles = info.numParticles;
+        header.numParams    = info.numParams;
+        header.paramSize    = sizeof( param_t );
+        header.fitnessSize  = sizeof( fitness_t );
+        header.flags        = recordPopulation_ ? TrajectoryHeader::POPULATION : 0u;
+
+        writer_.reset();
+        writer_ = std::make_unique< TrajectoryWriter >( path_, header, options_ );
+        start_  = std::chrono::steady_clock::now();
+    }
+
+
+    void onInitialized( const view_t& view ) override
+    {
+        record( view );
+    }
+
+
+    void onIteration( const view_t& view ) override
+    {
+        if ( view.iteration % interval_ == 0 )
+        {
+            record( view );
+        }
+    }
+
+
+    void onRunEnd( const view_t& view, const StopReason ) override
+    {
+        if ( view.iteration != lastRecorded_ )
+        {
+            record( view );
+        }
+
+        writer_->close();
+    }
+
+
+    uint64_t getNumDropped() const { return writer_ ? writer_->getNumDropped() : 0u; }
+    uint64_t getNumStalls() const { return writer_ ? writer_->getNumStalls() : 0u; }
+
+
+private:
+
+    void record( const view_t& view )
+    {
+        std::byte* slot = writer_->acquire();
+
+        if ( !slot )
+        {
+            return;
+        }
+
+        const TrajectoryWriter::RecordPrefix prefix{ TrajectoryWriter::RECORD, view.iteration,
+            static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - start_ ).count() ),
+            view.evaluations };
+
+        std::memcpy( slot, &prefix, sizeof( prefix ) );
+        std::memcpy( slot + TrajectoryWriter::BEST_FITNESS_OFFSET, &view.bestFitness, sizeof( fitness_t ) );
+        std::memcpy( slot + writer_->getBestPositionOffset(), view.bestPosition, view.numParams * sizeof( param_t ) );
+
+        if ( recordPopulation_ )
+        {
+            std::memcpy( slot + writer_->getFitnessesOffset(), view.fitnesses, view.numParticles * sizeof( fitness_t ) );
+            std::memcpy( slot + writer_->getPositionsOffset(), view.positions, view.numParticles * view.numParams * sizeof( param_t ) );
+        }
+
+        writer_->commit();
+
+        lastRecorded_ = view.iteration;
+    }
+
+
+    std::string path_;
+    bool recordPopulation_;
+    uint64_t interval_;
+    TrajectoryWriter::Options options_;
+
+    std::unique_ptr< TrajectoryWriter > writer_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t lastRecorded_;
+
+}; // class TrajectoryRecorder
+
+} // namespace MetaOpt
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,83 @@
+
+#include "Trajectory.h"
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+
+// Prints a trajectory log as CSV: the best particle per record, or with --population every particle
+int main( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        std::cerr << "usage: trajectory_dump <log> [--population]" << std::endl;
+        return 1;
+    }
+
+    const bool population = argc > 2 && std::string( argv[2] ) == "--population";
+
+    try
+    {
+        const MetaOpt::TrajectoryReader reader( argv[1] );
+
+        const MetaOpt::TrajectoryHeader& header = reader.getHeader();
+
+        std::cerr << header.algorithm << ": " << reader.getNumRecords() << " records, " << reader.getNumParticles() << " particles, "
+                  << reader.getNumParams() << " parameters" << ( reader.hasPopulation() ? ", population recorded" : "" ) << std::endl;
+
+        if ( population && !reader.hasPopulation() )
+        {
+            std::cerr << "trajectory_dump: the log holds no population" << std::endl;
+            return 1;
+        }
+
+        std::cout.precision( std::numeric_limits< double >::max_digits10 );
+
+        std::cout << ( population ? "iteration,time_seconds,evaluations,particle,fitness" : "iteration,time_seconds,evaluations,best_fitness" );
+
+        for ( size_t j = 0; j < reader.getNumParams(); ++j )
+        {
+            std::cout << ",x" << j;
+        }
+
+        std::cout << "\n";
+
+        for ( size_t r = 0; r < reader.getNumRecords(); ++r )
+        {
+            const double seconds = static_cast< double >( reader.getTimeNanos( r ) ) * 1e-9;
+
+            if ( !population )
+            {
+                std::cout << reader.getIteration( r ) << "," << seconds << "," << reader.getEvaluations( r ) << "," << reader.getBestFitnessValue( r );
+
+                for ( size_t j = 0; j < reader.getNumParams(); ++j )
+                {
+                    std::cout << "," << reader.getBestPositionValue( r, j );
+                }
+
+                std::cout << "\n";
+                continue;
+            }
+
+            for ( size_t i = 0; i < reader.getNumParticles(); ++i )
+            {
+                std::cout << reader.getIteration( r ) << "," << seconds << "," << reader.getEvaluations( r ) << "," << i << "," << reader.getFitnessValue( r, i );
+
+                for ( size_t j = 0; j < reader.getNumParams(); ++j )
+                {
+                    std::cout << "," << reader.getPositionValue( r, i, j );
+                }
+
+                std::cout << "\n";
+            }
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "trajectory_dump: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
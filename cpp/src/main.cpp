@@ -3,7 +3,7 @@
 #include "SwarmOptimization.h"
 #include "DifferentialEvolution.h"
 
-#include "Timer.h"
+#include "Profiler.h"
 
 #include <chrono>
 #include <iostream>
@@ -30,6 +30,8 @@ int main()
 
     oa.setMaxIterations( 50 );
 
+    oa.addObserver( std::make_shared< MetaOpt::ConsoleObserver<> >() );
+
     auto start = std::chrono::high_resolution_clock::now();
     oa.run();
     auto end = std::chrono::high_resolution_clock::now();
@@ -38,7 +40,7 @@ int main()
 
     std::cout << "The function took " << duration.count() << " seconds to run." << std::endl;
 
-    MetaOpt::Timer::getInstance()->printTimeStats();
+    oa.getProfiler().printSummary();
 
     return 0;
 }
\ No newline at end of file